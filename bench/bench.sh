@@ -0,0 +1,154 @@
+#!/bin/sh
+# Benchmark harness over the example networks (run by `make bench`).
+#
+# usage: bench/bench.sh [-d DIR] [-r REPS] [-o OUT_DIR] [-b BASELINE] [-t TOLERANCE]
+#                       [-u] [EXAMPLE...]
+#  EXAMPLE      example names, e.g. bupa (default: every DIR/NAME.net.search
+#               that has a .cnf and .lmap file next to it)
+#  -d DIR       directory of the examples (default: examples)
+#  -r REPS      runs per example (default: 3)
+#  -o OUT_DIR   output directory (default: bench/out). Receives results.csv
+#               with every run, and summary.csv and summary.json with one
+#               line per example: the minimum of each phase time over the
+#               runs, and the maximum peak RSS
+#  -b BASELINE  summary to compare against (default: bench/baseline.csv)
+#  -t TOLERANCE allowed slowdown of each phase and of peak RSS, as a fraction
+#               (default: 0.25). Slowdowns below MIN_SECONDS (default: 0.05)
+#               are timer noise and never count
+#  -u           store the summary as the baseline instead of comparing
+# The trim binary is taken from $TRIM (default: build/trim). Exits with 1 if
+# a phase, the peak RSS or the best ECA of an example regressed. trim runs with
+# --no-naive-bayes: the examples are naive Bayes, and this benchmarks the
+# compilation and search of the SDD.
+
+TRIM=${TRIM:-build/trim}
+MIN_SECONDS=${MIN_SECONDS:-0.05}
+DIR=examples
+REPS=3
+OUT_DIR=bench/out
+BASELINE=bench/baseline.csv
+TOLERANCE=0.25
+UPDATE=0
+while getopts "d:r:o:b:t:u" option; do
+  case $option in
+    d) DIR=$OPTARG ;;
+    r) REPS=$OPTARG ;;
+    o) OUT_DIR=$OPTARG ;;
+    b) BASELINE=$OPTARG ;;
+    t) TOLERANCE=$OPTARG ;;
+    u) UPDATE=1 ;;
+    *) exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+if [ ! -x "$TRIM" ]; then
+  echo "trim binary $TRIM not found; run make first" >&2
+  exit 1
+fi
+EXAMPLES=$*
+if [ -z "$EXAMPLES" ]; then
+  for search in "$DIR"/*.net.search; do
+    name=$(basename "$search" .net.search)
+    if [ -f "$DIR/$name.net.cnf" ] && [ -f "$DIR/$name.net.lmap" ]; then
+      EXAMPLES="$EXAMPLES $name"
+    fi
+  done
+fi
+
+mkdir -p "$OUT_DIR"
+RESULTS=$OUT_DIR/results.csv
+SUMMARY=$OUT_DIR/summary.csv
+HEADER="parse_s,compile_s,minimize_s,constrain_s,search_s,total_s,peak_rss_kb,sdd_size,sdd_count,best_eca"
+echo "example,run,$HEADER" > "$RESULTS"
+RECORD=$OUT_DIR/record.csv
+for name in $EXAMPLES; do
+  run=1
+  while [ $run -le "$REPS" ]; do
+    printf "%s run %d/%d..." "$name" $run "$REPS"
+    rm -f "$RECORD"
+    if ! "$TRIM" --no-naive-bayes -b "$RECORD" -c "$DIR/$name.net.cnf" \
+         -l "$DIR/$name.net.lmap" -e "$DIR/$name.net.search" > "$OUT_DIR/$name.log" 2>&1; then
+      echo "failed (see $OUT_DIR/$name.log)"
+      exit 1
+    fi
+    # Drop the problem file name that trim writes first
+    sed "s/^[^,]*,/$name,$run,/" "$RECORD" >> "$RESULTS"
+    tail -n 1 "$RESULTS" | cut -d, -f8 | sed 's/^/ total /; s/$/ s/'
+    run=$((run + 1))
+  done
+done
+rm -f "$RECORD"
+
+# Summary: minimum phase times (columns 3-8), maximum peak RSS (9), and the
+# SDD and ECA of the last run
+awk -F, -v header="$HEADER" '
+  NR == 1 { next }
+  !($1 in runs) { order[n++] = $1 }
+  {
+    runs[$1]++
+    for (i = 3; i <= 8; i++) {
+      if (runs[$1] == 1 || $i < value[$1, i]) value[$1, i] = $i
+    }
+    if (runs[$1] == 1 || $9 > value[$1, 9]) value[$1, 9] = $9
+    for (i = 10; i <= 12; i++) value[$1, i] = $i
+  }
+  END {
+    print "example,runs," header
+    for (k = 0; k < n; k++) {
+      line = order[k] "," runs[order[k]]
+      for (i = 3; i <= 12; i++) line = line "," value[order[k], i]
+      print line
+    }
+  }' "$RESULTS" > "$SUMMARY"
+
+awk -F, '
+  NR == 1 { for (i = 1; i <= NF; i++) name[i] = $i; print "["; next }
+  {
+    if (NR > 2) print ","
+    line = "  {\"" name[1] "\": \"" $1 "\""
+    for (i = 2; i <= NF; i++) line = line ", \"" name[i] "\": " $i
+    printf "%s}", line
+  }
+  END { print ""; print "]" }' "$SUMMARY" > "$OUT_DIR/summary.json"
+
+echo
+cat "$SUMMARY"
+echo "results written to $RESULTS, $SUMMARY and $OUT_DIR/summary.json"
+
+if [ $UPDATE -eq 1 ]; then
+  cp "$SUMMARY" "$BASELINE"
+  echo "baseline stored in $BASELINE"
+  exit 0
+fi
+if [ ! -f "$BASELINE" ]; then
+  echo "no baseline $BASELINE to compare against (store one with -u)"
+  exit 0
+fi
+
+echo
+echo "comparison with $BASELINE (tolerance $TOLERANCE):"
+awk -F, -v tolerance="$TOLERANCE" -v min_seconds="$MIN_SECONDS" '
+  FNR == 1 { for (i = 1; i <= NF; i++) name[i] = $i; next }
+  FNR == NR { for (i = 3; i <= NF; i++) base[$1, i] = $i; known[$1] = 1; next }
+  {
+    if (!($1 in known)) { printf "  %-10s not in baseline\n", $1; next }
+    for (i = 3; i <= 9; i++) {
+      b = base[$1, i]; c = $i
+      slower = (i == 9) ? c > b * (1 + tolerance) \
+                        : c > b * (1 + tolerance) && c - b > min_seconds
+      change = (b > 0) ? sprintf("%+.1f%%", 100 * (c - b) / b) : "n/a"
+      printf "  %-10s %-12s %12s -> %-12s %8s%s\n", $1, name[i], b, c, change,
+             slower ? "  REGRESSION" : ""
+      failed += slower
+    }
+    d = $12 - base[$1, 12]
+    if (d > 1e-6 || d < -1e-6) {
+      printf "  %-10s best_eca changed: %s -> %s  REGRESSION\n", $1, base[$1, 12], $12
+      failed++
+    }
+  }
+  END {
+    if (failed) { printf "%d regression(s)\n", failed; exit 1 }
+    print "no regressions"
+  }' "$BASELINE" "$SUMMARY"
@@ -0,0 +1,72 @@
+#!/bin/sh
+# Tradeoff of epsilon-approximate search on the examples (run by
+# `make bench-epsilon`).
+#
+# usage: bench/epsilon.sh [-d DIR] [-e "EPSILONS"] [-o OUTPUT] [EXAMPLE...]
+#  EXAMPLE      example names, e.g. bupa (default: anatomy bupa heart ident pima)
+#  -d DIR       directory of the examples (default: examples)
+#  -e EPSILONS  values of --epsilon (default: "0 0.01 0.02 0.05 0.1 0.2")
+#  -o OUTPUT    CSV file (default: bench/out/epsilon.csv)
+# Each example runs once per epsilon. OUTPUT receives the nodes expanded, the
+# search time, the best ECA found and the proven optimality gap of each run,
+# and the nodes, time and ECA relative to the exact search (epsilon 0, which
+# must come first).
+
+TRIM=${TRIM:-build/trim}
+DIR=examples
+EPSILONS="0 0.01 0.02 0.05 0.1 0.2"
+OUTPUT=bench/out/epsilon.csv
+while getopts "d:e:o:" option; do
+  case $option in
+    d) DIR=$OPTARG ;;
+    e) EPSILONS=$OPTARG ;;
+    o) OUTPUT=$OPTARG ;;
+    *) exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+EXAMPLES=${*:-anatomy bupa heart ident pima}
+
+if [ ! -x "$TRIM" ]; then
+  echo "trim binary $TRIM not found; run make first" >&2
+  exit 1
+fi
+OUT_DIR=$(dirname "$OUTPUT")
+mkdir -p "$OUT_DIR"
+RECORD=$OUT_DIR/record.csv
+STATS=$OUT_DIR/stats.json
+
+# Value of a numeric field of the --stats-json output
+json_field() {
+  sed -n "s/^ *\"$1\": \([-0-9.e+]*\),*$/\1/p" "$STATS"
+}
+
+echo "example,epsilon,nodes_expanded,search_s,best_eca,optimality_gap,nodes_ratio,search_ratio,eca_loss" > "$OUTPUT"
+for name in $EXAMPLES; do
+  exact_nodes=; exact_search=; exact_eca=
+  for epsilon in $EPSILONS; do
+    printf "%s epsilon %s..." "$name" "$epsilon"
+    rm -f "$RECORD"
+    if ! "$TRIM" --no-naive-bayes -b "$RECORD" --stats-json "$STATS" --epsilon "$epsilon" \
+         -c "$DIR/$name.net.cnf" -l "$DIR/$name.net.lmap" -e "$DIR/$name.net.search" \
+         > "$OUT_DIR/$name-$epsilon.log" 2>&1; then
+      echo "failed (see $OUT_DIR/$name-$epsilon.log)"
+      exit 1
+    fi
+    nodes=$(json_field nodes_expanded)
+    gap=$(json_field optimality_gap)
+    search=$(cut -d, -f6 "$RECORD")
+    eca=$(cut -d, -f11 "$RECORD")
+    if [ "$epsilon" = 0 ] || [ "$epsilon" = 0.0 ]; then
+      exact_nodes=$nodes; exact_search=$search; exact_eca=$eca
+    fi
+    awk -v n="$nodes" -v s="$search" -v e="$eca" -v g="$gap" \
+        -v en="${exact_nodes:-0}" -v es="${exact_search:-0}" -v ee="${exact_eca:-0}" \
+        -v name="$name" -v epsilon="$epsilon" 'BEGIN {
+      printf "%s,%s,%d,%.6f,%.9f,%.9f,%.3f,%.3f,%.9f\n", name, epsilon, n, s, e, g,
+             (en > 0 ? n / en : 0), (es > 0 ? s / es : 0), ee - e
+    }' >> "$OUTPUT"
+    echo " $nodes nodes, ECA $eca, gap $gap"
+  done
+done
+rm -f "$RECORD" "$STATS"
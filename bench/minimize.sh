@@ -0,0 +1,72 @@
+#!/bin/sh
+# SDD size over the search with and without in-search vtree minimization
+# (run by `make bench-minimize`).
+#
+# usage: bench/minimize.sh [-d DIR] [-g GROWTH] [-o OUTPUT] [EXAMPLE...]
+#  EXAMPLE      example names, e.g. bupa (default: anatomy bupa heart ident pima)
+#  -d DIR       directory of the examples (default: examples)
+#  -g GROWTH    value of --minimize-growth (default: 1.1)
+#  -o OUTPUT    CSV file (default: bench/out/minimize.csv)
+# Each example runs once without and once with --minimize-growth GROWTH.
+# OUTPUT receives the nodes expanded, the search and move times, the
+# minimizations and their time, and the mean and peak live size of the SDD
+# over the samples of --stats-json.
+
+TRIM=${TRIM:-build/trim}
+DIR=examples
+GROWTH=1.1
+OUTPUT=bench/out/minimize.csv
+while getopts "d:g:o:" option; do
+  case $option in
+    d) DIR=$OPTARG ;;
+    g) GROWTH=$OPTARG ;;
+    o) OUTPUT=$OPTARG ;;
+    *) exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+EXAMPLES=${*:-anatomy bupa heart ident pima}
+
+if [ ! -x "$TRIM" ]; then
+  echo "trim binary $TRIM not found; run make first" >&2
+  exit 1
+fi
+OUT_DIR=$(dirname "$OUTPUT")
+mkdir -p "$OUT_DIR"
+STATS=$OUT_DIR/stats.json
+
+# Value of a numeric field of the --stats-json output
+json_field() {
+  sed -n "s/^ *\"$1\": \([-0-9.e+]*\),*$/\1/p" "$STATS"
+}
+
+# Value of a field of the "seconds" object of the --stats-json output
+json_seconds() {
+  sed -n "s/^ *\"seconds\": {.*\"$1\": \([0-9.]*\).*$/\1/p" "$STATS"
+}
+
+echo "example,growth,nodes_expanded,search_s,move_s,minimizations,minimize_s,mean_live_size,peak_live_size" > "$OUTPUT"
+for name in $EXAMPLES; do
+  for growth in 0 "$GROWTH"; do
+    printf "%s growth %s..." "$name" "$growth"
+    args=
+    [ "$growth" != 0 ] && args="--minimize-growth $growth"
+    if ! "$TRIM" --no-naive-bayes --stats-json "$STATS" $args \
+         -c "$DIR/$name.net.cnf" -l "$DIR/$name.net.lmap" -e "$DIR/$name.net.search" \
+         > "$OUT_DIR/$name-minimize-$growth.log" 2>&1; then
+      echo "failed (see $OUT_DIR/$name-minimize-$growth.log)"
+      exit 1
+    fi
+    nodes=$(json_field nodes_expanded)
+    minimizations=$(json_field minimizations)
+    minimize=$(json_field minimize_seconds)
+    search=$(json_seconds search)
+    move=$(json_seconds move)
+    sizes=$(sed -n 's/.*"live_size": \([0-9]*\).*/\1/p' "$STATS" | awk '
+      { sum += $1; if ($1 > peak) peak = $1 }
+      END { printf "%.1f,%d", (NR > 0 ? sum / NR : 0), peak }')
+    echo "$name,$growth,$nodes,$search,$move,$minimizations,$minimize,$sizes" >> "$OUTPUT"
+    echo " $nodes nodes, $minimizations minimizations, live size (mean,peak) $sizes"
+  done
+done
+rm -f "$STATS"
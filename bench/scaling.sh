@@ -0,0 +1,81 @@
+#!/bin/sh
+# Scaling benchmark over generated networks (run by `make bench-scaling`).
+#
+# usage: bench/scaling.sh [-k "STRUCTURE..."] [-n "SIZES"] [-s SEED] [-r REPS]
+#                         [-b BASELINE] [-t TOLERANCE] [-u]
+#  -k  structures passed to netgen -k (default: "nb tan dag")
+#  -n  numbers of features (default: "6 8 10")
+#  -s  seed of netgen (default: 1)
+#  -r, -b, -t, -u  as for bench/bench.sh (default baseline:
+#                  bench/scaling_baseline.csv)
+# For each structure and size, netgen writes bench/out/scaling/STRUCTURE-SIZE
+# with arities 2-3 and costs 1-2, and bench/bench.sh runs and compares them.
+# The growth of each phase time and of the SDD size per added feature is
+# printed afterwards. The constrained SDD, and with it the constrain and
+# search phases, grows exponentially with the number of features; a
+# regression shows as a larger factor than in the baseline.
+
+NETGEN=${NETGEN:-build/netgen}
+STRUCTURES="nb tan dag"
+SIZES="6 8 10"
+SEED=1
+BENCH_ARGS=
+BASELINE=bench/scaling_baseline.csv
+while getopts "k:n:s:r:b:t:u" option; do
+  case $option in
+    k) STRUCTURES=$OPTARG ;;
+    n) SIZES=$OPTARG ;;
+    s) SEED=$OPTARG ;;
+    r|t) BENCH_ARGS="$BENCH_ARGS -$option $OPTARG" ;;
+    b) BASELINE=$OPTARG ;;
+    u) BENCH_ARGS="$BENCH_ARGS -u" ;;
+    *) exit 1 ;;
+  esac
+done
+
+if [ ! -x "$NETGEN" ]; then
+  echo "netgen binary $NETGEN not found; run make first" >&2
+  exit 1
+fi
+OUT_DIR=bench/out/scaling
+rm -rf "$OUT_DIR"
+mkdir -p "$OUT_DIR"
+EXAMPLES=
+for structure in $STRUCTURES; do
+  for n in $SIZES; do
+    "$NETGEN" -k "$structure" -n "$n" -a 2-3 -c 1-2 -s "$SEED" \
+              -o "$OUT_DIR/$structure-$n" > /dev/null || exit 1
+    EXAMPLES="$EXAMPLES $structure-$n"
+  done
+done
+
+# shellcheck disable=SC2086
+bench/bench.sh -d "$OUT_DIR" -o "$OUT_DIR" -b "$BASELINE" $BENCH_ARGS $EXAMPLES
+status=$?
+
+echo
+echo "growth per added feature (between consecutive sizes):"
+awk -F, '
+  NR == 1 { next }
+  {
+    split($1, parts, "-"); structure = parts[1]; n = parts[2]
+    if (structure == last) {
+      d = n - last_n
+      line = sprintf("  %-4s %3d -> %-3d", structure, last_n, n)
+      for (i = 4; i <= 8; i++) {
+        if (last_value[i] > 0 && $i > 0) {
+          line = line sprintf(" %s x%.2f", substr(names[i], 1, length(names[i]) - 2),
+                              exp(log($i / last_value[i]) / d))
+        }
+      }
+      line = line sprintf(" sdd_size x%.2f", exp(log($10 / last_value[10]) / d))
+      print line
+    }
+    last = structure; last_n = n
+    for (i = 3; i <= NF; i++) last_value[i] = $i
+  }
+  BEGIN {
+    names[4] = "compile_s"; names[5] = "minimize_s"; names[6] = "constrain_s"
+    names[7] = "search_s"; names[8] = "total_s"
+  }' "$OUT_DIR/summary.csv"
+exit $status
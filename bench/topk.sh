@@ -0,0 +1,72 @@
+#!/bin/sh
+# Cost of --top-k on the examples (run by `make bench-topk`).
+#
+# usage: bench/topk.sh [-d DIR] [-k "KS"] [-o OUTPUT] [EXAMPLE...]
+#  EXAMPLE      example names, e.g. bupa (default: anatomy bupa heart ident pima)
+#  -d DIR       directory of the examples (default: examples)
+#  -k KS        values of --top-k (default: "1 2 5 10 20")
+#  -o OUTPUT    CSV file (default: bench/out/topk.csv)
+# Each example runs once per k. OUTPUT receives the nodes expanded, the
+# search time, the number of subsets kept and the k-th best ECA of each run,
+# and the nodes and time relative to the search for the best subset only
+# (k 1, which must come first).
+
+TRIM=${TRIM:-build/trim}
+DIR=examples
+KS="1 2 5 10 20"
+OUTPUT=bench/out/topk.csv
+while getopts "d:k:o:" option; do
+  case $option in
+    d) DIR=$OPTARG ;;
+    k) KS=$OPTARG ;;
+    o) OUTPUT=$OPTARG ;;
+    *) exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+EXAMPLES=${*:-anatomy bupa heart ident pima}
+
+if [ ! -x "$TRIM" ]; then
+  echo "trim binary $TRIM not found; run make first" >&2
+  exit 1
+fi
+OUT_DIR=$(dirname "$OUTPUT")
+mkdir -p "$OUT_DIR"
+STATS=$OUT_DIR/stats.json
+
+# Value of a numeric field of the --stats-json output
+json_field() {
+  sed -n "s/^ *\"$1\": \([-0-9.e+]*\),*$/\1/p" "$STATS"
+}
+
+echo "example,k,nodes_expanded,search_s,kept,kth_eca,nodes_ratio,search_ratio" > "$OUTPUT"
+for name in $EXAMPLES; do
+  best_nodes=; best_search=
+  for k in $KS; do
+    printf "%s top-k %s..." "$name" "$k"
+    if ! "$TRIM" --no-naive-bayes --stats-json "$STATS" --top-k "$k" \
+         -c "$DIR/$name.net.cnf" -l "$DIR/$name.net.lmap" -e "$DIR/$name.net.search" \
+         > "$OUT_DIR/$name-top$k.log" 2>&1; then
+      echo "failed (see $OUT_DIR/$name-top$k.log)"
+      exit 1
+    fi
+    nodes=$(json_field nodes_expanded)
+    search=$(sed -n 's/.*"search": \([0-9.]*\).*/\1/p' "$STATS")
+    if [ "$k" = 1 ]; then
+      kept=1
+      eca=$(json_field best_eca)
+      best_nodes=$nodes; best_search=$search
+    else
+      kept=$(grep -c '"eca":' "$STATS")
+      eca=$(sed -n 's/.*"eca": \([0-9.]*\).*/\1/p' "$STATS" | tail -n 1)
+    fi
+    awk -v n="$nodes" -v s="$search" -v kept="$kept" -v e="$eca" \
+        -v bn="${best_nodes:-0}" -v bs="${best_search:-0}" \
+        -v name="$name" -v k="$k" 'BEGIN {
+      printf "%s,%s,%d,%.6f,%d,%.9f,%.3f,%.3f\n", name, k, n, s, kept, e,
+             (bn > 0 ? n / bn : 0), (bs > 0 ? s / bs : 0)
+    }' >> "$OUTPUT"
+    echo " $nodes nodes, $kept kept, k-th ECA $eca"
+  done
+done
+rm -f "$STATS"
@@ -0,0 +1,43 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sddapi.h"
+
+// Capacity of the blocks of an arena, unless a push needs a larger one
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+typedef struct ArenaBlock {
+  struct ArenaBlock* next;
+  size_t capacity;
+  size_t used;
+} ArenaBlock;
+
+// Stack allocator: pushes take memory from the current block, and pops return
+// to a mark. Blocks are kept after a pop and reused by later pushes, so that
+// once the arena has grown to the deepest use, pushes make no allocator calls.
+// A zeroed Arena is empty and ready to use.
+typedef struct {
+  ArenaBlock* first;
+  ArenaBlock* current;
+  SddSize block_allocations; // Blocks allocated (malloc calls) so far
+  size_t capacity;          // Of all blocks, in bytes
+} Arena;
+
+typedef struct {
+  ArenaBlock* block;
+  size_t used;
+} ArenaMark;
+
+/****************************************************************************************
+ * forward references
+ ****************************************************************************************/
+
+void* arena_push(Arena* arena, const size_t size);
+void* arena_push_zero(Arena* arena, const size_t size);
+ArenaMark arena_mark(Arena* arena);
+void arena_pop(Arena* arena, const ArenaMark mark);
+void arena_free(Arena* arena);
+
+#endif // ARENA_H_
@@ -0,0 +1,48 @@
+#ifndef BOUNDCACHE_H_
+#define BOUNDCACHE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "search.h"
+
+// Kinds of values in a bound cache
+#define BOUND_CACHE_MPA 0   // MPA of a Y set: a bound on the ECA of its subsets
+#define BOUND_CACHE_ECA 1   // ECA of a subset
+
+// Values of a search problem that do not depend on the costs and the budget,
+// by set of features. Entries are appended and never removed; a hash table of
+// entry indices finds them.
+typedef struct {
+  SddSize num_features;
+  SddSize words;            // subset_words(num_features)
+  uint64_t problem;         // bound_cache_problem of the search problem
+
+  SddSize count;            // Entries
+  SddSize loaded;           // Of these, read from the file
+  SddSize entry_capacity;
+  SubsetWord* sets;         // Set of entry i at sets + i * words
+  unsigned char* kinds;     // BOUND_CACHE_MPA or BOUND_CACHE_ECA
+  SddWmc* values;
+
+  SddSize capacity;         // Slots, a power of 2
+  SddSize* slots;           // Entry index + 1 (0 for an empty slot)
+} BoundCache;
+
+/****************************************************************************************
+ * forward references
+ ****************************************************************************************/
+
+uint64_t bound_cache_problem(SearchData* data, Fnf* fnf, const int decision);
+BoundCache* bound_cache_load(const char* filename, SearchData* data, Fnf* fnf,
+                             const int decision);
+void bound_cache_save(BoundCache* cache, const char* filename);
+void bound_cache_free(BoundCache* cache);
+int bound_cache_get(const BoundCache* cache, const int kind, const SubsetWord* set,
+                    SddWmc* value);
+void bound_cache_put(BoundCache* cache, const int kind, const SubsetWord* set,
+                     const SddWmc value);
+
+#endif // BOUNDCACHE_H_
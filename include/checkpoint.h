@@ -0,0 +1,27 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sddapi.h"
+#include "search.h"
+
+// Frontier depth of a checkpoint written after the search completed
+#define CHECKPOINT_COMPLETE -1
+
+// Seconds between checkpoints, unless --checkpoint-interval is given
+#define CHECKPOINT_DEFAULT_INTERVAL 60.0
+
+/****************************************************************************************
+ * forward references
+ ****************************************************************************************/
+
+void save_checkpoint_sdd(const char* filename, SddNode* node, SddManager* manager);
+SddNode* load_checkpoint_sdd(const char* filename, SddManager** manager);
+void write_checkpoint(const char* filename, SearchData* data, SearchResult* result,
+                      const SubsetWord* path, const int depth,
+                      const double search_seconds);
+int read_checkpoint(const char* filename, SearchData* data, SearchResult* result,
+                    SubsetWord* path, double* search_seconds);
+
+#endif // CHECKPOINT_H_
@@ -0,0 +1,39 @@
+#ifndef CLASSIFY_H_
+#define CLASSIFY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "search.h"
+
+// Rows of evidence over features, as read from a CSV file
+typedef struct {
+  SddSize row_count;
+  int column_count;
+  int* column_feature;      // Feature index of each column
+  int* column_first;        // Index of the first indicator of the column's
+                            // node among those of its feature (0 unless the
+                            // feature is a group)
+  int* column_arity;        // Indicators of the column's node
+  int* values;              // values[r * column_count + c] is the value (state
+                            // index) of column c in row r, -1 if unobserved
+} Dataset;
+
+typedef struct {
+  const char* output_filename; // Decisions are written here (NULL for none)
+  int num_threads;
+  int esdp_mode;            // ESDP_LIBRARY: WmcManager per row,
+                            // ESDP_COMPARE: both, otherwise blocks of rows
+} ClassifyOptions;
+
+/****************************************************************************************
+ * forward references
+ ****************************************************************************************/
+
+Dataset* read_dataset(const char* filename, SearchData* data);
+void free_dataset(Dataset* dataset);
+void classify_dataset(SearchData* data, Fnf* fnf, SddCompilerOptions* options,
+                      Dataset* dataset, ClassifyOptions* classify_options);
+
+#endif // CLASSIFY_H_
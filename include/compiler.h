@@ -77,6 +77,11 @@ typedef struct {
 typedef Fnf Cnf;
 typedef Fnf Dnf;
 
+// If set, fnf_to_sdd calls this every FNF_CHECK_PERIOD clauses, with the
+// partial SDD referenced, and returns NULL if it returns nonzero
+#define FNF_CHECK_PERIOD 64
+extern int (*fnf_to_sdd_check)(SddManager* manager);
+
 /****************************************************************************************
  * function declaration
  ****************************************************************************************/
@@ -0,0 +1,139 @@
+#ifndef ESDP_H_
+#define ESDP_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sddapi.h"
+
+// Node types of a flattened SDD
+#define ESDP_FALSE 0
+#define ESDP_TRUE 1
+#define ESDP_LITERAL 2
+#define ESDP_DECISION 3
+
+// Regions of a constrained vtree, relative to the Y- and XY-constrained nodes
+// of its right-most path
+#define ESDP_REGION_P 0   // feature subtrees above the XY-constrained node
+#define ESDP_REGION_Y 1   // right-most path above the Y-constrained node
+#define ESDP_REGION_X 2   // right-most path from Y- down to XY-constrained node
+#define ESDP_REGION_Z 3   // XY-constrained node and below
+
+// Map to indices, with open addressing. 0 is not a valid key.
+typedef struct {
+  SddSize count;
+  SddSize capacity;         // power of 2
+  size_t* keys;             // 0 for empty slots
+  SddSize* values;
+} IndexMap;
+
+// Thresholds of esdp_compute_mpa_batch are processed in vectors of this many
+#define ESDP_BATCH_WIDTH 8
+
+// A vtree, indexed by the positions of its nodes
+typedef struct {
+  SddLiteral count;
+  SddLiteral* lo;           // Position of the left-most leaf below
+  SddLiteral* hi;           // Position of the right-most leaf below
+  SddLiteral* parent;       // -1 for the root
+  SddLiteral* left;         // -1 for leaves
+  SddLiteral* right;
+  char* on_spine;           // On the right-most path of the vtree
+  long double* total;       // Product of (w(x) + w(-x)) over variables below.
+                            // Extended precision, since gaps are ratios of these
+  SddLiteral* var_position; // Position of the leaf of each variable
+} EsdpVtree;
+
+// Values of evaluated SDD nodes, by node index
+typedef struct {
+  char* region;
+  SddLiteral* vtree;        // Vtree position, -1 for constants
+  SddWmc* w;                // Weighted model count
+  SddWmc* wd;               // Weighted model count with the decision
+  SddWmc* a1;               // X region: weight of models classified positive,
+  SddWmc* a0;               // and negative. Y region: ECA and MPA.
+} EsdpValues;
+
+// The SDD reachable from a root, flattened in topological order (children
+// before parents) into a structure of arrays, together with the vtree it is
+// normalized for
+typedef struct {
+  EsdpVtree vtree;
+
+  // nodes
+  SddSize node_count;
+  char* type;               // ESDP_FALSE, ESDP_TRUE, ESDP_LITERAL, ESDP_DECISION
+  SddLiteral* literal;      // Literal of literal nodes
+  SddSize* elem_begin;      // Elements of node i are elem_begin[i..i+1)
+
+  // elements
+  SddSize elem_count;
+  SddSize* children;        // Node indices of prime and sub of element k at
+                            // 2k and 2k+1
+  SddWmc* gaps;             // Weight of variables of the left (right) vtree
+                            // child that the prime (sub) skips
+
+  // per-call values
+  EsdpValues values;
+
+  SddWmc* literal_weights;
+} EsdpEvaluator;
+
+// Values of SDD nodes kept across calls, for a fixed decision and threshold.
+// Entries are keyed by sdd_id and are reused as long as their node is not
+// garbage collected and it is evaluated in the same region. Values are over
+// the variables of the vtree of the node; they are rescaled when variables
+// that the node does not mention enter or leave that vtree.
+typedef struct {
+  EsdpVtree vtree;
+  SddLiteral decision;
+  SddWmc threshold;
+  SddWmc* literal_weights;
+
+  IndexMap map;             // sdd_id + 1 -> entry
+
+  // entries
+  SddSize entry_count;
+  SddSize entry_capacity;
+  SddSize sweep_count;      // Sweep garbage collected nodes at this many entries
+  SddNode** node;
+  SddSize* id;
+  SddSize* epoch;           // Call in which the entry was last visited
+  long double* total;       // Vtree total that the values are relative to
+  EsdpValues values;
+
+  // scratch: child indices and gaps of elements of nodes being evaluated
+  SddSize stack_count;
+  SddSize stack_capacity;
+  SddSize* stack_children;
+  SddWmc* stack_gaps;
+
+  // statistics
+  SddSize cur_epoch;        // Number of calls
+  SddSize visited;          // Decision nodes visited, over all calls
+  SddSize recomputed;       // Decision nodes recomputed, over all calls
+  double recomputed_fraction; // Sum over calls of recomputed / SDD node count
+} EsdpCache;
+
+/****************************************************************************************
+ * forward references
+ ****************************************************************************************/
+
+EsdpEvaluator* esdp_evaluator_new(SddNode* node, SddManager* manager,
+                                  SddWmc* literal_weights);
+void esdp_evaluator_free(EsdpEvaluator* evaluator);
+SddWmc esdp_compute_mpa(EsdpEvaluator* evaluator, SddLiteral d, SddWmc T,
+                        SddLiteral xy_pos, SddLiteral y_pos, SddWmc* eca);
+void esdp_compute_mpa_batch(EsdpEvaluator* evaluator, SddLiteral d,
+    const SddWmc* thresholds, SddSize num_thresholds,
+    SddLiteral xy_pos, SddLiteral y_pos, SddWmc* mpa, SddWmc* eca);
+const char* esdp_batch_kernel_name();
+int esdp_select_batch_kernel(const char* name);
+
+EsdpCache* esdp_cache_new(SddManager* manager, SddWmc* literal_weights,
+                          SddLiteral d, SddWmc T);
+void esdp_cache_free(EsdpCache* cache);
+void esdp_cache_shrink(EsdpCache* cache);
+SddWmc esdp_compute_mpa_incremental(EsdpCache* cache, SddNode* node,
+    SddManager* manager, SddLiteral xy_pos, SddLiteral y_pos, SddWmc* eca);
+
+#endif // ESDP_H_
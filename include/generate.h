@@ -0,0 +1,47 @@
+#ifndef GENERATE_H_
+#define GENERATE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "network.h"
+
+// Structures of generated classifiers
+#define GENERATE_NB 0       // class -> each feature
+#define GENERATE_TAN 1      // naive Bayes, plus a random tree over the features
+#define GENERATE_DAG 2      // random DAG over the class and the features, with
+                            // the class a parent of the features after it
+
+typedef struct {
+  int structure;            // GENERATE_NB, GENERATE_TAN or GENERATE_DAG
+  int num_features;
+  int min_arity;            // Number of states of each feature, drawn
+  int max_arity;            // uniformly from [min_arity, max_arity]
+  int max_parents;          // GENERATE_DAG: at most this many parents per node,
+                            // besides the class
+  double min_cost;          // Cost of each feature, drawn uniformly from
+  double max_cost;          // [min_cost, max_cost] and rounded to 0.1
+  double budget;            // <= 0: a quarter of the total cost
+  double threshold;         // Decision threshold
+  int exchangeable_group;   // Features in consecutive groups of this size
+                            // share arity, cost and, with equal parents, CPT
+  uint64_t seed;
+} GeneratorOptions;
+
+/****************************************************************************************
+ * forward references
+ ****************************************************************************************/
+
+BayesNet* generate_bayes_net(const GeneratorOptions* options, double** costs);
+void write_hugin_net(const BayesNet* bn, const char* filename);
+void write_cnf(const Fnf* fnf, const char* filename);
+void write_lmap(const BayesNet* bn, const size_t var_count,
+    char** sorted_node_names, SddLiteral** sorted_node_indicators,
+    SddSize* sorted_node_num_indicators, const SddWmc* weights,
+    const char* filename);
+void write_search_problem(const BayesNet* bn, const double* costs,
+    const GeneratorOptions* options, const char* filename);
+
+#endif // GENERATE_H_
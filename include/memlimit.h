@@ -0,0 +1,39 @@
+#ifndef MEMLIMIT_H_
+#define MEMLIMIT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sddapi.h"
+
+// Levels of memory use relative to a limit
+#define MEMLIMIT_OK 0
+#define MEMLIMIT_TIGHT 1    // above MEMLIMIT_SOFT_FRACTION of the limit
+#define MEMLIMIT_STOP 2     // at or above the limit
+
+#define MEMLIMIT_SOFT_FRACTION 0.75
+
+// Vtree operation memory limit of the manager once memory is tight
+#define MEMLIMIT_TIGHT_OPERATION_LIMIT 1.1
+
+// Process memory checked against a limit
+typedef struct {
+  size_t limit_kb;          // 0 for no limit
+  int level;                // MEMLIMIT_OK, MEMLIMIT_TIGHT or MEMLIMIT_STOP
+  SddSize degradations;     // Times memory became tight
+  size_t rss_kb;            // At the last check
+  size_t peak_rss_kb;       // Over all checks
+  SddSize manager_size;     // sdd_manager_size at the last check
+  SddSize manager_live_size; // sdd_manager_live_size at the last check
+} MemoryBudget;
+
+/****************************************************************************************
+ * forward references
+ ****************************************************************************************/
+
+size_t current_rss_kb();
+size_t process_peak_rss_kb();
+void memory_budget_init(MemoryBudget* budget, const size_t limit_kb);
+int memory_budget_check(MemoryBudget* budget, SddManager* manager);
+void memory_budget_release();
+
+#endif // MEMLIMIT_H_
@@ -0,0 +1,53 @@
+#ifndef NAIVEBAYES_H_
+#define NAIVEBAYES_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "search.h"
+
+// Largest number of joint instantiations of the features that the naive
+// Bayes engine tabulates; larger problems are searched on the SDD
+#define NAIVE_BAYES_MAX_INSTANTIATIONS (1 << 22)
+
+// A classifier whose CNF factors into the decision node and one factor per
+// other node on it and the decision node (naive Bayes, possibly with hidden
+// children, fixed nodes and feature groups), with its features tabulated:
+// the weight of class h with feature values z is
+//   prior[h] * table[0][z_0][h] * ... * table[n-1][z_n-1][h]
+typedef struct {
+  SddSize num_features;
+  SddSize num_classes;      // States of the decision node
+  SddSize size;             // Joint instantiations of the features
+  SddSize* arity;           // Values of each feature (product over its nodes)
+  SddSize* stride;          // Of each feature in the index z of an
+                            // instantiation; the last feature varies fastest
+  SddWmc* prior;            // Of each class, with hidden and fixed nodes
+                            // summed out
+  SddWmc** table;           // table[j][v * num_classes + h]
+  SddWmc* sums;             // sums[j * num_classes + h]: table[j] summed over v
+  int* decision_class;      // Class of each decision of the search data
+
+  // Of a search, by naive_bayes_prepare
+  SddWmc* weight;           // Weight of each instantiation
+  SddWmc total;             // Their sum
+  unsigned char* positive;  // positive[k * size + z]: instantiation z is
+                            // classified positive by decision k
+  SddSize* offsets;         // Scratch: indices of instantiations of X
+  int* y_features;          // Scratch: features of Y
+  SddWmc* class_weights;    // Scratch: (num_features + 2) * num_classes
+} NaiveBayes;
+
+/****************************************************************************************
+ * forward references
+ ****************************************************************************************/
+
+NaiveBayes* naive_bayes_detect(SearchData* data, Fnf* fnf, const char** reason);
+void naive_bayes_prepare(NaiveBayes* nb, SearchData* data, const SddSize first,
+                         const SddSize count);
+SddWmc naive_bayes_mpa(NaiveBayes* nb, SearchData* data, const SddSize k,
+                       const SubsetWord* y_set, SddWmc* eca);
+void naive_bayes_free(NaiveBayes* nb);
+
+#endif // NAIVEBAYES_H_
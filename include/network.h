@@ -0,0 +1,38 @@
+#ifndef NETWORK_H_
+#define NETWORK_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sddapi.h"
+#include "compiler.h"
+
+typedef struct {
+  char* name;               // Node name, as referenced by .search files
+  int num_states;           // Number of values of the node
+  int num_parents;          // Number of parents
+  int* parents;             // Indices of parents in BayesNet.nodes
+  double* cpt;              // Conditional probability table. Parent
+                            // instantiations vary slowest (first parent most
+                            // significant) and node values vary fastest
+} BnNode;
+
+typedef struct {
+  int node_count;           // Number of network nodes
+  BnNode* nodes;            // Network nodes
+} BayesNet;
+
+/****************************************************************************************
+ * forward references
+ ****************************************************************************************/
+
+BayesNet* read_bayes_net(const char* filename);
+BayesNet* read_hugin_net(const char* filename);
+BayesNet* read_uai_net(const char* filename);
+void free_bayes_net(BayesNet* bn);
+
+Fnf* encode_bayes_net(const BayesNet* bn, const int skip_deterministic,
+    size_t* var_count, size_t* node_count, char*** sorted_node_names,
+    SddLiteral*** sorted_node_indicators, SddSize** sorted_node_num_indicators,
+    SddWmc** weights);
+
+#endif // NETWORK_H_
@@ -0,0 +1,25 @@
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sddapi.h"
+
+// Searches a shard in a worker process: fills the result_size bytes of
+// result, and returns 1 if the whole search must stop (e.g. at the memory
+// limit)
+typedef int (*ShardSearch)(const int shard, void* result, void* context);
+
+/****************************************************************************************
+ * forward references
+ ****************************************************************************************/
+
+SddWmc* shared_incumbent_new(const SddWmc value);
+void shared_incumbent_free(SddWmc* incumbent);
+SddWmc shared_incumbent_get(SddWmc* incumbent);
+void shared_incumbent_raise(SddWmc* incumbent, const SddWmc value);
+int run_shards(const int num_workers, const int num_shards, ShardSearch search,
+               void* context, void* results, const size_t result_size,
+               int* shards_per_worker);
+
+#endif // PARALLEL_H_
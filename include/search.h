@@ -3,11 +3,19 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include "sddapi.h"
+#include "compiler.h"
+#include "subset.h"
 
 typedef struct {
-  SddLiteral* indicators;
+  char* name;               // Network node name, or group name
+  SddLiteral* indicators;   // Of all its nodes, node by node
   SddSize num_indicators;
+  SddSize num_nodes;        // Network nodes selected together (1 unless the
+                            // feature is a group)
+  char** node_names;
+  SddSize* node_num_indicators;
 } Feature;
 
 typedef struct {
@@ -15,19 +23,165 @@ typedef struct {
   SddWmc* literal_weights;  // Weights of literals in the CNF encoding
 
   SddSize node_count;       // Number of network nodes
-  SddLiteral decision;      // Decision literal
+  SddLiteral decision;      // Decision literal (of the first decision)
   SddSize num_features;     // Total number of features
   Feature** features;       // Candidate features
 
-  SddWmc threshold;         // Decision threshold
+  SddWmc threshold;         // Decision threshold (of the first decision)
+  SddSize num_decisions;    // Decisions (d lines), each a state of a decision
+                            // node and a threshold on its probability
+  SddLiteral* decisions;    // Decision literal of each
+  SddWmc* thresholds;       // Threshold of each
+  char** decision_names;    // "node" or "node=state"
   float budget;             // Budget for feature subset selection
   float* costs;             // Costs associated with features
+  SubsetWord* always_included; // Features in every subset (always observed),
+                            // as a bitset
+
+  SddSize num_fixed_nodes;  // Network nodes fixed to a state, which the SDD
+                            // is conditioned on
+  SddSize num_fixed_literals;
+  SddLiteral* fixed_literals; // Indicators of their states, and the negated
+                            // indicators of the other states
 } SearchData;
 
+// E-SDP evaluators
+#define ESDP_LIBRARY 0      // compute_mpa of the sdd library
+#define ESDP_FLAT 1         // in-tree evaluator of esdp.h
+#define ESDP_COMPARE 2      // all; report differences and time per call
+#define ESDP_INCREMENTAL 3  // in-tree evaluator, reusing values across calls
+
+typedef struct {
+  int esdp_mode;            // E-SDP evaluator (ESDP_LIBRARY, ESDP_FLAT, ...)
+  int num_thresholds;       // Thresholds of the study of the best subset
+                            // after the search (0 for none)
+  size_t mem_limit_kb;      // Resident set size at which to stop (0 for none)
+  int symmetry;             // Skip branches symmetric under exchangeable
+                            // features (see symmetry.c)
+  double epsilon;           // Prune subtrees whose bound is below
+                            // (1 + epsilon) times the best ECA (0 for exact)
+  const char* checkpoint_file; // Checkpoints of the search (NULL for none)
+  double checkpoint_interval;  // Seconds between checkpoints
+  int resume;               // Continue the search of checkpoint_file
+  int num_workers;          // Worker processes of a sharded search (1 for a
+                            // serial search)
+  int shard_depth;          // Depth of the roots of shards (0 for automatic)
+  double minimize_growth;   // Minimize the vtree below the XY-constrained
+                            // node when the SDD grows by this factor during
+                            // the search (0 for never)
+  float vtree_time_limit;   // Limits of vtree minimization, for
+  float vtree_size_limit;   // sdd_manager_set_vtree_search_time_limit and
+  float vtree_memory_limit; // the operation size and memory limits (0 for
+                            // the defaults of the sdd library)
+  int cheap_bounds;         // Check bounds precomputed for single and pairs
+                            // of excluded features before the MPA bound
+  int top_k;                // Subsets to keep, best first (1 for the best
+                            // only); the search prunes against the k-th
+  const char* bound_cache_file; // MPAs and ECAs kept across searches of the
+                            // problem (NULL for none; see boundcache.c)
+  int decision;             // Decision to search for (-1 for all: the ECA of a
+                            // subset is then its mean ECA over the decisions)
+  int naive_bayes;          // Search a naive Bayes classifier without an SDD
+                            // (see naivebayes.c)
+  int budget_bound;         // Leave the unassigned features that the budget
+                            // left cannot afford out of the Y of the MPA bound
+} SearchOptions;
+
+// Classes of exchangeable features, each chained in ascending order of cost:
+// a subset that includes feature j must include requires[j]
+typedef struct {
+  int* requires;            // -1 for none
+  int* required_by;         // Inverse of requires (-1 for none)
+  int* class_of;            // Class of each feature (-1 for none)
+  int num_classes;
+  int num_constrained;      // Features with requires[j] >= 0
+} FeatureSymmetry;
+
+// SDD size at one point of the search
+typedef struct {
+  double seconds;           // Since the start of the search
+  SddSize nodes_expanded;
+  SddSize live_size;        // sdd_manager_live_size
+  SddSize live_count;       // sdd_manager_live_count
+} SddSizeSample;
+
+// Capacity of the samples array. When it is full, every other sample is
+// dropped and the sampling interval doubles.
+#define SEARCH_STATS_MAX_SAMPLES 512
+
+// Counters of the search phase
+typedef struct {
+  SddSize nodes_expanded;   // Search nodes within depth and budget
+  SddSize bound_evaluations; // MPA upper bounds computed
+  SddSize eca_evaluations;  // ECAs computed for candidate subsets
+  SddSize* prunes_by_depth; // Subtrees pruned by the bound, by depth
+                            // (num_features + 1 entries)
+  SddSize cheap_prunes;     // Of these, pruned by the precomputed bound
+  SddSize budget_cutoffs;   // Inclusions or subtrees skipped for cost
+  SddSize symmetry_skips;   // Inclusions or exclusions skipped as symmetric
+                            // to subsets already searched
+  SddSize incumbent_updates; // Improvements of the best subset
+  SddSize cache_hits;       // Bounds and ECAs taken from the bound cache
+  double esdp_seconds;      // Spent computing bounds and ECAs
+
+  // sdd_move_feature_to_pos
+  SddSize feature_moves;    // Calls
+  SddSize var_moves;        // Variables actually moved in the vtree
+  SddSize condition_calls;
+  SddSize apply_calls;      // sdd_conjoin and sdd_disjoin
+  SddSize gc_calls;
+  double move_seconds;
+
+  // Vtree minimization below the XY-constrained node (--minimize-growth)
+  SddSize minimizations;
+  SddSize minimize_size_before; // Summed over minimizations
+  SddSize minimize_size_after;
+  double minimize_seconds;
+
+  SddSize sample_count;
+  SddSizeSample* samples;
+  double sample_interval;   // Seconds between samples
+  struct timespec start;    // Start of the search
+} SearchStats;
+
+// The k best subsets of a search (--top-k). During the search, a min-heap
+// with the worst subset kept at index 0; after it, sorted best first.
+// Subsets are ordered by ECA, then by lower cost.
+typedef struct {
+  int k;                    // Capacity (0 if the search keeps only the best)
+  int count;
+  SddWmc* scores;
+  float* costs;
+  SubsetWord* subsets;      // Subset i at subsets + i * subset_words(...)
+} TopSubsets;
+
 typedef struct{
   SddWmc best_score;
-  char* best_subset;
+  SubsetWord* best_subset;  // Bitset of subset_words(num_features) words
   float cost;
+
+  // Wall time of each phase of the search, in seconds
+  double compile_seconds;   // fnf_to_sdd
+  double minimize_seconds;  // cardinality minimization
+  double constrain_seconds; // moving features to make the SDD constrained
+  double bounds_seconds;    // precomputing the cheap bounds
+  double search_seconds;
+  SddSize sdd_size;         // Size and node count of the SDD after the search
+  SddSize sdd_count;
+  const char* stop_reason;  // Why the search stopped early (NULL if it did
+                            // not); the result is then the best found so far
+  size_t peak_rss_kb;       // Peak resident set size of the process, at the
+                            // end of the search or when it stopped
+  double epsilon;           // SearchOptions.epsilon of the search
+  SddWmc max_pruned_bound;  // Largest bound of a subtree pruned by the bound:
+                            // no subset beats max(best_score, this)
+  TopSubsets top;           // With SearchOptions.top_k > 1
+  int decision;             // SearchOptions.decision of the search
+  const char* engine;       // "naive bayes" or "sdd" (see naivebayes.c)
+  const char* engine_reason; // Why the sdd was compiled instead (NULL with
+                            // the naive bayes engine)
+
+  SearchStats stats;
 } SearchResult;
 
 /****************************************************************************************
@@ -35,13 +189,25 @@ typedef struct{
  ****************************************************************************************/
 
 SearchData* read_search_data(const char* lmap_filename, const char* input_filename);
+SearchData* read_search_data_from_net(const char* net_filename,
+    const char* input_filename, const int skip_deterministic, Fnf** fnf);
 void free_search_data(SearchData* data);
 void print_search_data(SearchData* data);
 
 SearchResult* new_search_result(const SddSize num_features);
 void free_search_result(SearchResult* result);
 void update_search_result(SearchResult* result, const SddWmc new_score,
-                          const float new_cost, const char* new_subset,
+                          const float new_cost, const SubsetWord* new_subset,
                           const SddSize num_features);
+void keep_top_subsets(SearchResult* result, const int k, const SddSize num_features);
+void offer_top_subset(SearchResult* result, const SddWmc score, const float cost,
+                      const SubsetWord* subset, const SddSize num_features);
+void sort_top_subsets(SearchResult* result, const SddSize num_features);
+FeatureSymmetry* find_feature_symmetry(SearchData* data, Fnf* fnf);
+void free_feature_symmetry(FeatureSymmetry* symmetry);
+void print_feature_symmetry(SearchData* data, FeatureSymmetry* symmetry);
+SddWmc search_result_gap(SearchResult* result);
+void write_search_stats_json(const char* filename, const char* input_filename,
+                             SearchData* data, SearchResult* result);
 
 #endif // SEARCH_H_
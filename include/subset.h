@@ -0,0 +1,67 @@
+#ifndef SUBSET_H_
+#define SUBSET_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "sddapi.h"
+
+/****************************************************************************************
+ * feature subsets as bitsets: feature i is bit i % 64 of word i / 64, so
+ * subsets of up to 64 features take one word. Bits past the last feature
+ * are 0, so that counts, hashes and comparisons can work on whole words.
+ ****************************************************************************************/
+
+typedef uint64_t SubsetWord;
+
+#define SUBSET_WORD_BITS 64
+
+// Words of a subset of num_features features (at least one)
+static inline SddSize subset_words(const SddSize num_features) {
+  return num_features > 0 ? (num_features + SUBSET_WORD_BITS - 1) / SUBSET_WORD_BITS : 1;
+}
+
+static inline int subset_has(const SubsetWord* subset, const SddSize i) {
+  return (subset[i / SUBSET_WORD_BITS] >> (i % SUBSET_WORD_BITS)) & 1;
+}
+
+static inline void subset_add(SubsetWord* subset, const SddSize i) {
+  subset[i / SUBSET_WORD_BITS] |= (SubsetWord) 1 << (i % SUBSET_WORD_BITS);
+}
+
+static inline void subset_remove(SubsetWord* subset, const SddSize i) {
+  subset[i / SUBSET_WORD_BITS] &= ~((SubsetWord) 1 << (i % SUBSET_WORD_BITS));
+}
+
+static inline void subset_clear(SubsetWord* subset, const SddSize words) {
+  memset(subset, 0, words * sizeof(SubsetWord));
+}
+
+static inline void subset_copy(SubsetWord* to, const SubsetWord* from, const SddSize words) {
+  memcpy(to, from, words * sizeof(SubsetWord));
+}
+
+static inline int subset_equal(const SubsetWord* a, const SubsetWord* b,
+    const SddSize words) {
+  return memcmp(a, b, words * sizeof(SubsetWord)) == 0;
+}
+
+// Number of features in subset
+static inline SddSize subset_count(const SubsetWord* subset, const SddSize words) {
+  SddSize count = 0;
+  for (SddSize w = 0; w < words; w++) count += __builtin_popcountll(subset[w]);
+  return count;
+}
+
+// Hash of subset, for hash tables of subsets (FNV-1a over 64-bit words, with
+// the popcount mixed in)
+static inline size_t subset_hash(const SubsetWord* subset, const SddSize words) {
+  uint64_t h = 0xcbf29ce484222325ULL ^ subset_count(subset, words);
+  for (SddSize w = 0; w < words; w++) {
+    h ^= subset[w];
+    h *= 0x100000001b3ULL;
+    h ^= h >> 29;
+  }
+  return (size_t) h;
+}
+
+#endif // SUBSET_H_
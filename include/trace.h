@@ -0,0 +1,45 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+// Timeline of the phases of a run, written as Chrome trace events (load the
+// file in chrome://tracing or https://ui.perfetto.dev). Tracing is compiled
+// in with -DTRIM_TRACE (make TRACE=1) and recorded once trace_open has been
+// called; otherwise the TRACE_ macros compile to nothing.
+
+#ifdef TRIM_TRACE
+
+extern int trace_enabled;
+
+void trace_event(const char phase, const char* name, const char* category,
+                 const char* arg_name, const long arg);
+void trace_counter(const char* name, const char* series, const double value);
+
+#define TRACE_BEGIN(name, category) \
+  do { if (trace_enabled) trace_event('B', name, category, NULL, 0); } while (0)
+#define TRACE_BEGIN_ARG(name, category, arg_name, arg) \
+  do { if (trace_enabled) trace_event('B', name, category, arg_name, arg); } while (0)
+#define TRACE_END(name, category) \
+  do { if (trace_enabled) trace_event('E', name, category, NULL, 0); } while (0)
+#define TRACE_COUNTER(name, series, value) \
+  do { if (trace_enabled) trace_counter(name, series, value); } while (0)
+
+#else
+
+#define TRACE_BEGIN(name, category) ((void) 0)
+#define TRACE_BEGIN_ARG(name, category, arg_name, arg) ((void) 0)
+#define TRACE_END(name, category) ((void) 0)
+#define TRACE_COUNTER(name, series, value) ((void) 0)
+
+#endif // TRIM_TRACE
+
+// Clauses compiled between two trace events of fnf_to_sdd
+#define TRACE_CLAUSE_BATCH 64
+
+/****************************************************************************************
+ * forward references
+ ****************************************************************************************/
+
+int trace_open(const char* filename); // 0 if tracing is not compiled in
+void trace_close();
+
+#endif // TRACE_H_
@@ -0,0 +1,74 @@
+#ifndef TRIM_H_
+#define TRIM_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "search.h"
+
+/****************************************************************************************
+ * libtrim: feature subset search for programs that embed it (build/libtrim.a
+ * and build/libtrim.so; src/main.c is its client)
+ *
+ * A handle owns the parsed search problem, the SDD manager and the
+ * constrained SDD. The SDD is compiled once, by trim_compile or the first
+ * trim_search, and every later search of the handle only searches it, with
+ * the thresholds, budget and costs set at that time:
+ *
+ *   TrimHandle* handle = trim_open_net("heart.net", "heart.net.search", 0);
+ *   SearchOptions options = trim_default_search_options();
+ *   trim_set_budget(handle, 3);
+ *   SearchResult* result = trim_search(handle, &options);
+ *   ... result->best_score, subset_has(result->best_subset, i), result->stats ...
+ *   free_search_result(result);
+ *   trim_close(handle);
+ *
+ * With several d lines in the search file, a search is for all decisions
+ * (options.decision = -1, scoring a subset by its mean ECA over them) or for
+ * one of them; searches of one handle for each decision share its SDD.
+ *
+ * Limitations, as for the trim binary:
+ *  --invalid input files and options print an error and exit(1)
+ *  --progress is printed to stdout
+ *  --the library is not thread-safe. The search keeps its state (the arena,
+ *    the E-SDP caches, the memory budget, the checkpoint and cancellation
+ *    flags, the bound cache and the naive Bayes tables) in statics of
+ *    search.c, shared by all handles: one trim_search or trim_compile runs
+ *    at a time per process, and no two threads may call into libtrim at
+ *    once, even with different handles.
+ *    trim_cancel is the exception: it may be called from another thread or
+ *    a signal handler while a search runs
+ ****************************************************************************************/
+
+typedef struct TrimHandle TrimHandle;
+
+/****************************************************************************************
+ * forward references
+ ****************************************************************************************/
+
+TrimHandle* trim_open(const char* cnf_filename, const char* lmap_filename,
+                      const char* input_filename);
+TrimHandle* trim_open_net(const char* net_filename, const char* input_filename,
+                          const int skip_deterministic);
+void trim_close(TrimHandle* handle);
+
+SearchOptions trim_default_search_options();
+SddCompilerOptions* trim_compiler_options(TrimHandle* handle);
+int trim_compile(TrimHandle* handle, SearchOptions* options);
+SearchResult* trim_search(TrimHandle* handle, SearchOptions* options);
+void trim_cancel();
+
+void trim_set_threshold(TrimHandle* handle, const SddWmc threshold);
+void trim_set_budget(TrimHandle* handle, const float budget);
+int trim_set_cost(TrimHandle* handle, const int feature, const float cost);
+int trim_num_features(TrimHandle* handle);
+const char* trim_feature_name(TrimHandle* handle, const int feature);
+int trim_set_decision_threshold(TrimHandle* handle, const int decision,
+                                const SddWmc threshold);
+int trim_num_decisions(TrimHandle* handle);
+const char* trim_decision_name(TrimHandle* handle, const int decision);
+SearchData* trim_search_data(TrimHandle* handle);
+Fnf* trim_fnf(TrimHandle* handle);
+
+#endif // TRIM_H_
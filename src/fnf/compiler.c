@@ -6,6 +6,7 @@
 
 #include "sddapi.h"
 #include "compiler.h"
+#include "trace.h"
 
 /****************************************************************************************
  * this file contains the fnf-to-sdd compiler, with AUTO gc and sdd-minimize
@@ -13,6 +14,18 @@
 
 // local declarations
 SddNode* apply_litset(LitSet* litset, SddManager* manager);
+
+int (*fnf_to_sdd_check)(SddManager* manager) = NULL;
+
+// checks the compilation with fnf_to_sdd_check, if set. returns 1 to stop.
+static
+int stop_compilation(int i, SddNode* node, SddManager* manager) {
+  if(fnf_to_sdd_check==NULL || i==0 || i%FNF_CHECK_PERIOD!=0) return 0;
+  sdd_ref(node,manager);
+  int stop = fnf_to_sdd_check(manager);
+  sdd_deref(node,manager);
+  return stop;
+}
   
 /****************************************************************************************
  * compiles a cnf or dnf into an sdd
@@ -44,12 +57,15 @@ SddNode* fnf_to_sdd_auto(Fnf* fnf, SddManager* manager) {
   if(verbose) { printf("\nclauses: %ld ",count); fflush(stdout); }
   SddNode* node = ONE(manager,op);
   for(int i=0; i<count; i++) {
+    if(stop_compilation(i,node,manager)) { free(litsets); return NULL; }
+    if(i%TRACE_CLAUSE_BATCH==0) TRACE_BEGIN_ARG("clauses","compile","first",i);
     sort_litsets_by_lca(litsets+i,count-i,manager);
     sdd_ref(node,manager);
     SddNode* l = apply_litset(litsets[i],manager);
     sdd_deref(node,manager);
     node = sdd_apply(l,node,op,manager);
     if(verbose) { printf("%ld ",count-i-1); fflush(stdout); }
+    if((i+1)%TRACE_CLAUSE_BATCH==0 || i+1==count) TRACE_END("clauses","compile");
   }
   free(litsets);
   return node;
@@ -68,18 +84,23 @@ SddNode* fnf_to_sdd_manual(Fnf* fnf, SddManager* manager) {
   if(verbose) { printf("\nclauses: %ld ",count); fflush(stdout); }
   SddNode* node = ONE(manager,op);
   for(int i=0; i<count; i++) {
+    if(stop_compilation(i,node,manager)) { free(litsets); return NULL; }
     if(period > 0 && i > 0 && i%period==0) {
       // after every period clauses
       sdd_ref(node,manager);
       if(options->verbose) { printf("* "); fflush(stdout); }
+      TRACE_BEGIN("sdd_manager_minimize_limited","compile");
       sdd_manager_minimize_limited(manager);
+      TRACE_END("sdd_manager_minimize_limited","compile");
       sdd_deref(node,manager);
       sort_litsets_by_lca(litsets+i,count-i,manager);
     }
 
+    if(i%TRACE_CLAUSE_BATCH==0) TRACE_BEGIN_ARG("clauses","compile","first",i);
     SddNode* l = apply_litset(litsets[i],manager);
     node = sdd_apply(l,node,op,manager);
     if(verbose) { printf("%ld ",count-i-1); fflush(stdout); }
+    if((i+1)%TRACE_CLAUSE_BATCH==0 || i+1==count) TRACE_END("clauses","compile");
   }
   free(litsets);
   return node;
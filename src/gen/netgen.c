@@ -0,0 +1,133 @@
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "network.h"
+#include "generate.h"
+
+// forward references
+void free_fnf(Fnf* fnf);
+
+// Helper function: parse "LO" or "LO-HI" into a range
+static void parse_range(const char* str, double* lo, double* hi) {
+  char* end;
+  *lo = *hi = strtod(str, &end);
+  if (*end == '-') *hi = strtod(end + 1, &end);
+  if (*end != '\0' || *hi < *lo) {
+    fprintf(stderr, "Invalid range %s\n", str);
+    exit(1);
+  }
+}
+
+static void usage() {
+  fprintf(stderr,
+    "usage: netgen [-k nb|tan|dag] [-n FEATURES] [-a ARITY[-MAX]] [-c COST[-MAX]]\n"
+    "              [-b BUDGET] [-t THRESHOLD] [-p MAX_PARENTS] [-x GROUP] [-s SEED]\n"
+    "              -o PREFIX\n"
+    "Writes PREFIX.net, PREFIX.net.cnf, PREFIX.net.lmap and PREFIX.net.search\n");
+  exit(1);
+}
+
+/****************************************************************************************
+ * start
+ ****************************************************************************************/
+
+int main(int argc, char** argv) {
+  GeneratorOptions options = { GENERATE_NB, 20, 2, 2, 2, 1.0, 1.0, 0, 0.5, 1, 1 };
+  const char* prefix = NULL;
+  double lo, hi;
+  int option;
+  while ((option = getopt(argc, argv, "k:n:a:c:b:t:p:x:s:o:")) != -1) {
+    switch (option) {
+      case 'k':
+        if (strcmp(optarg, "nb") == 0) options.structure = GENERATE_NB;
+        else if (strcmp(optarg, "tan") == 0) options.structure = GENERATE_TAN;
+        else if (strcmp(optarg, "dag") == 0) options.structure = GENERATE_DAG;
+        else {
+          fprintf(stderr, "Unknown structure %s\n", optarg);
+          exit(1);
+        }
+        break;
+      case 'n':
+        options.num_features = atoi(optarg);
+        break;
+      case 'a':
+        parse_range(optarg, &lo, &hi);
+        options.min_arity = (int) lo;
+        options.max_arity = (int) hi;
+        break;
+      case 'c':
+        parse_range(optarg, &options.min_cost, &options.max_cost);
+        break;
+      case 'b':
+        options.budget = strtod(optarg, NULL);
+        break;
+      case 't':
+        options.threshold = strtod(optarg, NULL);
+        break;
+      case 'p':
+        options.max_parents = atoi(optarg);
+        break;
+      case 'x':
+        options.exchangeable_group = atoi(optarg);
+        break;
+      case 's':
+        options.seed = strtoull(optarg, NULL, 10);
+        break;
+      case 'o':
+        prefix = optarg;
+        break;
+      default:
+        usage();
+    }
+  }
+  if (prefix == NULL || options.num_features < 1 || options.min_arity < 2 ||
+      options.max_parents < 1 || options.min_cost <= 0 ||
+      options.exchangeable_group < 1) {
+    usage();
+  }
+
+  double* costs;
+  BayesNet* bn = generate_bayes_net(&options, &costs);
+  size_t var_count, node_count;
+  char** names;
+  SddLiteral** indicators;
+  SddSize* num_indicators;
+  SddWmc* weights;
+  Fnf* fnf = encode_bayes_net(bn, 0, &var_count, &node_count, &names, &indicators,
+                              &num_indicators, &weights);
+
+  size_t length = strlen(prefix) + 16;
+  char* filename = (char*) malloc(length);
+  snprintf(filename, length, "%s.net", prefix);
+  write_hugin_net(bn, filename);
+  snprintf(filename, length, "%s.net.cnf", prefix);
+  write_cnf(fnf, filename);
+  snprintf(filename, length, "%s.net.lmap", prefix);
+  write_lmap(bn, var_count, names, indicators, num_indicators, weights, filename);
+  snprintf(filename, length, "%s.net.search", prefix);
+  write_search_problem(bn, costs, &options, filename);
+  printf("%s: %d features, vars=%zu clauses=%"PRIsS"\n", prefix, options.num_features,
+         var_count, fnf->litset_count);
+
+  for (size_t k = 0; k < node_count; k++) {
+    free(names[k]);
+    free(indicators[k]);
+  }
+  free(names);
+  free(indicators);
+  free(num_indicators);
+  free(weights);
+  free(filename);
+  free(costs);
+  free_fnf(fnf);
+  free_bayes_net(bn);
+  return 0;
+}
+
+/****************************************************************************************
+ * end
+ ****************************************************************************************/
@@ -1,26 +1,72 @@
+#define _GNU_SOURCE
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <sys/resource.h>
 #include "sddapi.h"
 #include "compiler.h"
 #include "search.h"
+#include "classify.h"
+#include "trace.h"
+#include "trim.h"
 
-// forward references
-void free_fnf(Fnf* fnf);
-SearchResult* search_best_subset(SearchData* data, Fnf* fnf, SddCompilerOptions* options);
-
-SddCompilerOptions sdd_default_opt() {
-  SddCompilerOptions options = 
-    {
-    NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL, //file names
-    1,          // minimize cardinality
-    "balanced", // initial vtree type
-    -1,          // vtree search mode
-    0           // verbose
-    };
-  return options;
+// Append one line of run metrics to a CSV file (see bench/bench.sh):
+// problem file, wall time of each phase, peak RSS, final SDD size and count,
+// and best ECA
+static void write_bench_record(const char* filename, const char* input_filename,
+    const double parse_seconds, const double total_seconds, SearchResult* result) {
+  FILE* fp = fopen(filename, "a");
+  if (fp == NULL) {
+    fprintf(stderr, "Could not open benchmark file %s\n", filename);
+    exit(1);
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  fprintf(fp, "%s,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%ld,%"PRIsS",%"PRIsS",%.9f\n",
+          input_filename, parse_seconds, result->compile_seconds,
+          result->minimize_seconds, result->constrain_seconds,
+          result->search_seconds, total_seconds, usage.ru_maxrss,
+          result->sdd_size, result->sdd_count, result->best_score);
+  fclose(fp);
+}
+
+// Print the best subset of result, and the top subsets and optimality gap if
+// the search kept them
+static void print_search_result(SearchData* data, SearchResult* result,
+    SearchOptions* search_options) {
+  if (result->stop_reason != NULL && result->best_score <= 0) {
+    // stopped before any subset became a candidate: there is no best ECA
+    printf("\nsearch stopped early (%s), peak rss %zu KB, before any subset was "
+           "evaluated\n", result->stop_reason, result->peak_rss_kb);
+    return;
+  }
+  if (result->stop_reason != NULL) {
+    printf("\nsearch stopped early (%s), peak rss %zu KB; best found so far:",
+           result->stop_reason, result->peak_rss_kb);
+  }
+  printf("\nbest ECA: %f\nbest subset of features: ", result->best_score);
+  for (int i = 0; i < data->num_features; i++) {
+    printf("%d,", subset_has(result->best_subset, i));
+  }
+  if (result->top.k > 1) {
+    SddSize words = subset_words(data->num_features);
+    printf("\ntop %d subsets:", result->top.count);
+    for (int t = 0; t < result->top.count; t++) {
+      printf("\n %3d. ECA %f, cost %g: ", t + 1, result->top.scores[t], result->top.costs[t]);
+      for (int i = 0; i < data->num_features; i++) {
+        printf("%d,", subset_has(result->top.subsets + t * words, i));
+      }
+    }
+  }
+  if (search_options->epsilon > 0) {
+    SddWmc gap = search_result_gap(result);
+    printf("\noptimality gap: %f (best ECA <= %f, %.2f%% above the subset found; "
+           "epsilon %g)", gap, result->best_score + gap,
+           result->best_score > 0 ? 100 * gap / result->best_score : 0.0,
+           search_options->epsilon);
+  }
 }
 
 /****************************************************************************************
@@ -28,15 +74,49 @@ SddCompilerOptions sdd_default_opt() {
  ****************************************************************************************/
  
 int main(int argc, char** argv) {
-  Fnf* fnf;
-  SearchData* data;
-  SddCompilerOptions options = sdd_default_opt(); // default options
+  TrimHandle* handle;
+  SearchOptions search_options = trim_default_search_options();
+  ClassifyOptions classify_options = { NULL, 1, ESDP_INCREMENTAL };
 
   // Read input options
   char *cnf_filename = NULL, *lmap_filename = NULL, *input_filename = NULL;
+  char *net_filename = NULL, *dataset_filename = NULL, *bench_filename = NULL;
+  int skip_deterministic = 0, per_decision = 0;
   SddWmc threshold = -1.0;
+  char *stats_filename = NULL, *trace_filename = NULL;
+  // Options without a short form get codes above the character range
+  enum { OPTION_STATS_JSON = 256, OPTION_TRACE, OPTION_MEM_LIMIT, OPTION_NO_SYMMETRY,
+         OPTION_EPSILON, OPTION_CHECKPOINT, OPTION_CHECKPOINT_INTERVAL, OPTION_RESUME,
+         OPTION_WORKERS, OPTION_SHARD_DEPTH, OPTION_MINIMIZE_GROWTH, OPTION_VTREE_TIME_LIMIT,
+         OPTION_VTREE_SIZE_LIMIT, OPTION_VTREE_MEMORY_LIMIT, OPTION_CHEAP_BOUNDS,
+         OPTION_TOP_K, OPTION_BOUND_CACHE, OPTION_PER_DECISION,
+         OPTION_NO_NAIVE_BAYES, OPTION_NO_BUDGET_BOUND };
+  static struct option long_options[] = {
+    { "stats-json", required_argument, NULL, OPTION_STATS_JSON },
+    { "trace", required_argument, NULL, OPTION_TRACE },
+    { "mem-limit", required_argument, NULL, OPTION_MEM_LIMIT },
+    { "no-symmetry", no_argument, NULL, OPTION_NO_SYMMETRY },
+    { "epsilon", required_argument, NULL, OPTION_EPSILON },
+    { "checkpoint", required_argument, NULL, OPTION_CHECKPOINT },
+    { "checkpoint-interval", required_argument, NULL, OPTION_CHECKPOINT_INTERVAL },
+    { "resume", no_argument, NULL, OPTION_RESUME },
+    { "workers", required_argument, NULL, OPTION_WORKERS },
+    { "shard-depth", required_argument, NULL, OPTION_SHARD_DEPTH },
+    { "minimize-growth", required_argument, NULL, OPTION_MINIMIZE_GROWTH },
+    { "vtree-time-limit", required_argument, NULL, OPTION_VTREE_TIME_LIMIT },
+    { "vtree-size-limit", required_argument, NULL, OPTION_VTREE_SIZE_LIMIT },
+    { "vtree-memory-limit", required_argument, NULL, OPTION_VTREE_MEMORY_LIMIT },
+    { "cheap-bounds", no_argument, NULL, OPTION_CHEAP_BOUNDS },
+    { "top-k", required_argument, NULL, OPTION_TOP_K },
+    { "bound-cache", required_argument, NULL, OPTION_BOUND_CACHE },
+    { "per-decision", no_argument, NULL, OPTION_PER_DECISION },
+    { "no-naive-bayes", no_argument, NULL, OPTION_NO_NAIVE_BAYES },
+    { "no-budget-bound", no_argument, NULL, OPTION_NO_BUDGET_BOUND },
+    { NULL, 0, NULL, 0 }
+  };
   int option;
-  while ((option = getopt(argc, argv, "c:l:e:t:")) != -1) {
+  while ((option = getopt_long(argc, argv, "c:l:n:de:t:E:r:C:o:j:b:",
+                               long_options, NULL)) != -1) {
     switch (option) {
       case 'c':
         cnf_filename = optarg;
@@ -44,47 +124,257 @@ int main(int argc, char** argv) {
       case 'l':
         lmap_filename = optarg;
         break;
+      case 'n':
+        net_filename = optarg;
+        break;
+      case 'd':
+        skip_deterministic = 1;
+        break;
       case 'e':
         input_filename = optarg;
         break;
       case 't':
         threshold = strtof(optarg, NULL);
         break;
+      case 'E':
+        if (strcmp(optarg, "library") == 0) {
+          search_options.esdp_mode = ESDP_LIBRARY;
+        } else if (strcmp(optarg, "flat") == 0) {
+          search_options.esdp_mode = ESDP_FLAT;
+        } else if (strcmp(optarg, "incremental") == 0) {
+          search_options.esdp_mode = ESDP_INCREMENTAL;
+        } else if (strcmp(optarg, "compare") == 0) {
+          search_options.esdp_mode = ESDP_COMPARE;
+        } else {
+          fprintf(stderr, "Unknown E-SDP evaluator %s\n", optarg);
+          exit(1);
+        }
+        break;
+      case 'r':
+        search_options.num_thresholds = atoi(optarg);
+        break;
+      case 'C':
+        dataset_filename = optarg;
+        break;
+      case 'o':
+        classify_options.output_filename = optarg;
+        break;
+      case 'j':
+        classify_options.num_threads = atoi(optarg);
+        break;
+      case 'b':
+        bench_filename = optarg;
+        break;
+      case OPTION_STATS_JSON:
+        stats_filename = optarg;
+        break;
+      case OPTION_TRACE:
+        trace_filename = optarg;
+        break;
+      case OPTION_MEM_LIMIT: // in MB
+        search_options.mem_limit_kb = 1024 * strtoul(optarg, NULL, 10);
+        if (search_options.mem_limit_kb == 0) {
+          fprintf(stderr, "Invalid memory limit %s (MB)\n", optarg);
+          exit(1);
+        }
+        break;
+      case OPTION_NO_SYMMETRY:
+        search_options.symmetry = 0;
+        break;
+      case OPTION_CHEAP_BOUNDS:
+        search_options.cheap_bounds = 1;
+        break;
+      case OPTION_TOP_K:
+        search_options.top_k = atoi(optarg);
+        if (search_options.top_k < 1) {
+          fprintf(stderr, "Invalid number of subsets %s\n", optarg);
+          exit(1);
+        }
+        break;
+      case OPTION_BOUND_CACHE:
+        search_options.bound_cache_file = optarg;
+        break;
+      case OPTION_PER_DECISION:
+        per_decision = 1;
+        break;
+      case OPTION_NO_NAIVE_BAYES:
+        search_options.naive_bayes = 0;
+        break;
+      case OPTION_NO_BUDGET_BOUND:
+        search_options.budget_bound = 0;
+        break;
+      case OPTION_EPSILON:
+        search_options.epsilon = strtod(optarg, NULL);
+        if (search_options.epsilon < 0) {
+          fprintf(stderr, "Invalid epsilon %s\n", optarg);
+          exit(1);
+        }
+        break;
+      case OPTION_CHECKPOINT:
+        search_options.checkpoint_file = optarg;
+        break;
+      case OPTION_CHECKPOINT_INTERVAL: // in seconds
+        search_options.checkpoint_interval = strtod(optarg, NULL);
+        if (search_options.checkpoint_interval <= 0) {
+          fprintf(stderr, "Invalid checkpoint interval %s (seconds)\n", optarg);
+          exit(1);
+        }
+        break;
+      case OPTION_RESUME:
+        search_options.resume = 1;
+        break;
+      case OPTION_WORKERS:
+        search_options.num_workers = atoi(optarg);
+        if (search_options.num_workers < 1) {
+          fprintf(stderr, "Invalid number of workers %s\n", optarg);
+          exit(1);
+        }
+        break;
+      case OPTION_SHARD_DEPTH:
+        search_options.shard_depth = atoi(optarg);
+        if (search_options.shard_depth < 1) {
+          fprintf(stderr, "Invalid shard depth %s\n", optarg);
+          exit(1);
+        }
+        break;
+      case OPTION_MINIMIZE_GROWTH:
+        search_options.minimize_growth = strtod(optarg, NULL);
+        if (search_options.minimize_growth <= 1) {
+          fprintf(stderr, "Invalid growth factor %s (must be above 1)\n", optarg);
+          exit(1);
+        }
+        break;
+      case OPTION_VTREE_TIME_LIMIT: // in seconds
+        search_options.vtree_time_limit = strtof(optarg, NULL);
+        if (search_options.vtree_time_limit <= 0) {
+          fprintf(stderr, "Invalid vtree time limit %s (seconds)\n", optarg);
+          exit(1);
+        }
+        break;
+      case OPTION_VTREE_SIZE_LIMIT:
+        search_options.vtree_size_limit = strtof(optarg, NULL);
+        if (search_options.vtree_size_limit <= 0) {
+          fprintf(stderr, "Invalid vtree size limit %s\n", optarg);
+          exit(1);
+        }
+        break;
+      case OPTION_VTREE_MEMORY_LIMIT:
+        search_options.vtree_memory_limit = strtof(optarg, NULL);
+        if (search_options.vtree_memory_limit <= 0) {
+          fprintf(stderr, "Invalid vtree memory limit %s\n", optarg);
+          exit(1);
+        }
+        break;
       default:
         exit(1);
     }
   }
-  if (cnf_filename == NULL || lmap_filename == NULL || input_filename == NULL) {
+  if (input_filename == NULL || (net_filename == NULL &&
+      (cnf_filename == NULL || lmap_filename == NULL))) {
     fprintf(stderr,
-      "Must provide names of CNF, lmap, and feature selection input files\n");
+      "Must provide names of CNF and lmap files (or a network file), "
+      "and a feature selection input file\n");
+    exit(1);
+  }
+
+  if (search_options.resume && search_options.checkpoint_file == NULL) {
+    fprintf(stderr, "--resume needs the --checkpoint file to resume from\n");
+    exit(1);
+  }
+  if (search_options.num_workers > 1 && search_options.checkpoint_file != NULL) {
+    fprintf(stderr, "--checkpoint is not supported with --workers\n");
+    exit(1);
+  }
+  if (search_options.top_k > 1 &&
+      (search_options.num_workers > 1 || search_options.checkpoint_file != NULL)) {
+    fprintf(stderr, "--top-k is not supported with --workers or --checkpoint\n");
+    exit(1);
+  }
+
+  if (search_options.bound_cache_file != NULL && search_options.num_workers > 1) {
+    fprintf(stderr, "--bound-cache is not supported with --workers\n");
+    exit(1);
+  }
+  if (per_decision &&
+      (search_options.checkpoint_file != NULL || search_options.bound_cache_file != NULL)) {
+    fprintf(stderr, "--per-decision is not supported with --checkpoint or --bound-cache\n");
+    exit(1);
+  }
+
+  if (trace_filename != NULL && !trace_open(trace_filename)) {
+    fprintf(stderr, "Tracing is not compiled in (build with make TRACE=1)\n");
     exit(1);
   }
 
-  printf("\nreading cnf...");
-  fnf = read_cnf(cnf_filename);
-  printf("vars=%"PRIlitS" clauses=%"PRIsS"\n",fnf->var_count,fnf->litset_count);
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (net_filename != NULL) {
+    handle = trim_open_net(net_filename, input_filename, skip_deterministic);
+  } else {
+    handle = trim_open(cnf_filename, lmap_filename, input_filename);
+  }
+  SearchData* data = trim_search_data(handle);
 
-  printf("\nreading esdp search data...\n");
-  data = read_search_data(lmap_filename, input_filename);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double parse_seconds = (end.tv_sec - start.tv_sec) + 1e-9 * (end.tv_nsec - start.tv_nsec);
 
   // Overwrite threshold if explicitly given
   if (threshold > 0) {
-    data->threshold = threshold;
+    trim_set_threshold(handle, threshold);
   }
 
   print_search_data(data);
+
+  if (dataset_filename != NULL) {
+    // Classify the rows of a dataset instead of searching
+    printf("\nreading dataset..."); fflush(stdout);
+    Dataset* dataset = read_dataset(dataset_filename, data);
+    printf("rows=%"PRIsS" columns=%d\n", dataset->row_count, dataset->column_count);
+    classify_options.esdp_mode = search_options.esdp_mode;
+    classify_dataset(data, trim_fnf(handle), trim_compiler_options(handle), dataset,
+                     &classify_options);
+
+    printf("\nfreeing..."); fflush(stdout);
+    free_dataset(dataset);
+    trim_close(handle);
+    printf("done\n");
+    return 0;
+  }
   
-  SearchResult* result = search_best_subset(data, fnf, &options);
-  
-  printf("\nbest ECA: %f\nbest subset of features: ", result->best_score);
-  for (int i = 0; i < data->num_features; i++) {
-    printf("%d,", result->best_subset[i]);
+  // One search for all decisions, or with --per-decision one for each, over
+  // the same constrained SDD
+  int num_searches = per_decision ? trim_num_decisions(handle) : 1;
+  for (int k = 0; k < num_searches; k++) {
+    if (per_decision) {
+      search_options.decision = k;
+      printf("\nsearching for decision %s...\n", trim_decision_name(handle, k));
+    }
+    SearchResult* result = trim_search(handle, &search_options);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (bench_filename != NULL) {
+      double total_seconds = (end.tv_sec - start.tv_sec) +
+                             1e-9 * (end.tv_nsec - start.tv_nsec);
+      write_bench_record(bench_filename, input_filename, parse_seconds, total_seconds,
+                         result);
+    }
+    if (stats_filename != NULL && per_decision) {
+      // FILE.k for decision k
+      size_t length = strlen(stats_filename) + 16;
+      char* name = (char*) malloc(length);
+      snprintf(name, length, "%s.%d", stats_filename, k);
+      write_search_stats_json(name, input_filename, data, result);
+      free(name);
+    } else if (stats_filename != NULL) {
+      write_search_stats_json(stats_filename, input_filename, data, result);
+    }
+    if (per_decision) printf("\ndecision %s:", trim_decision_name(handle, k));
+    print_search_result(data, result, &search_options);
+    free_search_result(result);
   }
+  trace_close();
 
   printf("\nfreeing..."); fflush(stdout);
-  free_fnf(fnf);
-  free_search_data(data);
-  free_search_result(result);
+  trim_close(handle);
   printf("done\n"); 
 
   return 0;
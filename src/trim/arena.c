@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sddapi.h"
+#include "arena.h"
+
+/****************************************************************************************
+ * stack arena for the scratch memory of a search (see include/arena.h):
+ *  --a block is an ArenaBlock header followed by capacity bytes, and blocks
+ *    are chained in the order they are used
+ *  --pushes are rounded up to ARENA_ALIGN bytes, so every push is aligned
+ *    for any type of the search
+ ****************************************************************************************/
+
+#define ARENA_ALIGN 16
+
+static inline size_t arena_align(const size_t size) {
+  return (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+}
+
+#define ARENA_HEADER arena_align(sizeof(ArenaBlock))
+
+// Take size bytes from the arena, valid until a pop to an earlier mark
+void* arena_push(Arena* arena, const size_t size) {
+  size_t aligned = arena_align(size > 0 ? size : 1);
+  ArenaBlock* block = arena->current;
+  if (block == NULL || block->used + aligned > block->capacity) {
+    // Continue in the next block, or in a new one before it if it is too small
+    ArenaBlock* next = (block == NULL) ? arena->first : block->next;
+    if (next == NULL || next->capacity < aligned) {
+      size_t capacity = aligned > ARENA_BLOCK_SIZE ? aligned : ARENA_BLOCK_SIZE;
+      ArenaBlock* fresh = (ArenaBlock*) malloc(ARENA_HEADER + capacity);
+      if (fresh == NULL) {
+        fprintf(stderr, "Could not allocate arena block of %zu bytes\n", capacity);
+        exit(1);
+      }
+      fresh->capacity = capacity;
+      fresh->next = next;
+      if (block == NULL) arena->first = fresh;
+      else block->next = fresh;
+      arena->block_allocations++;
+      arena->capacity += capacity;
+      next = fresh;
+    }
+    next->used = 0;
+    arena->current = block = next;
+  }
+  void* memory = (char*) block + ARENA_HEADER + block->used;
+  block->used += aligned;
+  return memory;
+}
+
+void* arena_push_zero(Arena* arena, const size_t size) {
+  void* memory = arena_push(arena, size);
+  memset(memory, 0, size);
+  return memory;
+}
+
+ArenaMark arena_mark(Arena* arena) {
+  ArenaMark mark = { arena->current, arena->current != NULL ? arena->current->used : 0 };
+  return mark;
+}
+
+// Return all pushes since mark to the arena
+void arena_pop(Arena* arena, const ArenaMark mark) {
+  arena->current = mark.block;
+  if (mark.block != NULL) mark.block->used = mark.used;
+}
+
+void arena_free(Arena* arena) {
+  ArenaBlock* block = arena->first;
+  while (block != NULL) {
+    ArenaBlock* next = block->next;
+    free(block);
+    block = next;
+  }
+  memset(arena, 0, sizeof(Arena));
+}
+
+/****************************************************************************************
+ * end
+ ****************************************************************************************/
@@ -0,0 +1,253 @@
+#define _GNU_SOURCE
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "search.h"
+#include "boundcache.h"
+
+/****************************************************************************************
+ * bound caches, for --bound-cache FILE: the MPA of each Y set and the ECA of
+ * each subset that a search computed, kept across runs. These values depend on
+ * the network, the fixed nodes, the decisions, the thresholds and the features,
+ * but not on the costs and the budget, so a search of the same problem with other costs or
+ * another budget takes the values it needs from the cache, and computes (and
+ * moves features for) only the ones that are not there.
+ *
+ * The MPA of Y also depends on the order of Y in the vtree, which is not part
+ * of the key. Every such MPA bounds the ECA of all subsets of Y, so any of
+ * them is a valid bound, though not always the one a search without the cache
+ * would compute.
+ *
+ * format of FILE, one record per line:
+ *   c comment
+ *   p [num_features] [problem hash, in hex]
+ *   m [Y set, as 0/1 characters] [MPA]
+ *   e [subset, as 0/1 characters] [ECA]
+ * a FILE of another problem (another hash) is ignored, and overwritten when
+ * the cache is saved.
+ ****************************************************************************************/
+
+static inline uint64_t fnv_bytes(uint64_t h, const void* bytes, const size_t size) {
+  const unsigned char* p = (const unsigned char*) bytes;
+  for (size_t i = 0; i < size; i++) {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// Hash of what the values of the cache depend on: the CNF, the literal
+// weights, the fixed nodes, the decisions searched for (decision, or all of
+// them if it is negative) with their thresholds and the indicators of each
+// feature
+uint64_t bound_cache_problem(SearchData* data, Fnf* fnf, const int decision) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  h = fnv_bytes(h, &data->var_count, sizeof(data->var_count));
+  for (SddLiteral i = 1; i <= (SddLiteral) data->var_count; i++) {
+    h = fnv_bytes(h, data->literal_weights + i, sizeof(SddWmc));
+    h = fnv_bytes(h, data->literal_weights - i, sizeof(SddWmc));
+  }
+  for (SddSize i = 0; i < fnf->litset_count; i++) {
+    LitSet* litset = fnf->litsets + i;
+    h = fnv_bytes(h, &litset->literal_count, sizeof(litset->literal_count));
+    h = fnv_bytes(h, litset->literals, litset->literal_count * sizeof(SddLiteral));
+  }
+  h = fnv_bytes(h, data->fixed_literals, data->num_fixed_literals * sizeof(SddLiteral));
+  for (SddSize k = 0; k < data->num_decisions; k++) {
+    if (decision >= 0 && k != (SddSize) decision) continue;
+    h = fnv_bytes(h, data->decisions + k, sizeof(SddLiteral));
+    h = fnv_bytes(h, data->thresholds + k, sizeof(SddWmc));
+  }
+  h = fnv_bytes(h, &data->num_features, sizeof(data->num_features));
+  for (SddSize j = 0; j < data->num_features; j++) {
+    Feature* feature = data->features[j];
+    h = fnv_bytes(h, &feature->num_indicators, sizeof(feature->num_indicators));
+    h = fnv_bytes(h, feature->indicators, feature->num_indicators * sizeof(SddLiteral));
+  }
+  return h;
+}
+
+static inline SddSize cache_slot_hash(const BoundCache* cache, const int kind,
+    const SubsetWord* set) {
+  size_t h = subset_hash(set, cache->words) ^ (size_t) kind * 0x9E3779B97F4A7C15ULL;
+  h ^= h >> 31;
+  return h & (cache->capacity - 1);
+}
+
+// Helper function: slot of the entry of kind and set (an empty slot if there
+// is none)
+static SddSize cache_slot(const BoundCache* cache, const int kind, const SubsetWord* set) {
+  SddSize h = cache_slot_hash(cache, kind, set);
+  while (cache->slots[h] != 0) {
+    SddSize e = cache->slots[h] - 1;
+    if (cache->kinds[e] == kind &&
+        subset_equal(cache->sets + e * cache->words, set, cache->words)) {
+      break;
+    }
+    h = (h + 1) & (cache->capacity - 1);
+  }
+  return h;
+}
+
+static BoundCache* bound_cache_new(const SddSize num_features, const uint64_t problem) {
+  BoundCache* cache = (BoundCache*) calloc(1, sizeof(BoundCache));
+  cache->num_features = num_features;
+  cache->words = subset_words(num_features);
+  cache->problem = problem;
+  cache->entry_capacity = 512;
+  cache->sets = (SubsetWord*) malloc(cache->entry_capacity * cache->words *
+                                     sizeof(SubsetWord));
+  cache->kinds = (unsigned char*) malloc(cache->entry_capacity);
+  cache->values = (SddWmc*) malloc(cache->entry_capacity * sizeof(SddWmc));
+  cache->capacity = 1024;
+  cache->slots = (SddSize*) calloc(cache->capacity, sizeof(SddSize));
+  return cache;
+}
+
+void bound_cache_free(BoundCache* cache) {
+  free(cache->sets);
+  free(cache->kinds);
+  free(cache->values);
+  free(cache->slots);
+  free(cache);
+}
+
+// Returns 1 and sets value if the cache has the value of kind for set
+int bound_cache_get(const BoundCache* cache, const int kind, const SubsetWord* set,
+    SddWmc* value) {
+  SddSize e = cache->slots[cache_slot(cache, kind, set)];
+  if (e == 0) return 0;
+  *value = cache->values[e - 1];
+  return 1;
+}
+
+// Add or replace the value of kind for set
+void bound_cache_put(BoundCache* cache, const int kind, const SubsetWord* set,
+    const SddWmc value) {
+  SddSize slot = cache_slot(cache, kind, set);
+  if (cache->slots[slot] != 0) {
+    cache->values[cache->slots[slot] - 1] = value;
+    return;
+  }
+  if (cache->count == cache->entry_capacity) {
+    cache->entry_capacity *= 2;
+    cache->sets = (SubsetWord*) realloc(cache->sets,
+        cache->entry_capacity * cache->words * sizeof(SubsetWord));
+    cache->kinds = (unsigned char*) realloc(cache->kinds, cache->entry_capacity);
+    cache->values = (SddWmc*) realloc(cache->values,
+                                      cache->entry_capacity * sizeof(SddWmc));
+  }
+  SddSize e = cache->count++;
+  subset_copy(cache->sets + e * cache->words, set, cache->words);
+  cache->kinds[e] = kind;
+  cache->values[e] = value;
+  if (2 * cache->count > cache->capacity) { // keep load factor below 1/2
+    free(cache->slots);
+    cache->capacity *= 2;
+    cache->slots = (SddSize*) calloc(cache->capacity, sizeof(SddSize));
+    for (SddSize i = 0; i < cache->count; i++) {
+      SddSize h = cache_slot_hash(cache, cache->kinds[i], cache->sets + i * cache->words);
+      while (cache->slots[h] != 0) h = (h + 1) & (cache->capacity - 1);
+      cache->slots[h] = i + 1;
+    }
+  } else {
+    cache->slots[slot] = e + 1;
+  }
+}
+
+// Helper function: read a set of num_features 0/1 characters into set
+static int read_set(const char* str, SubsetWord* set, const SddSize num_features) {
+  if (str == NULL || strlen(str) != num_features || strspn(str, "01") != num_features) {
+    return 0;
+  }
+  for (SddSize i = 0; i < num_features; i++) {
+    if (str[i] == '1') subset_add(set, i);
+    else subset_remove(set, i);
+  }
+  return 1;
+}
+
+// The bound cache of the search problem of data and fnf for decision (see
+// bound_cache_problem): the one of filename if it exists and is of this
+// problem, an empty one otherwise
+BoundCache* bound_cache_load(const char* filename, SearchData* data, Fnf* fnf,
+    const int decision) {
+  BoundCache* cache = bound_cache_new(data->num_features,
+                                      bound_cache_problem(data, fnf, decision));
+  FILE* fp = fopen(filename, "r");
+  if (fp == NULL) {
+    printf(" bound cache        : %s (new)\n", filename);
+    return cache;
+  }
+  SubsetWord* set = (SubsetWord*) calloc(cache->words, sizeof(SubsetWord));
+  char* line = NULL;
+  size_t len = 0;
+  int matches = 0;
+  while (getline(&line, &len, fp) != -1) {
+    if (line[0] == '\0' || line[1] != ' ') continue;
+    char* rest = line + 2;
+    if (line[0] == 'p') {
+      char* num_features = strtok(rest, " \n");
+      char* problem = strtok(NULL, " \n");
+      matches = problem != NULL &&
+                strtoul(num_features, NULL, 10) == data->num_features &&
+                strtoull(problem, NULL, 16) == cache->problem;
+      if (!matches) break;
+    } else if (matches && (line[0] == 'm' || line[0] == 'e')) {
+      char* value = NULL;
+      if (!read_set(strtok(rest, " \n"), set, data->num_features) ||
+          (value = strtok(NULL, " \n")) == NULL) {
+        fprintf(stderr, "Invalid entry in bound cache %s\n", filename);
+        exit(1);
+      }
+      bound_cache_put(cache, line[0] == 'm' ? BOUND_CACHE_MPA : BOUND_CACHE_ECA, set,
+                      strtod(value, NULL));
+    }
+  }
+  free(line);
+  free(set);
+  fclose(fp);
+  cache->loaded = cache->count;
+  if (matches) {
+    printf(" bound cache        : %s (%"PRIsS" values)\n", filename, cache->loaded);
+  } else {
+    printf(" bound cache        : %s is of another search problem, starting empty\n",
+           filename);
+  }
+  return cache;
+}
+
+// Write cache to filename (through filename.tmp and a rename)
+void bound_cache_save(BoundCache* cache, const char* filename) {
+  size_t length = strlen(filename) + 8;
+  char* tmp_name = (char*) malloc(length);
+  snprintf(tmp_name, length, "%s.tmp", filename);
+  FILE* fp = fopen(tmp_name, "w");
+  if (fp == NULL) {
+    fprintf(stderr, "Could not open bound cache %s\n", tmp_name);
+    exit(1);
+  }
+  fprintf(fp, "c trim bound cache\n");
+  fprintf(fp, "p %"PRIsS" %016"PRIx64"\n", cache->num_features, cache->problem);
+  for (SddSize e = 0; e < cache->count; e++) {
+    const SubsetWord* set = cache->sets + e * cache->words;
+    fputc(cache->kinds[e] == BOUND_CACHE_MPA ? 'm' : 'e', fp);
+    fputc(' ', fp);
+    for (SddSize i = 0; i < cache->num_features; i++) {
+      fputc(subset_has(set, i) ? '1' : '0', fp);
+    }
+    fprintf(fp, " %.17g\n", cache->values[e]);
+  }
+  if (fclose(fp) != 0 || rename(tmp_name, filename) != 0) {
+    fprintf(stderr, "Could not write bound cache %s\n", filename);
+    exit(1);
+  }
+  free(tmp_name);
+}
+
+/****************************************************************************************
+ * end
+ ****************************************************************************************/
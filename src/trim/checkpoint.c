@@ -0,0 +1,227 @@
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sddapi.h"
+#include "search.h"
+#include "checkpoint.h"
+
+/****************************************************************************************
+ * checkpoints of search_constrained_sdd, for --checkpoint and --resume:
+ *  --FILE.vtree and FILE.sdd hold the constrained SDD, saved once before the
+ *    search starts
+ *  --FILE holds the frontier of the search and the incumbent, rewritten
+ *    (through FILE.tmp and a rename) at every checkpoint
+ * the search visits features in index order, including before excluding, so
+ * the frontier is the path of include (1) and exclude (0) decisions to the
+ * next search node to expand. All subtrees before it in this order have been
+ * searched, and none after it.
+ *
+ * format of FILE, one record per line:
+ *   c comment
+ *   p [num_features] [var_count] [threshold] [budget]
+ *   t [search seconds so far]
+ *   b [best ECA] [cost] [largest pruned bound] [best subset, as 0/1 characters]
+ *   x [frontier depth, -1 if the search completed] [path, as 0/1 characters]
+ *   f [depth] [features included] [cost]   (one per frame of the frontier)
+ *   s [counters of SearchStats, in the order written]
+ *   r [prunes by depth, num_features + 1 of them]
+ ****************************************************************************************/
+
+static void checkpoint_filename(char* buffer, const size_t length,
+    const char* filename, const char* suffix) {
+  snprintf(buffer, length, "%s%s", filename, suffix);
+}
+
+// Save the constrained SDD and its vtree next to the checkpoint
+void save_checkpoint_sdd(const char* filename, SddNode* node, SddManager* manager) {
+  size_t length = strlen(filename) + 8;
+  char* name = (char*) malloc(length);
+  checkpoint_filename(name, length, filename, ".vtree");
+  sdd_vtree_save(name, sdd_manager_vtree(manager));
+  checkpoint_filename(name, length, filename, ".sdd");
+  sdd_save(name, node);
+  free(name);
+}
+
+// Load the constrained SDD saved by save_checkpoint_sdd, into a new manager
+// returned via manager
+SddNode* load_checkpoint_sdd(const char* filename, SddManager** manager) {
+  size_t length = strlen(filename) + 8;
+  char* name = (char*) malloc(length);
+  checkpoint_filename(name, length, filename, ".vtree");
+  FILE* fp = fopen(name, "r");
+  if (fp == NULL) {
+    fprintf(stderr, "Could not open checkpoint vtree %s\n", name);
+    exit(1);
+  }
+  fclose(fp);
+  Vtree* vtree = sdd_vtree_read(name);
+  *manager = sdd_manager_new(vtree);
+  sdd_vtree_free(vtree);
+  checkpoint_filename(name, length, filename, ".sdd");
+  fp = fopen(name, "r");
+  if (fp == NULL) {
+    fprintf(stderr, "Could not open checkpoint sdd %s\n", name);
+    exit(1);
+  }
+  fclose(fp);
+  SddNode* node = sdd_read(name, *manager);
+  free(name);
+  return node;
+}
+
+static void write_bits(FILE* fp, const SubsetWord* bits, const int count) {
+  if (count == 0) fputc('-', fp);
+  for (int i = 0; i < count; i++) fputc(subset_has(bits, i) ? '1' : '0', fp);
+}
+
+// Write a checkpoint with the frontier at depth (the first depth entries of
+// path), or CHECKPOINT_COMPLETE after the search
+void write_checkpoint(const char* filename, SearchData* data, SearchResult* result,
+    const SubsetWord* path, const int depth, const double search_seconds) {
+  size_t length = strlen(filename) + 8;
+  char* tmp_name = (char*) malloc(length);
+  checkpoint_filename(tmp_name, length, filename, ".tmp");
+  FILE* fp = fopen(tmp_name, "w");
+  if (fp == NULL) {
+    fprintf(stderr, "Could not open checkpoint file %s\n", tmp_name);
+    exit(1);
+  }
+  SearchStats* stats = &result->stats;
+  fprintf(fp, "c trim search checkpoint\n");
+  fprintf(fp, "p %"PRIsS" %"PRIsS" %.9g %.9g\n", data->num_features, data->var_count,
+          data->threshold, data->budget);
+  fprintf(fp, "t %.6f\n", search_seconds);
+  fprintf(fp, "b %.17g %.9g %.17g ", result->best_score, result->cost,
+          result->max_pruned_bound);
+  write_bits(fp, result->best_subset, data->num_features);
+  fprintf(fp, "\nx %d ", depth);
+  write_bits(fp, path, depth > 0 ? depth : 0);
+  fprintf(fp, "\n");
+  int num_included = 0;
+  float cost = 0;
+  for (int t = 0; t <= depth; t++) {
+    fprintf(fp, "f %d %d %.9g\n", t, num_included, cost);
+    if (t < depth && subset_has(path, t)) {
+      num_included++;
+      cost += data->costs[t];
+    }
+  }
+  fprintf(fp, "s %"PRIsS" %"PRIsS" %"PRIsS" %"PRIsS" %"PRIsS" %"PRIsS" %"PRIsS" %"PRIsS
+          " %"PRIsS" %"PRIsS" %"PRIsS" %.6f %.6f %"PRIsS" %"PRIsS" %"PRIsS" %.6f %"PRIsS
+          " %"PRIsS"\n",
+          stats->nodes_expanded, stats->bound_evaluations, stats->eca_evaluations,
+          stats->budget_cutoffs, stats->symmetry_skips, stats->incumbent_updates,
+          stats->feature_moves, stats->var_moves, stats->condition_calls,
+          stats->apply_calls, stats->gc_calls, stats->esdp_seconds, stats->move_seconds,
+          stats->minimizations, stats->minimize_size_before, stats->minimize_size_after,
+          stats->minimize_seconds, stats->cheap_prunes, stats->cache_hits);
+  fprintf(fp, "r");
+  for (int i = 0; i <= data->num_features; i++) {
+    fprintf(fp, " %"PRIsS, stats->prunes_by_depth[i]);
+  }
+  fprintf(fp, "\n");
+  if (fclose(fp) != 0 || rename(tmp_name, filename) != 0) {
+    fprintf(stderr, "Could not write checkpoint file %s\n", filename);
+    exit(1);
+  }
+  free(tmp_name);
+}
+
+// The bits of bits past count are left unchanged
+static void read_bits(const char* str, SubsetWord* bits, const int count,
+    const char* filename) {
+  if (count == 0) return;
+  if (str == NULL || (int) strlen(str) != count || strspn(str, "01") != (size_t) count) {
+    fprintf(stderr, "Invalid subset in checkpoint file %s\n", filename);
+    exit(1);
+  }
+  for (int i = 0; i < count; i++) {
+    if (str[i] == '1') subset_add(bits, i);
+    else subset_remove(bits, i);
+  }
+}
+
+// Read a checkpoint of a search of data into result (incumbent and counters),
+// path (a subset of num_features features) and search_seconds. Returns the
+// frontier depth, or CHECKPOINT_COMPLETE.
+int read_checkpoint(const char* filename, SearchData* data, SearchResult* result,
+    SubsetWord* path, double* search_seconds) {
+  FILE* fp = fopen(filename, "r");
+  if (fp == NULL) {
+    fprintf(stderr, "Could not open checkpoint file %s\n", filename);
+    exit(1);
+  }
+  SearchStats* stats = &result->stats;
+  char* line = NULL;
+  size_t len = 0;
+  int depth = -2, frames = 0, matches = 0;
+  while (getline(&line, &len, fp) != -1) {
+    if (line[0] == '\0' || line[1] != ' ') continue;
+    char* rest = line + 2;
+    if (line[0] == 'p') {
+      // The search problem must be the one of the checkpoint
+      SddSize num_features = strtoul(strtok(rest, " \n"), NULL, 10);
+      SddSize var_count = strtoul(strtok(NULL, " \n"), NULL, 10);
+      float threshold = strtof(strtok(NULL, " \n"), NULL);
+      float budget = strtof(strtok(NULL, " \n"), NULL);
+      if (num_features != data->num_features || var_count != data->var_count ||
+          threshold != (float) data->threshold || budget != data->budget) {
+        fprintf(stderr, "Checkpoint file %s is of another search problem\n", filename);
+        exit(1);
+      }
+      matches = 1;
+    } else if (line[0] == 't') {
+      *search_seconds = strtod(rest, NULL);
+    } else if (line[0] == 'b') {
+      result->best_score = strtod(strtok(rest, " \n"), NULL);
+      result->cost = strtof(strtok(NULL, " \n"), NULL);
+      result->max_pruned_bound = strtod(strtok(NULL, " \n"), NULL);
+      read_bits(strtok(NULL, " \n"), result->best_subset, data->num_features, filename);
+    } else if (line[0] == 'x') {
+      depth = strtol(strtok(rest, " \n"), NULL, 10);
+      if (depth < CHECKPOINT_COMPLETE || depth > (int) data->num_features) {
+        fprintf(stderr, "Invalid frontier in checkpoint file %s\n", filename);
+        exit(1);
+      }
+      read_bits(strtok(NULL, " \n"), path, depth > 0 ? depth : 0, filename);
+    } else if (line[0] == 'f') {
+      frames++;
+    } else if (line[0] == 's') {
+      char* end = rest;
+      SddSize* counters[] = { &stats->nodes_expanded, &stats->bound_evaluations,
+        &stats->eca_evaluations, &stats->budget_cutoffs, &stats->symmetry_skips,
+        &stats->incumbent_updates, &stats->feature_moves, &stats->var_moves,
+        &stats->condition_calls, &stats->apply_calls, &stats->gc_calls };
+      for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+        *counters[i] = strtoul(end, &end, 10);
+      }
+      stats->esdp_seconds = strtod(end, &end);
+      stats->move_seconds = strtod(end, &end);
+      stats->minimizations = strtoul(end, &end, 10);
+      stats->minimize_size_before = strtoul(end, &end, 10);
+      stats->minimize_size_after = strtoul(end, &end, 10);
+      stats->minimize_seconds = strtod(end, &end);
+      stats->cheap_prunes = strtoul(end, &end, 10);
+      stats->cache_hits = strtoul(end, &end, 10);
+    } else if (line[0] == 'r') {
+      char* end = rest;
+      for (int i = 0; i <= data->num_features; i++) {
+        stats->prunes_by_depth[i] = strtoul(end, &end, 10);
+      }
+    }
+  }
+  free(line);
+  fclose(fp);
+  if (!matches || depth == -2 || (depth >= 0 && frames != depth + 1)) {
+    fprintf(stderr, "Incomplete checkpoint file %s\n", filename);
+    exit(1);
+  }
+  return depth;
+}
+
+/****************************************************************************************
+ * end
+ ****************************************************************************************/
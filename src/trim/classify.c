@@ -0,0 +1,520 @@
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "search.h"
+#include "esdp.h"
+#include "classify.h"
+
+// forward references
+char* ppc(SddSize n); // pretty print
+SddNode* fnf_to_sdd(Fnf* fnf, SddManager* manager);
+
+/****************************************************************************************
+ * classification of rows of evidence by the decision rule Pr(d|e) >= T
+ *
+ * Pr(d|e) is the ratio of two weighted model counts of the compiled SDD, with
+ * the weights of the indicators that contradict e set to 0. Rows are
+ * evaluated in blocks of CLASSIFY_LANES, one row per vector lane, over the
+ * SDD flattened by esdp_evaluator_new. Literal weights are normalized so that
+ * w(x) + w(-x) = 1 for every variable; the weight of variables skipped by an
+ * element ("gap") is then 1, except for variables of observed features, and
+ * follows from a per-row product over vtree nodes.
+ ****************************************************************************************/
+
+#define CLASSIFY_LANES 8
+typedef double Lanes __attribute__((vector_size(CLASSIFY_LANES * sizeof(double))));
+
+/****************************************************************************************
+ * datasets
+ ****************************************************************************************/
+
+// Helper function: strip surrounding white space in place
+static char* strip(char* str) {
+  while (isspace((unsigned char) *str)) str++;
+  char* end = str + strlen(str);
+  while (end > str && isspace((unsigned char) end[-1])) end--;
+  *end = '\0';
+  return str;
+}
+
+// Read a CSV file of evidence. The header names a network node of a feature
+// of data in each column (for a group, one of its nodes); each row gives
+// values (state indices, from 0) of these nodes, with ? or an empty cell for
+// unobserved nodes.
+Dataset* read_dataset(const char* filename, SearchData* data) {
+  FILE* fp = fopen(filename, "rb");
+  if (fp == NULL) {
+    fprintf(stderr, "Could not open dataset file %s\n", filename);
+    exit(1);
+  }
+
+  Dataset* dataset = (Dataset*) malloc(sizeof(Dataset));
+  dataset->row_count = 0;
+  dataset->column_count = 0;
+  int num_nodes = 0;
+  for (int i = 0; i < data->num_features; i++) num_nodes += data->features[i]->num_nodes;
+  dataset->column_feature = (int*) malloc(num_nodes * sizeof(int));
+  dataset->column_first = (int*) malloc(num_nodes * sizeof(int));
+  dataset->column_arity = (int*) malloc(num_nodes * sizeof(int));
+
+  char* line = NULL;
+  size_t len = 0;
+  if (getline(&line, &len, fp) == -1) {
+    fprintf(stderr, "%s: missing header\n", filename);
+    exit(1);
+  }
+  for (char* cell = strtok(line, ","); cell != NULL; cell = strtok(NULL, ",")) {
+    char* name = strip(cell);
+    int feature = -1, first = 0, arity = 0;
+    for (int i = 0; i < data->num_features && feature < 0; i++) {
+      Feature* f = data->features[i];
+      first = 0;
+      for (SddSize k = 0; k < f->num_nodes; k++) {
+        if (strcmp(f->node_names[k], name) == 0) {
+          feature = i;
+          arity = f->node_num_indicators[k];
+          break;
+        }
+        first += f->node_num_indicators[k];
+      }
+    }
+    if (feature < 0) {
+      fprintf(stderr, "%s: column %s is not a feature\n", filename, name);
+      exit(1);
+    }
+    for (int c = 0; c < dataset->column_count; c++) {
+      if (dataset->column_feature[c] == feature && dataset->column_first[c] == first) {
+        fprintf(stderr, "%s: feature %s appears twice\n", filename, name);
+        exit(1);
+      }
+    }
+    dataset->column_feature[dataset->column_count] = feature;
+    dataset->column_first[dataset->column_count] = first;
+    dataset->column_arity[dataset->column_count++] = arity;
+  }
+
+  SddSize capacity = 1024;
+  dataset->values = (int*) malloc(capacity * dataset->column_count * sizeof(int));
+  while (getline(&line, &len, fp) != -1) {
+    if (strip(line)[0] == '\0') continue;
+    if (dataset->row_count == capacity) {
+      capacity *= 2;
+      dataset->values = (int*) realloc(dataset->values,
+                                       capacity * dataset->column_count * sizeof(int));
+    }
+    int* row = dataset->values + dataset->row_count * dataset->column_count;
+    char* pos = line;
+    for (int c = 0; c < dataset->column_count; c++) {
+      char* cell = pos;
+      pos = strchr(pos, ',');
+      if (pos == NULL && c + 1 < dataset->column_count) {
+        fprintf(stderr, "%s: row %"PRIsS" has too few columns\n",
+                filename, dataset->row_count + 1);
+        exit(1);
+      }
+      if (pos != NULL) *pos++ = '\0';
+      cell = strip(cell);
+      if (cell[0] == '\0' || strcmp(cell, "?") == 0) {
+        row[c] = -1;
+        continue;
+      }
+      char* end;
+      long value = strtol(cell, &end, 10);
+      if (*end != '\0' || value < 0 || value >= dataset->column_arity[c]) {
+        Feature* feature = data->features[dataset->column_feature[c]];
+        fprintf(stderr, "%s: row %"PRIsS": invalid value %s for %s\n",
+                filename, dataset->row_count + 1, cell, feature->name);
+        exit(1);
+      }
+      row[c] = value;
+    }
+    dataset->row_count++;
+  }
+
+  free(line);
+  fclose(fp);
+  return dataset;
+}
+
+void free_dataset(Dataset* dataset) {
+  free(dataset->column_feature);
+  free(dataset->column_first);
+  free(dataset->column_arity);
+  free(dataset->values);
+  free(dataset);
+}
+
+/****************************************************************************************
+ * blocks of rows
+ ****************************************************************************************/
+
+typedef struct {
+  EsdpEvaluator* sdd;       // Flattened SDD and its vtree
+  SddWmc* weights;          // Normalized literal weights, indexed by literal
+  int* var_column;          // Dataset column of indicator variables (-1 if none)
+  int* var_value;           // Value of indicator variables
+  SddLiteral* vtree_order;  // Internal vtree nodes, children before parents
+  SddLiteral vtree_internal_count;
+  SddLiteral var_count;
+  SddLiteral d;
+  const Dataset* dataset;
+} Classifier;
+
+// Helper function: compute Pr(d|e) of rows first..first+count-1 (count at
+// most CLASSIFY_LANES) into pr; NAN for rows whose evidence is inconsistent.
+// w, wd, scale and inv_scale have one vector per node and vtree node.
+__attribute__((target_clones("avx512f", "avx2", "default")))
+static void classify_block(const Classifier* c, const SddSize first, const int count,
+    Lanes* w, Lanes* wd, Lanes* scale, Lanes* inv_scale, SddWmc* pr) {
+  const EsdpEvaluator* sdd = c->sdd;
+  const EsdpVtree* vt = &sdd->vtree;
+  const Dataset* dataset = c->dataset;
+  const int* rows[CLASSIFY_LANES];
+  for (int l = 0; l < CLASSIFY_LANES; l++) {
+    // Extra lanes repeat the last row
+    rows[l] = dataset->values + (first + (l < count ? l : count - 1)) * dataset->column_count;
+  }
+
+  // Weight of the variables of each vtree node. Only indicators that
+  // contradict the evidence weigh less than 1.
+  const SddLiteral var_count = (vt->count + 1) / 2;
+  for (SddLiteral var = 1; var <= var_count; var++) {
+    SddLiteral pos = vt->var_position[var];
+    int column = c->var_column[var];
+    for (int l = 0; l < CLASSIFY_LANES; l++) {
+      int value = (column < 0) ? -1 : rows[l][column];
+      scale[pos][l] = (value < 0 || value == c->var_value[var]) ? 1 : c->weights[-var];
+    }
+    inv_scale[pos] = 1 / scale[pos];
+  }
+  for (SddLiteral k = 0; k < c->vtree_internal_count; k++) {
+    SddLiteral pos = c->vtree_order[k];
+    scale[pos] = scale[vt->left[pos]] * scale[vt->right[pos]];
+    inv_scale[pos] = 1 / scale[pos];
+  }
+
+  const SddLiteral d = c->d;
+  const SddLiteral d_pos = vt->var_position[d < 0 ? -d : d];
+  const SddWmc rd = c->weights[d];
+  const SddLiteral* vtree = sdd->values.vtree;
+  for (SddSize i = 0; i < sdd->node_count; i++) {
+    switch (sdd->type[i]) {
+      case ESDP_FALSE:
+        w[i] = wd[i] = (Lanes) { 0 };
+        continue;
+      case ESDP_TRUE:
+        w[i] = wd[i] = (Lanes) { 0 } + 1;
+        continue;
+      case ESDP_LITERAL: {
+        SddLiteral literal = sdd->literal[i];
+        w[i] = (Lanes) { 0 } + c->weights[literal];
+        int column = (literal > 0) ? c->var_column[literal] : -1;
+        if (column >= 0) {
+          for (int l = 0; l < CLASSIFY_LANES; l++) {
+            int value = rows[l][column];
+            if (value >= 0 && value != c->var_value[literal]) w[i][l] = 0;
+          }
+        }
+        wd[i] = (literal == -d) ? (Lanes) { 0 } : w[i];
+        continue;
+      }
+    }
+
+    SddLiteral pos = vtree[i];
+    SddLiteral left = vt->left[pos], right = vt->right[pos];
+    const int d_left = vt->lo[pos] <= d_pos && d_pos < pos;
+    const int d_right = pos < d_pos && d_pos <= vt->hi[pos];
+    Lanes wi = { 0 }, wdi = { 0 };
+    for (SddSize k = sdd->elem_begin[i]; k < sdd->elem_begin[i+1]; k++) {
+      const SddSize p = sdd->children[2*k], s = sdd->children[2*k+1];
+      const SddLiteral p_pos = vtree[p], s_pos = vtree[s];
+      Lanes wp = w[p], wdp = wd[p], ws = w[s], wds = wd[s];
+      if (p_pos != left) {
+        Lanes gap = (p_pos < 0) ? scale[left] : scale[left] * inv_scale[p_pos];
+        wp *= gap;
+        wdp *= gap;
+        if (d_left && (p_pos < 0 || d_pos < vt->lo[p_pos] || vt->hi[p_pos] < d_pos)) {
+          wdp *= rd;
+        }
+      }
+      if (s_pos != right) {
+        Lanes gap = (s_pos < 0) ? scale[right] : scale[right] * inv_scale[s_pos];
+        ws *= gap;
+        wds *= gap;
+        if (d_right && (s_pos < 0 || d_pos < vt->lo[s_pos] || vt->hi[s_pos] < d_pos)) {
+          wds *= rd;
+        }
+      }
+      wi += wp * ws;
+      wdi += wdp * wds;
+    }
+    w[i] = wi;
+    wd[i] = wdi;
+  }
+
+  // The root is the last node. The decision may not be in its vtree.
+  SddSize r = sdd->node_count - 1;
+  SddLiteral r_pos = vtree[r];
+  SddWmc d_factor = (r_pos < 0 || d_pos < vt->lo[r_pos] || vt->hi[r_pos] < d_pos) ? rd : 1;
+  for (int l = 0; l < count; l++) {
+    pr[first + l] = (w[r][l] == 0) ? NAN : d_factor * wd[r][l] / w[r][l];
+  }
+}
+
+// Helper function: append the internal vtree nodes below pos in post-order
+static void order_vtree(const EsdpVtree* vt, const SddLiteral pos,
+                        SddLiteral* order, SddLiteral* count) {
+  if (vt->left[pos] < 0) return;
+  order_vtree(vt, vt->left[pos], order, count);
+  order_vtree(vt, vt->right[pos], order, count);
+  order[(*count)++] = pos;
+}
+
+static Classifier* classifier_new(SddNode* node, SddManager* manager,
+    SearchData* data, const Dataset* dataset) {
+  Classifier* c = (Classifier*) malloc(sizeof(Classifier));
+  c->sdd = esdp_evaluator_new(node, manager, data->literal_weights);
+  c->dataset = dataset;
+  c->d = data->decision;
+
+  SddLiteral var_count = c->var_count = data->var_count;
+  c->weights = (SddWmc*) malloc((2 * var_count + 1) * sizeof(SddWmc)) + var_count;
+  for (SddLiteral var = 1; var <= var_count; var++) {
+    SddWmc total = data->literal_weights[var] + data->literal_weights[-var];
+    c->weights[var] = data->literal_weights[var] / total;
+    c->weights[-var] = data->literal_weights[-var] / total;
+  }
+
+  c->var_column = (int*) malloc((var_count + 1) * sizeof(int));
+  c->var_value = (int*) malloc((var_count + 1) * sizeof(int));
+  for (SddLiteral var = 0; var <= var_count; var++) c->var_column[var] = -1;
+  for (int col = 0; col < dataset->column_count; col++) {
+    Feature* feature = data->features[dataset->column_feature[col]];
+    SddLiteral* indicators = feature->indicators + dataset->column_first[col];
+    for (int j = 0; j < dataset->column_arity[col]; j++) {
+      c->var_column[indicators[j]] = col;
+      c->var_value[indicators[j]] = j;
+    }
+  }
+
+  const EsdpVtree* vt = &c->sdd->vtree;
+  SddLiteral root = 0;
+  while (vt->parent[root] >= 0) root = vt->parent[root];
+  c->vtree_order = (SddLiteral*) malloc(vt->count * sizeof(SddLiteral));
+  c->vtree_internal_count = 0;
+  order_vtree(vt, root, c->vtree_order, &c->vtree_internal_count);
+  return c;
+}
+
+static void classifier_free(Classifier* c) {
+  esdp_evaluator_free(c->sdd);
+  free(c->weights - c->var_count);
+  free(c->var_column);
+  free(c->var_value);
+  free(c->vtree_order);
+  free(c);
+}
+
+// Rows of a classification thread
+typedef struct {
+  const Classifier* classifier;
+  SddSize first;
+  SddSize last;
+  SddWmc* pr;
+} ClassifyTask;
+
+// Helper function: classify the rows of a task, in blocks
+static void* classify_rows(void* arg) {
+  ClassifyTask* task = (ClassifyTask*) arg;
+  const Classifier* c = task->classifier;
+  Lanes *w, *wd, *scale, *inv_scale;
+  if (posix_memalign((void**) &w, sizeof(Lanes), c->sdd->node_count * sizeof(Lanes)) ||
+      posix_memalign((void**) &wd, sizeof(Lanes), c->sdd->node_count * sizeof(Lanes)) ||
+      posix_memalign((void**) &scale, sizeof(Lanes), c->sdd->vtree.count * sizeof(Lanes)) ||
+      posix_memalign((void**) &inv_scale, sizeof(Lanes),
+                     c->sdd->vtree.count * sizeof(Lanes))) {
+    fprintf(stderr, "Could not allocate classification buffers\n");
+    exit(1);
+  }
+  for (SddSize first = task->first; first < task->last; first += CLASSIFY_LANES) {
+    int count = (task->last - first < CLASSIFY_LANES) ? task->last - first : CLASSIFY_LANES;
+    classify_block(c, first, count, w, wd, scale, inv_scale, task->pr);
+  }
+  free(w);
+  free(wd);
+  free(scale);
+  free(inv_scale);
+  return NULL;
+}
+
+// Helper function: compute Pr(d|e) of all rows with a WmcManager of the sdd
+// library, one row at a time
+static void classify_rows_with_library(SddNode* node, SddManager* manager,
+    SearchData* data, const Dataset* dataset, SddWmc* pr) {
+  WmcManager* wmc_manager = wmc_manager_new(node, 0, manager);
+  for (SddLiteral var = 1; var <= data->var_count; var++) {
+    wmc_set_literal_weight(var, data->literal_weights[var], wmc_manager);
+    wmc_set_literal_weight(-var, data->literal_weights[-var], wmc_manager);
+  }
+  for (SddSize r = 0; r < dataset->row_count; r++) {
+    const int* row = dataset->values + r * dataset->column_count;
+    for (int col = 0; col < dataset->column_count; col++) {
+      Feature* feature = data->features[dataset->column_feature[col]];
+      for (int j = 0; j < dataset->column_arity[col]; j++) {
+        SddLiteral var = feature->indicators[dataset->column_first[col] + j];
+        int value = row[col];
+        wmc_set_literal_weight(var, (value < 0 || value == j) ?
+                               data->literal_weights[var] : 0, wmc_manager);
+      }
+    }
+    SddWmc wmc = wmc_propagate(wmc_manager);
+    pr[r] = (wmc == 0) ? NAN : wmc_literal_pr(data->decision, wmc_manager);
+  }
+  wmc_manager_free(wmc_manager);
+}
+
+static double elapsed_seconds(const struct timespec* start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + 1e-9 * (end.tv_nsec - start->tv_nsec);
+}
+
+// Classify each row of dataset by Pr(d|e) >= threshold, with the SDD compiled
+// from fnf, and write the decisions (1, 0, or ? for inconsistent evidence)
+// and probabilities to the output file of classify_options
+void classify_dataset(SearchData* data, Fnf* fnf, SddCompilerOptions* options,
+                      Dataset* dataset, ClassifyOptions* classify_options) {
+  if (data->num_decisions > 1) {
+    fprintf(stderr, "-C classifies a single decision, but the search file has %"PRIsS
+            " d lines\n", data->num_decisions);
+    exit(1);
+  }
+  printf("\ncreating manager..."); fflush(stdout);
+  SddManager* manager = sdd_manager_create(fnf->var_count, 0);
+  sdd_manager_set_options(options, manager);
+  printf("\ncompiling..."); fflush(stdout);
+  SddNode* node = fnf_to_sdd(fnf, manager);
+  if (options->minimize_cardinality) {
+    printf("\nminimizing cardinality...");
+    node = sdd_minimize_cardinality(node, manager);
+  }
+  // Condition on the fixed nodes, as the search does, so that each row is
+  // classified by Pr(d | row, fixed nodes)
+  if (data->num_fixed_nodes > 0) {
+    printf("\nconditioning on %"PRIsS" fixed nodes...", data->num_fixed_nodes);
+    for (SddSize i = 0; i < data->num_fixed_literals; i++) {
+      node = sdd_condition(data->fixed_literals[i], node, manager);
+    }
+    if (sdd_node_is_false(node)) {
+      fprintf(stderr, "The fixed nodes have probability 0\n");
+      exit(1);
+    }
+  }
+  char* s;
+  printf("\n sdd size               : %s \n", s=ppc(sdd_size(node))); free(s);
+  printf(" sdd node count         : %s \n", s=ppc(sdd_count(node))); free(s);
+
+  SddSize rows = dataset->row_count;
+  SddWmc* pr = (SddWmc*) malloc((rows + 1) * sizeof(SddWmc));
+  SddWmc* library_pr = NULL;
+  struct timespec start;
+  double seconds = 0, library_seconds = 0;
+  int mode = classify_options->esdp_mode;
+
+  if (mode == ESDP_LIBRARY || mode == ESDP_COMPARE) {
+    library_pr = (mode == ESDP_LIBRARY) ? pr : (SddWmc*) malloc((rows + 1) * sizeof(SddWmc));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    classify_rows_with_library(node, manager, data, dataset, library_pr);
+    library_seconds = elapsed_seconds(&start);
+  }
+  int num_threads = classify_options->num_threads;
+  if (mode != ESDP_LIBRARY) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Classifier* classifier = classifier_new(node, manager, data, dataset);
+    double setup_seconds = elapsed_seconds(&start);
+
+    // Split rows into one contiguous range of whole blocks per thread
+    if (num_threads < 1) num_threads = 1;
+    SddSize blocks = (rows + CLASSIFY_LANES - 1) / CLASSIFY_LANES;
+    pthread_t* threads = (pthread_t*) malloc(num_threads * sizeof(pthread_t));
+    ClassifyTask* tasks = (ClassifyTask*) malloc(num_threads * sizeof(ClassifyTask));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < num_threads; t++) {
+      tasks[t].classifier = classifier;
+      tasks[t].first = CLASSIFY_LANES * (blocks * t / num_threads);
+      tasks[t].last = CLASSIFY_LANES * (blocks * (t + 1) / num_threads);
+      if (tasks[t].last > rows) tasks[t].last = rows;
+      tasks[t].pr = pr;
+      if (pthread_create(threads + t, NULL, classify_rows, tasks + t) != 0) {
+        fprintf(stderr, "Could not create classification thread\n");
+        exit(1);
+      }
+    }
+    for (int t = 0; t < num_threads; t++) pthread_join(threads[t], NULL);
+    seconds = elapsed_seconds(&start);
+    printf(" setup time             : %.3f s\n", setup_seconds);
+    free(threads);
+    free(tasks);
+    classifier_free(classifier);
+  }
+
+  // Decisions
+  FILE* fp = NULL;
+  if (classify_options->output_filename != NULL) {
+    fp = fopen(classify_options->output_filename, "w");
+    if (fp == NULL) {
+      fprintf(stderr, "Could not open output file %s\n", classify_options->output_filename);
+      exit(1);
+    }
+    fprintf(fp, "decision,probability\n");
+  }
+  SddSize positive = 0, inconsistent = 0;
+  for (SddSize r = 0; r < rows; r++) {
+    if (isnan(pr[r])) {
+      inconsistent++;
+      if (fp != NULL) fprintf(fp, "?,\n");
+      continue;
+    }
+    int decision = pr[r] >= data->threshold;
+    positive += decision;
+    if (fp != NULL) fprintf(fp, "%d,%.9g\n", decision, pr[r]);
+  }
+  if (fp != NULL) fclose(fp);
+
+  printf("\nrows                   : %"PRIsS"\n", rows);
+  printf(" positive decisions     : %"PRIsS"\n", positive);
+  printf(" inconsistent rows      : %"PRIsS"\n", inconsistent);
+  if (mode == ESDP_LIBRARY || mode == ESDP_COMPARE) {
+    printf(" library rows/s         : %.0f\n", rows / library_seconds);
+  }
+  if (mode != ESDP_LIBRARY) {
+    printf(" threads                : %d\n", num_threads);
+    printf(" rows/s                 : %.0f\n", rows / seconds);
+    printf(" rows/s/thread          : %.0f\n", rows / seconds / num_threads);
+  }
+  if (mode == ESDP_COMPARE) {
+    SddWmc max_diff = 0;
+    SddSize disagreements = 0;
+    for (SddSize r = 0; r < rows; r++) {
+      if (isnan(pr[r]) || isnan(library_pr[r])) {
+        disagreements += isnan(pr[r]) != isnan(library_pr[r]);
+        continue;
+      }
+      max_diff = fmax(max_diff, fabs(pr[r] - library_pr[r]));
+      disagreements += (pr[r] >= data->threshold) != (library_pr[r] >= data->threshold);
+    }
+    printf(" max |pr diff|          : %g\n", max_diff);
+    printf(" decision differences   : %"PRIsS"\n", disagreements);
+    free(library_pr);
+  }
+
+  free(pr);
+  sdd_manager_free(manager);
+}
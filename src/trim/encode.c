@@ -0,0 +1,204 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "network.h"
+
+/****************************************************************************************
+ * encodes a Bayesian network into a CNF with the indicator/parameter scheme of
+ * ACE (compile -noEclause -encodeOnly -cd06), and produces the same literal
+ * map that parse_lmap reads from an .lmap file:
+ *  --nodes are numbered in alphabetical order of their names
+ *  --each node gets one indicator variable per value (weight 1), followed by
+ *    the parameter variables of its CPT
+ *  --values of a node are exactly-one constrained
+ *  --each CPT entry theta_x|u gives a clause -I_x -I_u1 ... -I_uk theta
+ *  --equal parameters of a CPT share a single variable
+ * The encoding is meant to be compiled with cardinality minimization, which
+ * keeps only the models where the implied parameter variables are true.
+ ****************************************************************************************/
+
+typedef struct {
+  SddSize litset_count;
+  SddSize capacity;
+  LitSet* litsets;
+} ClauseList;
+
+static void add_clause(ClauseList* clauses, const SddLiteral* literals,
+                       const SddLiteral literal_count) {
+  if (clauses->litset_count == clauses->capacity) {
+    clauses->capacity = 2 * clauses->capacity + 64;
+    clauses->litsets = (LitSet*) realloc(clauses->litsets,
+                                         clauses->capacity * sizeof(LitSet));
+  }
+  LitSet* clause = clauses->litsets + clauses->litset_count;
+  clause->id = clauses->litset_count++;
+  clause->literal_count = literal_count;
+  clause->literals = (SddLiteral*) malloc(literal_count * sizeof(SddLiteral));
+  memcpy(clause->literals, literals, literal_count * sizeof(SddLiteral));
+  clause->op = DISJOIN;
+  clause->vtree = NULL;
+  clause->bit = 0;
+}
+
+// A node of the network, sorted by name
+typedef struct {
+  const char* name;
+  int index;
+} NamedNode;
+
+static int cmp_node_names(const void* n1, const void* n2) {
+  return strcmp(((const NamedNode*) n1)->name, ((const NamedNode*) n2)->name);
+}
+
+// Encode a Bayesian network as a CNF, and return (via pointers) the literal
+// map in the form produced by parse_lmap. If skip_deterministic is set, zero
+// parameters are encoded as clauses without parameter variables. Parameters
+// equal to one always get a variable, so that every network instantiation
+// keeps one true parameter variable per CPT (and the same cardinality).
+Fnf* encode_bayes_net(const BayesNet* bn, const int skip_deterministic,
+    size_t* var_count, size_t* node_count, char*** sorted_node_names,
+    SddLiteral*** sorted_node_indicators, SddSize** sorted_node_num_indicators,
+    SddWmc** weights) {
+  int n = bn->node_count;
+  NamedNode* named = (NamedNode*) malloc(n * sizeof(NamedNode));
+  for (int i = 0; i < n; i++) {
+    named[i].name = bn->nodes[i].name;
+    named[i].index = i;
+  }
+  qsort(named, n, sizeof(NamedNode), cmp_node_names);
+  int* order = (int*) malloc(n * sizeof(int));
+  for (int k = 0; k < n; k++) order[k] = named[k].index;
+  free(named);
+
+  SddLiteral* first_indicator = (SddLiteral*) malloc(n * sizeof(SddLiteral));
+  SddSize weight_capacity = 64, var = 0;
+  *weights = (SddWmc*) malloc(weight_capacity * sizeof(SddWmc));
+  int max_cpt_size = 0, max_states = 0;
+  for (int i = 0; i < n; i++) {
+    const BnNode* node = bn->nodes + i;
+    int size = node->num_states;
+    if (node->num_states > max_states) max_states = node->num_states;
+    for (int j = 0; j < node->num_parents; j++) {
+      size *= bn->nodes[node->parents[j]].num_states;
+    }
+    if (size > max_cpt_size) max_cpt_size = size;
+  }
+  double* distinct = (double*) malloc(max_cpt_size * sizeof(double));
+  SddLiteral* distinct_var = (SddLiteral*) malloc(max_cpt_size * sizeof(SddLiteral));
+
+  *node_count = n;
+  *sorted_node_names = (char**) malloc(n * sizeof(char*));
+  *sorted_node_indicators = (SddLiteral**) malloc(n * sizeof(SddLiteral*));
+  *sorted_node_num_indicators = (SddSize*) malloc(n * sizeof(SddSize));
+
+  // Assign indicator variables, then parameter variables, node by node
+  SddLiteral** param_vars = (SddLiteral**) malloc(n * sizeof(SddLiteral*));
+  for (int k = 0; k < n; k++) {
+    int i = order[k];
+    const BnNode* node = bn->nodes + i;
+    (*sorted_node_names)[k] = strdup(node->name);
+    (*sorted_node_num_indicators)[k] = node->num_states;
+    (*sorted_node_indicators)[k] =
+        (SddLiteral*) malloc(node->num_states * sizeof(SddLiteral));
+
+    int size = node->num_states;
+    for (int j = 0; j < node->num_parents; j++) {
+      size *= bn->nodes[node->parents[j]].num_states;
+    }
+    if (var + node->num_states + size > weight_capacity) {
+      weight_capacity = 2 * (var + node->num_states + size);
+      *weights = (SddWmc*) realloc(*weights, weight_capacity * sizeof(SddWmc));
+    }
+
+    first_indicator[i] = var + 1;
+    for (int s = 0; s < node->num_states; s++) {
+      (*sorted_node_indicators)[k][s] = ++var;
+      (*weights)[var-1] = 1.0;
+    }
+
+    param_vars[i] = (SddLiteral*) malloc(size * sizeof(SddLiteral));
+    int num_distinct = 0;
+    for (int e = 0; e < size; e++) {
+      double value = node->cpt[e];
+      if (skip_deterministic && value == 0.0) {
+        param_vars[i][e] = 0; // no parameter variable
+        continue;
+      }
+      int d = 0;
+      while (d < num_distinct && distinct[d] != value) d++;
+      if (d == num_distinct) {
+        distinct[num_distinct] = value;
+        distinct_var[num_distinct++] = ++var;
+        (*weights)[var-1] = value;
+      }
+      param_vars[i][e] = distinct_var[d];
+    }
+  }
+  *var_count = var;
+
+  // Clauses, in the same node order
+  ClauseList clauses = { 0, 0, NULL };
+  SddLiteral* clause =
+      (SddLiteral*) malloc((n + max_states + 1) * sizeof(SddLiteral));
+  int* values = (int*) malloc(n * sizeof(int));
+  for (int k = 0; k < n; k++) {
+    int i = order[k];
+    const BnNode* node = bn->nodes + i;
+
+    // Exactly one value
+    for (int s = 0; s < node->num_states; s++) clause[s] = first_indicator[i] + s;
+    add_clause(&clauses, clause, node->num_states);
+    for (int s = 0; s < node->num_states; s++) {
+      for (int r = s + 1; r < node->num_states; r++) {
+        clause[0] = -(first_indicator[i] + r);
+        clause[1] = -(first_indicator[i] + s);
+        add_clause(&clauses, clause, 2);
+      }
+    }
+
+    // One clause per CPT entry. values[] enumerates parent instantiations
+    // with the last parent varying fastest, followed by the node value.
+    int size = node->num_states;
+    for (int j = 0; j < node->num_parents; j++) {
+      values[j] = 0;
+      size *= bn->nodes[node->parents[j]].num_states;
+    }
+    int x = 0;
+    for (int e = 0; e < size; e++) {
+      SddLiteral len = 0;
+      clause[len++] = -(first_indicator[i] + x);
+      for (int j = 0; j < node->num_parents; j++) {
+        clause[len++] = -(first_indicator[node->parents[j]] + values[j]);
+      }
+      if (param_vars[i][e] != 0) clause[len++] = param_vars[i][e];
+      add_clause(&clauses, clause, len);
+
+      if (++x == node->num_states) {
+        x = 0;
+        for (int j = node->num_parents - 1; j >= 0; j--) {
+          if (++values[j] < bn->nodes[node->parents[j]].num_states) break;
+          values[j] = 0;
+        }
+      }
+    }
+  }
+
+  Fnf* fnf = (Fnf*) malloc(sizeof(Fnf));
+  fnf->var_count = var;
+  fnf->litset_count = clauses.litset_count;
+  fnf->litsets = clauses.litsets;
+  fnf->op = CONJOIN;
+
+  for (int i = 0; i < n; i++) free(param_vars[i]);
+  free(param_vars);
+  free(values);
+  free(clause);
+  free(distinct);
+  free(distinct_var);
+  free(first_indicator);
+  free(order);
+  return fnf;
+}
@@ -0,0 +1,1042 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sddapi.h"
+#include "esdp.h"
+
+/****************************************************************************************
+ * this file contains an evaluator for the expected same-decision probability
+ * (E-SDP) on a constrained SDD, computing the same quantities as compute_mpa
+ * of the sdd library:
+ *  --ECA: expected classification agreement between the classifier that
+ *    observes all features and the one that observes only the Y features
+ *  --MPA: maximum potential agreement, i.e. the largest agreement that any
+ *    classifier observing Y (or a subset of Y) can reach; an upper bound on
+ *    the ECA of every subset of Y
+ *
+ * The vtree is right-linear on top: each node of its right-most path has the
+ * indicators of one feature in its left child. The Y-constrained node is the
+ * right-most path node below the Y features, and the XY-constrained node the
+ * one below all features. Every SDD node is evaluated once, bottom-up, in
+ * the region of the vtree it is normalized for:
+ *  --Z (XY-constrained node and below): model count w, and model count wd
+ *    with the decision literal
+ *  --X (Y- down to XY-constrained node): models split by classification,
+ *    a1 and a0, where a model is classified by Pr(d|x,y) >= T
+ *  --Y (above the Y-constrained node): ECA and MPA summed over y
+ *
+ * Elements whose children are normalized for a lower vtree node than the one
+ * they stand for are scaled by the weight of the skipped variables ("gap").
+ *
+ * Two evaluators share this computation:
+ *  --EsdpEvaluator flattens the SDD once into arrays and evaluates all of it
+ *  --EsdpCache keeps the values of nodes across calls. The values of a node
+ *    in the P, X or Z region depend only on the node itself (for a fixed
+ *    decision and threshold), so moving a feature on the right-most path only
+ *    invalidates the nodes that the move rebuilds. Nodes of the Y region
+ *    depend on the Y/X split and are evaluated on every call.
+ ****************************************************************************************/
+
+/****************************************************************************************
+ * index map: key -> index, with open addressing. Keys are node pointers or
+ * sdd_id + 1, and 0 marks an empty slot.
+ ****************************************************************************************/
+
+static void index_map_init(IndexMap* map, const SddSize min_count) {
+  map->count = 0;
+  map->capacity = 1024;
+  while (map->capacity < 2 * min_count) map->capacity <<= 1;
+  map->keys = (size_t*) calloc(map->capacity, sizeof(size_t));
+  map->values = (SddSize*) malloc(map->capacity * sizeof(SddSize));
+}
+
+static void index_map_free(IndexMap* map) {
+  free(map->keys);
+  free(map->values);
+}
+
+static inline SddSize hash_key(size_t h, const SddSize capacity) {
+  h ^= h >> 17;
+  h *= 0x9E3779B97F4A7C15ULL;
+  return (h >> 20) & (capacity - 1);
+}
+
+// Helper function: slot of key in map (an empty slot if key is not there)
+static inline SddSize index_map_slot(const IndexMap* map, const size_t key) {
+  SddSize h = hash_key(key, map->capacity);
+  while (map->keys[h] != 0 && map->keys[h] != key) {
+    h = (h + 1) & (map->capacity - 1);
+  }
+  return h;
+}
+
+// Insert a key that is not in map
+static void index_map_insert(IndexMap* map, const size_t key, const SddSize index) {
+  if (2 * (map->count + 1) > map->capacity) { // keep load factor below 1/2
+    IndexMap old = *map;
+    map->capacity = 2 * old.capacity;
+    map->keys = (size_t*) calloc(map->capacity, sizeof(size_t));
+    map->values = (SddSize*) malloc(map->capacity * sizeof(SddSize));
+    for (SddSize h = 0; h < old.capacity; h++) {
+      if (old.keys[h] == 0) continue;
+      SddSize slot = index_map_slot(map, old.keys[h]);
+      map->keys[slot] = old.keys[h];
+      map->values[slot] = old.values[h];
+    }
+    index_map_free(&old);
+  }
+  SddSize slot = index_map_slot(map, key);
+  map->keys[slot] = key;
+  map->values[slot] = index;
+  map->count++;
+}
+
+static void index_map_clear(IndexMap* map) {
+  memset(map->keys, 0, map->capacity * sizeof(size_t));
+  map->count = 0;
+}
+
+/****************************************************************************************
+ * vtree and value arrays
+ ****************************************************************************************/
+
+static void esdp_vtree_init(EsdpVtree* vt, SddManager* manager) {
+  SddLiteral var_count = sdd_manager_var_count(manager);
+  vt->count = 2 * var_count - 1;
+  vt->lo = (SddLiteral*) malloc(vt->count * sizeof(SddLiteral));
+  vt->hi = (SddLiteral*) malloc(vt->count * sizeof(SddLiteral));
+  vt->parent = (SddLiteral*) malloc(vt->count * sizeof(SddLiteral));
+  vt->left = (SddLiteral*) malloc(vt->count * sizeof(SddLiteral));
+  vt->right = (SddLiteral*) malloc(vt->count * sizeof(SddLiteral));
+  vt->on_spine = (char*) malloc(vt->count * sizeof(char));
+  vt->total = (long double*) malloc(vt->count * sizeof(long double));
+  vt->var_position = (SddLiteral*) malloc((var_count + 1) * sizeof(SddLiteral));
+}
+
+static void esdp_vtree_free(EsdpVtree* vt) {
+  free(vt->lo);
+  free(vt->hi);
+  free(vt->parent);
+  free(vt->left);
+  free(vt->right);
+  free(vt->on_spine);
+  free(vt->total);
+  free(vt->var_position);
+}
+
+// Helper function: record vtree positions, spans, parents and variable totals
+static void flatten_vtree(EsdpVtree* vt, const SddWmc* literal_weights,
+    Vtree* vtree, SddLiteral parent, int on_spine) {
+  SddLiteral pos = sdd_vtree_position(vtree);
+  vt->parent[pos] = parent;
+  vt->on_spine[pos] = on_spine;
+  if (sdd_vtree_is_leaf(vtree)) {
+    SddLiteral var = sdd_vtree_var(vtree);
+    vt->var_position[var] = pos;
+    vt->lo[pos] = vt->hi[pos] = pos;
+    vt->left[pos] = vt->right[pos] = -1;
+    vt->total[pos] = (long double) literal_weights[var] + literal_weights[-var];
+    return;
+  }
+  Vtree* left = sdd_vtree_left(vtree);
+  Vtree* right = sdd_vtree_right(vtree);
+  flatten_vtree(vt, literal_weights, left, pos, 0);
+  flatten_vtree(vt, literal_weights, right, pos, on_spine);
+  SddLiteral lpos = sdd_vtree_position(left), rpos = sdd_vtree_position(right);
+  vt->left[pos] = lpos;
+  vt->right[pos] = rpos;
+  vt->lo[pos] = vt->lo[lpos];
+  vt->hi[pos] = vt->hi[rpos];
+  vt->total[pos] = vt->total[lpos] * vt->total[rpos];
+}
+
+// Helper function: weight of the variables of vtree slot that are not in
+// vtree from (-1 for constants)
+static inline SddWmc gap_factor(const EsdpVtree* vt, const SddLiteral from,
+                                const SddLiteral slot) {
+  if (from == slot) return 1.0;
+  if (from < 0) return (SddWmc) vt->total[slot];
+  return (SddWmc) (vt->total[slot] / vt->total[from]);
+}
+
+static void esdp_values_resize(EsdpValues* values, const SddSize capacity) {
+  values->region = (char*) realloc(values->region, capacity * sizeof(char));
+  values->vtree = (SddLiteral*) realloc(values->vtree, capacity * sizeof(SddLiteral));
+  values->w = (SddWmc*) realloc(values->w, capacity * sizeof(SddWmc));
+  values->wd = (SddWmc*) realloc(values->wd, capacity * sizeof(SddWmc));
+  values->a1 = (SddWmc*) realloc(values->a1, capacity * sizeof(SddWmc));
+  values->a0 = (SddWmc*) realloc(values->a0, capacity * sizeof(SddWmc));
+}
+
+static void esdp_values_free(EsdpValues* values) {
+  free(values->region);
+  free(values->vtree);
+  free(values->w);
+  free(values->wd);
+  free(values->a1);
+  free(values->a0);
+}
+
+/****************************************************************************************
+ * evaluation of a single node
+ ****************************************************************************************/
+
+// Parameters of one E-SDP computation
+typedef struct {
+  SddWmc T;
+  SddLiteral d;
+  SddLiteral d_pos;         // Vtree position of the decision variable
+  SddWmc rd;                // Gap weight with the decision, relative to the
+                            // gap weight without it
+  SddLiteral xy_lo;         // Left-most positions below the XY- and
+  SddLiteral y_lo;          // Y-constrained nodes
+  const SddWmc* literal_weights;
+} EsdpContext;
+
+static EsdpContext esdp_context(const EsdpVtree* vt, const SddWmc* literal_weights,
+    SddLiteral d, SddWmc T, SddLiteral xy_pos, SddLiteral y_pos) {
+  EsdpContext ctx;
+  ctx.T = T;
+  ctx.d = d;
+  ctx.d_pos = vt->var_position[d < 0 ? -d : d];
+  ctx.rd = literal_weights[d] / (literal_weights[d] + literal_weights[-d]);
+  ctx.xy_lo = vt->lo[xy_pos];
+  ctx.y_lo = vt->lo[y_pos];
+  ctx.literal_weights = literal_weights;
+  return ctx;
+}
+
+static inline char decision_region(const EsdpVtree* vt, const EsdpContext* ctx,
+                                   const SddLiteral pos) {
+  if (pos >= ctx->xy_lo) return ESDP_REGION_Z;
+  if (!vt->on_spine[pos]) return ESDP_REGION_P;
+  if (pos < ctx->y_lo) return ESDP_REGION_Y;
+  return ESDP_REGION_X;
+}
+
+static inline void evaluate_constant(EsdpValues* v, const SddSize i, const int value) {
+  v->w[i] = v->wd[i] = value;
+  v->a1[i] = v->a0[i] = 0;
+  v->region[i] = ESDP_REGION_Z;
+}
+
+// Helper function: evaluate literal node i, whose vtree position is set
+static inline void evaluate_literal(EsdpValues* v, const EsdpContext* ctx,
+                                    const SddSize i, const SddLiteral literal) {
+  v->w[i] = ctx->literal_weights[literal];
+  v->wd[i] = (literal == -ctx->d) ? 0 : v->w[i];
+  v->region[i] = (v->vtree[i] >= ctx->xy_lo) ? ESDP_REGION_Z : ESDP_REGION_P;
+}
+
+// Helper function: evaluate decision node i, whose vtree position is set,
+// from its children. Prime and sub of element k are children[2k] and
+// children[2k+1], and are scaled by gaps[2k] and gaps[2k+1].
+static void evaluate_decision(EsdpValues* v, const EsdpVtree* vt,
+    const EsdpContext* ctx, const SddSize i, const SddSize elem_count,
+    const SddSize* children, const SddWmc* gaps) {
+  const SddLiteral pos = v->vtree[i];
+  const SddLiteral d_pos = ctx->d_pos;
+  const SddWmc T = ctx->T, rd = ctx->rd;
+  const char region = decision_region(vt, ctx, pos);
+  v->region[i] = region;
+
+  // The decision variable may be skipped by the prime (left child) or the
+  // sub (right child) of an element
+  const int d_left = vt->lo[pos] <= d_pos && d_pos < pos;
+  const int d_right = pos < d_pos && d_pos <= vt->hi[pos];
+
+  SddWmc w = 0, wd = 0, a1 = 0, a0 = 0;
+  for (SddSize k = 0; k < elem_count; k++) {
+    const SddSize p = children[2*k], s = children[2*k+1];
+    const SddWmc wp = v->w[p] * gaps[2*k];
+    if (wp == 0) continue;
+    const SddWmc sub_gap = gaps[2*k+1];
+    const SddWmc ws = v->w[s] * sub_gap;
+    SddWmc wds = v->wd[s] * sub_gap;
+    if (d_right && (v->vtree[s] < 0 ||
+        d_pos < vt->lo[v->vtree[s]] || vt->hi[v->vtree[s]] < d_pos)) {
+      wds *= rd;
+    }
+
+    if (region == ESDP_REGION_Z || region == ESDP_REGION_P) {
+      SddWmc wdp = v->wd[p] * gaps[2*k];
+      if (d_left && (v->vtree[p] < 0 ||
+          d_pos < vt->lo[v->vtree[p]] || vt->hi[v->vtree[p]] < d_pos)) {
+        wdp *= rd;
+      }
+      w += wp * ws;
+      wd += wdp * wds;
+    } else if (region == ESDP_REGION_X) {
+      w += wp * ws;
+      wd += wp * wds;
+      if (v->region[s] == ESDP_REGION_X) {
+        a1 += wp * v->a1[s] * sub_gap;
+        a0 += wp * v->a0[s] * sub_gap;
+      } else if (wds >= T * ws) { // sub decides the same for all x
+        a1 += wp * ws;
+      } else {
+        a0 += wp * ws;
+      }
+    } else { // ESDP_REGION_Y: a1 is ECA and a0 is MPA
+      w += wp * ws;
+      if (v->region[s] == ESDP_REGION_Y) {
+        a1 += wp * v->a1[s] * sub_gap;
+        a0 += wp * v->a0[s] * sub_gap;
+      } else if (v->region[s] == ESDP_REGION_X) {
+        // s is the Y-constrained node for some instantiation y
+        const SddWmc s1 = v->a1[s] * sub_gap;
+        const SddWmc s0 = v->a0[s] * sub_gap;
+        a1 += wp * ((wds >= T * ws) ? s1 : s0);
+        a0 += wp * ((s1 > s0) ? s1 : s0);
+      } else { // all instantiations x agree with y
+        a1 += wp * ws;
+        a0 += wp * ws;
+      }
+    }
+  }
+  v->w[i] = w;
+  v->wd[i] = wd;
+  v->a1[i] = a1;
+  v->a0[i] = a0;
+}
+
+// Helper function: MPA (and ECA via eca, if not NULL) from the values of
+// the root r
+static SddWmc root_mpa(const EsdpValues* v, const SddSize r, const SddWmc T,
+                       SddWmc* eca) {
+  SddWmc total = v->w[r], agreement, bound;
+  if (v->region[r] == ESDP_REGION_Y) {
+    agreement = v->a1[r];
+    bound = v->a0[r];
+  } else if (v->region[r] == ESDP_REGION_X) {
+    agreement = (v->wd[r] >= T * v->w[r]) ? v->a1[r] : v->a0[r];
+    bound = (v->a1[r] > v->a0[r]) ? v->a1[r] : v->a0[r];
+  } else {
+    agreement = bound = total;
+  }
+  if (total == 0) agreement = bound = total = 1; // inconsistent: nothing to agree on
+  if (eca != NULL) *eca = agreement / total;
+  return bound / total;
+}
+
+/****************************************************************************************
+ * flattened evaluator
+ ****************************************************************************************/
+
+// Capacities of the flat arrays while flattening
+typedef struct {
+  IndexMap map;             // SddNode* -> node index
+  SddSize capacity;
+  SddSize elem_capacity;
+  SddSize* stack;           // Child indices of nodes being flattened
+  SddSize stack_count;
+  SddSize stack_capacity;
+} FlattenState;
+
+// Helper function: append node (and, first, its descendants) to the flat
+// arrays. Return its index. Indices of children are kept on the stack of
+// state until the elements of node are written.
+static SddSize flatten_node(EsdpEvaluator* ev, FlattenState* state, SddNode* node) {
+  SddSize slot = index_map_slot(&state->map, (size_t) node);
+  if (state->map.keys[slot] == (size_t) node) return state->map.values[slot];
+
+  SddNodeSize size = 0;
+  SddSize stack_begin = state->stack_count;
+  if (sdd_node_is_decision(node)) {
+    size = sdd_node_size(node);
+    SddNode** elements = sdd_node_elements(node);
+    if (state->stack_count + 2 * size > state->stack_capacity) {
+      state->stack_capacity = 2 * (state->stack_count + 2 * size);
+      state->stack = (SddSize*) realloc(state->stack,
+                                        state->stack_capacity * sizeof(SddSize));
+    }
+    state->stack_count += 2 * size;
+    for (SddNodeSize e = 0; e < 2 * size; e++) {
+      state->stack[stack_begin + e] = flatten_node(ev, state, elements[e]);
+    }
+  }
+
+  if (ev->node_count == state->capacity) {
+    state->capacity *= 2;
+    ev->type = (char*) realloc(ev->type, state->capacity * sizeof(char));
+    ev->literal = (SddLiteral*) realloc(ev->literal, state->capacity * sizeof(SddLiteral));
+    ev->elem_begin = (SddSize*) realloc(ev->elem_begin,
+                                        (state->capacity + 1) * sizeof(SddSize));
+    esdp_values_resize(&ev->values, state->capacity);
+  }
+  SddSize i = ev->node_count++;
+  index_map_insert(&state->map, (size_t) node, i);
+  ev->elem_begin[i] = ev->elem_count;
+  SddLiteral* vtree = ev->values.vtree;
+  if (sdd_node_is_false(node)) {
+    ev->type[i] = ESDP_FALSE;
+    vtree[i] = -1;
+  } else if (sdd_node_is_true(node)) {
+    ev->type[i] = ESDP_TRUE;
+    vtree[i] = -1;
+  } else if (sdd_node_is_literal(node)) {
+    ev->type[i] = ESDP_LITERAL;
+    ev->literal[i] = sdd_node_literal(node);
+    vtree[i] = sdd_vtree_position(sdd_vtree_of(node));
+  } else {
+    ev->type[i] = ESDP_DECISION;
+    SddLiteral pos = sdd_vtree_position(sdd_vtree_of(node));
+    vtree[i] = pos;
+    if (ev->elem_count + size > state->elem_capacity) {
+      state->elem_capacity = 2 * (ev->elem_count + size);
+      ev->children = (SddSize*) realloc(ev->children,
+                                        2 * state->elem_capacity * sizeof(SddSize));
+      ev->gaps = (SddWmc*) realloc(ev->gaps, 2 * state->elem_capacity * sizeof(SddWmc));
+    }
+    SddLiteral left = ev->vtree.left[pos], right = ev->vtree.right[pos];
+    for (SddNodeSize e = 0; e < size; e++) {
+      SddSize p = state->stack[stack_begin + 2*e];
+      SddSize s = state->stack[stack_begin + 2*e + 1];
+      SddSize k = ev->elem_count++;
+      ev->children[2*k] = p;
+      ev->children[2*k+1] = s;
+      ev->gaps[2*k] = gap_factor(&ev->vtree, vtree[p], left);
+      ev->gaps[2*k+1] = gap_factor(&ev->vtree, vtree[s], right);
+    }
+  }
+  ev->elem_begin[i+1] = ev->elem_count;
+  state->stack_count = stack_begin;
+  return i;
+}
+
+// Flatten the SDD reachable from node, normalized for the vtree of manager
+EsdpEvaluator* esdp_evaluator_new(SddNode* node, SddManager* manager,
+                                  SddWmc* literal_weights) {
+  EsdpEvaluator* ev = (EsdpEvaluator*) malloc(sizeof(EsdpEvaluator));
+  ev->literal_weights = literal_weights;
+  esdp_vtree_init(&ev->vtree, manager);
+  flatten_vtree(&ev->vtree, literal_weights, sdd_manager_vtree(manager), -1, 1);
+
+  // The manager's node count bounds the number of decision nodes reachable
+  // from node, and sizes the arrays so that they rarely grow
+  SddSize capacity = sdd_manager_count(manager) + 2 * sdd_manager_var_count(manager) + 2;
+  FlattenState state;
+  index_map_init(&state.map, capacity);
+  state.capacity = capacity;
+  state.elem_capacity = 2 * capacity;
+  state.stack_count = 0;
+  state.stack_capacity = 1024;
+  state.stack = (SddSize*) malloc(state.stack_capacity * sizeof(SddSize));
+
+  ev->node_count = 0;
+  ev->type = (char*) malloc(state.capacity * sizeof(char));
+  ev->literal = (SddLiteral*) malloc(state.capacity * sizeof(SddLiteral));
+  ev->elem_begin = (SddSize*) malloc((state.capacity + 1) * sizeof(SddSize));
+  memset(&ev->values, 0, sizeof(EsdpValues));
+  esdp_values_resize(&ev->values, state.capacity);
+
+  ev->elem_count = 0;
+  ev->children = (SddSize*) malloc(2 * state.elem_capacity * sizeof(SddSize));
+  ev->gaps = (SddWmc*) malloc(2 * state.elem_capacity * sizeof(SddWmc));
+
+  flatten_node(ev, &state, node);
+  free(state.stack);
+  index_map_free(&state.map);
+  return ev;
+}
+
+void esdp_evaluator_free(EsdpEvaluator* ev) {
+  esdp_vtree_free(&ev->vtree);
+  free(ev->type);
+  free(ev->literal);
+  free(ev->elem_begin);
+  free(ev->children);
+  free(ev->gaps);
+  esdp_values_free(&ev->values);
+  free(ev);
+}
+
+// Compute the MPA of the Y features, and (via eca if not NULL) their ECA, for
+// decision literal d and threshold T. xy_pos and y_pos are the vtree
+// positions of the XY- and Y-constrained nodes.
+SddWmc esdp_compute_mpa(EsdpEvaluator* ev, SddLiteral d, SddWmc T,
+    SddLiteral xy_pos, SddLiteral y_pos, SddWmc* eca) {
+  EsdpContext ctx = esdp_context(&ev->vtree, ev->literal_weights, d, T, xy_pos, y_pos);
+  EsdpValues* v = &ev->values;
+  for (SddSize i = 0; i < ev->node_count; i++) {
+    switch (ev->type[i]) {
+      case ESDP_FALSE:
+        evaluate_constant(v, i, 0);
+        break;
+      case ESDP_TRUE:
+        evaluate_constant(v, i, 1);
+        break;
+      case ESDP_LITERAL:
+        evaluate_literal(v, &ctx, i, ev->literal[i]);
+        break;
+      default: {
+        SddSize begin = ev->elem_begin[i];
+        evaluate_decision(v, &ev->vtree, &ctx, i, ev->elem_begin[i+1] - begin,
+                          ev->children + 2 * begin, ev->gaps + 2 * begin);
+      }
+    }
+  }
+  // The root is the last node
+  return root_mpa(v, ev->node_count - 1, T, eca);
+}
+
+/****************************************************************************************
+ * incremental evaluator
+ ****************************************************************************************/
+
+EsdpCache* esdp_cache_new(SddManager* manager, SddWmc* literal_weights,
+                          SddLiteral d, SddWmc T) {
+  EsdpCache* cache = (EsdpCache*) malloc(sizeof(EsdpCache));
+  esdp_vtree_init(&cache->vtree, manager);
+  cache->decision = d;
+  cache->threshold = T;
+  cache->literal_weights = literal_weights;
+
+  SddSize capacity = sdd_manager_count(manager) + 2 * sdd_manager_var_count(manager) + 2;
+  index_map_init(&cache->map, capacity);
+
+  cache->entry_count = 0;
+  cache->entry_capacity = capacity;
+  cache->sweep_count = 2 * capacity;
+  cache->node = (SddNode**) malloc(capacity * sizeof(SddNode*));
+  cache->id = (SddSize*) malloc(capacity * sizeof(SddSize));
+  cache->epoch = (SddSize*) malloc(capacity * sizeof(SddSize));
+  cache->total = (long double*) malloc(capacity * sizeof(long double));
+  memset(&cache->values, 0, sizeof(EsdpValues));
+  esdp_values_resize(&cache->values, capacity);
+
+  cache->stack_count = 0;
+  cache->stack_capacity = 1024;
+  cache->stack_children = (SddSize*) malloc(cache->stack_capacity * sizeof(SddSize));
+  cache->stack_gaps = (SddWmc*) malloc(cache->stack_capacity * sizeof(SddWmc));
+
+  cache->cur_epoch = 0;
+  cache->visited = 0;
+  cache->recomputed = 0;
+  cache->recomputed_fraction = 0;
+  return cache;
+}
+
+void esdp_cache_free(EsdpCache* cache) {
+  esdp_vtree_free(&cache->vtree);
+  index_map_free(&cache->map);
+  free(cache->node);
+  free(cache->id);
+  free(cache->epoch);
+  free(cache->total);
+  esdp_values_free(&cache->values);
+  free(cache->stack_children);
+  free(cache->stack_gaps);
+  free(cache);
+}
+
+// Helper function: drop the entries of garbage collected nodes
+static void cache_sweep(EsdpCache* cache) {
+  EsdpValues* v = &cache->values;
+  SddSize n = 0;
+  index_map_clear(&cache->map);
+  for (SddSize e = 0; e < cache->entry_count; e++) {
+    if (sdd_garbage_collected(cache->node[e], cache->id[e])) continue;
+    cache->node[n] = cache->node[e];
+    cache->id[n] = cache->id[e];
+    cache->epoch[n] = cache->epoch[e];
+    cache->total[n] = cache->total[e];
+    v->region[n] = v->region[e];
+    v->vtree[n] = v->vtree[e];
+    v->w[n] = v->w[e];
+    v->wd[n] = v->wd[e];
+    v->a1[n] = v->a1[e];
+    v->a0[n] = v->a0[e];
+    index_map_insert(&cache->map, cache->id[n] + 1, n);
+    n++;
+  }
+  cache->entry_count = n;
+  if (cache->sweep_count < 2 * n) cache->sweep_count = 2 * n;
+}
+
+// Release the memory of the entries of garbage collected nodes, keeping the
+// entries of live nodes. Used when the process nears its memory limit.
+void esdp_cache_shrink(EsdpCache* cache) {
+  cache_sweep(cache);
+  SddSize capacity = cache->entry_count > 1024 ? cache->entry_count : 1024;
+  cache->entry_capacity = capacity;
+  cache->sweep_count = 2 * capacity;
+  cache->node = (SddNode**) realloc(cache->node, capacity * sizeof(SddNode*));
+  cache->id = (SddSize*) realloc(cache->id, capacity * sizeof(SddSize));
+  cache->epoch = (SddSize*) realloc(cache->epoch, capacity * sizeof(SddSize));
+  cache->total = (long double*) realloc(cache->total, capacity * sizeof(long double));
+  esdp_values_resize(&cache->values, capacity);
+  index_map_free(&cache->map);
+  index_map_init(&cache->map, capacity);
+  for (SddSize e = 0; e < cache->entry_count; e++) {
+    index_map_insert(&cache->map, cache->id[e] + 1, e);
+  }
+  cache->stack_capacity = 1024;
+  cache->stack_children = (SddSize*) realloc(cache->stack_children,
+                                             cache->stack_capacity * sizeof(SddSize));
+  cache->stack_gaps = (SddWmc*) realloc(cache->stack_gaps,
+                                        cache->stack_capacity * sizeof(SddWmc));
+}
+
+// Helper function: add an entry for node, with no values yet
+static SddSize cache_add_entry(EsdpCache* cache, SddNode* node, const SddSize id) {
+  if (cache->entry_count == cache->entry_capacity) {
+    cache->entry_capacity *= 2;
+    SddSize capacity = cache->entry_capacity;
+    cache->node = (SddNode**) realloc(cache->node, capacity * sizeof(SddNode*));
+    cache->id = (SddSize*) realloc(cache->id, capacity * sizeof(SddSize));
+    cache->epoch = (SddSize*) realloc(cache->epoch, capacity * sizeof(SddSize));
+    cache->total = (long double*) realloc(cache->total, capacity * sizeof(long double));
+    esdp_values_resize(&cache->values, capacity);
+  }
+  SddSize e = cache->entry_count++;
+  cache->node[e] = node;
+  cache->id[e] = id;
+  cache->epoch[e] = 0;
+  cache->values.region[e] = -1; // not evaluated
+  index_map_insert(&cache->map, id + 1, e);
+  return e;
+}
+
+// Helper function: evaluate node in the current call, reusing its values from
+// earlier calls if they are still valid. Return the entry of node.
+static SddSize cache_evaluate(EsdpCache* cache, const EsdpContext* ctx, SddNode* node) {
+  SddSize id = sdd_id(node);
+  SddSize slot = index_map_slot(&cache->map, id + 1);
+  SddSize e;
+  if (cache->map.keys[slot] != 0) {
+    e = cache->map.values[slot];
+    if (cache->epoch[e] == cache->cur_epoch) return e;
+  } else {
+    e = cache_add_entry(cache, node, id);
+  }
+  cache->epoch[e] = cache->cur_epoch;
+
+  EsdpValues* v = &cache->values;
+  if (sdd_node_is_false(node) || sdd_node_is_true(node)) {
+    v->vtree[e] = -1;
+    evaluate_constant(v, e, sdd_node_is_true(node));
+    return e;
+  }
+  const EsdpVtree* vt = &cache->vtree;
+  SddLiteral pos = sdd_vtree_position(sdd_vtree_of(node));
+  v->vtree[e] = pos;
+  if (sdd_node_is_literal(node)) {
+    evaluate_literal(v, ctx, e, sdd_node_literal(node));
+    return e;
+  }
+
+  // Values of the P, X and Z regions stay valid while the node lives
+  cache->visited++;
+  char region = decision_region(vt, ctx, pos);
+  if (region == v->region[e] && region != ESDP_REGION_Y) {
+    if (vt->total[pos] != cache->total[e]) {
+      // Variables that the node does not mention entered or left its vtree
+      SddWmc ratio = (SddWmc) (vt->total[pos] / cache->total[e]);
+      v->w[e] *= ratio;
+      v->wd[e] *= ratio;
+      v->a1[e] *= ratio;
+      v->a0[e] *= ratio;
+      cache->total[e] = vt->total[pos];
+    }
+    return e;
+  }
+
+  cache->recomputed++;
+  SddNodeSize size = sdd_node_size(node);
+  SddNode** elements = sdd_node_elements(node);
+  SddSize begin = cache->stack_count;
+  if (begin + 2 * size > cache->stack_capacity) {
+    cache->stack_capacity = 2 * (begin + 2 * size);
+    cache->stack_children = (SddSize*) realloc(cache->stack_children,
+                                               cache->stack_capacity * sizeof(SddSize));
+    cache->stack_gaps = (SddWmc*) realloc(cache->stack_gaps,
+                                          cache->stack_capacity * sizeof(SddWmc));
+  }
+  cache->stack_count += 2 * size;
+  for (SddNodeSize k = 0; k < 2 * size; k++) {
+    cache->stack_children[begin + k] = cache_evaluate(cache, ctx, elements[k]);
+  }
+
+  SddSize* children = cache->stack_children + begin;
+  SddWmc* gaps = cache->stack_gaps + begin;
+  SddLiteral left = vt->left[pos], right = vt->right[pos];
+  for (SddNodeSize k = 0; k < size; k++) {
+    gaps[2*k] = gap_factor(vt, v->vtree[children[2*k]], left);
+    gaps[2*k+1] = gap_factor(vt, v->vtree[children[2*k+1]], right);
+  }
+  evaluate_decision(v, vt, ctx, e, size, children, gaps);
+  cache->total[e] = vt->total[pos];
+  cache->stack_count = begin;
+  return e;
+}
+
+// Compute the MPA of the Y features, and (via eca if not NULL) their ECA,
+// like esdp_compute_mpa, evaluating only the nodes whose values are not
+// cached from earlier calls
+SddWmc esdp_compute_mpa_incremental(EsdpCache* cache, SddNode* node,
+    SddManager* manager, SddLiteral xy_pos, SddLiteral y_pos, SddWmc* eca) {
+  // Entries can only move between calls
+  if (cache->entry_count >= cache->sweep_count) cache_sweep(cache);
+
+  flatten_vtree(&cache->vtree, cache->literal_weights, sdd_manager_vtree(manager), -1, 1);
+  EsdpContext ctx = esdp_context(&cache->vtree, cache->literal_weights,
+                                 cache->decision, cache->threshold, xy_pos, y_pos);
+  cache->cur_epoch++;
+  SddSize recomputed = cache->recomputed;
+  SddSize r = cache_evaluate(cache, &ctx, node);
+
+  SddSize node_count = sdd_manager_live_count(manager);
+  if (node_count > 0) {
+    cache->recomputed_fraction += (double) (cache->recomputed - recomputed) / node_count;
+  }
+  return root_mpa(&cache->values, r, cache->threshold, eca);
+}
+
+/****************************************************************************************
+ * batched thresholds
+ *
+ * Model counts w and wd do not depend on the threshold, so one pass computes
+ * them once per node. Only the X and Y region values a1 and a0 are kept per
+ * threshold, in rows of ESDP_BATCH_WIDTH-padded vectors, and their arithmetic
+ * is done by the kernels below. The AVX2 and AVX-512 kernels are compiled for
+ * their targets and chosen at run time. All kernels multiply and add in the
+ * same order as evaluate_decision, so that their results are identical to
+ * those of esdp_compute_mpa.
+ ****************************************************************************************/
+
+typedef struct {
+  const char* name;
+  // a += (wp * s) * gap
+  void (*scaled_add)(SddWmc* a1, SddWmc* a0, const SddWmc* s1, const SddWmc* s0,
+                     const SddWmc wp, const SddWmc gap, const SddSize n);
+  // a1 += c if wds >= T * ws, else a0 += c
+  void (*classified_add)(SddWmc* a1, SddWmc* a0, const SddWmc* T,
+                         const SddWmc wds, const SddWmc ws, const SddWmc c,
+                         const SddSize n);
+  // with s = s * gap: a1 += wp * (wds >= T * ws ? s1 : s0), a0 += wp * max(s1, s0)
+  void (*agreement_add)(SddWmc* a1, SddWmc* a0, const SddWmc* T,
+                        const SddWmc* s1, const SddWmc* s0, const SddWmc wds,
+                        const SddWmc ws, const SddWmc wp, const SddWmc gap,
+                        const SddSize n);
+} BatchKernels;
+
+static void scalar_scaled_add(SddWmc* a1, SddWmc* a0, const SddWmc* s1,
+    const SddWmc* s0, const SddWmc wp, const SddWmc gap, const SddSize n) {
+  for (SddSize t = 0; t < n; t++) {
+    a1[t] += wp * s1[t] * gap;
+    a0[t] += wp * s0[t] * gap;
+  }
+}
+
+static void scalar_classified_add(SddWmc* a1, SddWmc* a0, const SddWmc* T,
+    const SddWmc wds, const SddWmc ws, const SddWmc c, const SddSize n) {
+  for (SddSize t = 0; t < n; t++) {
+    if (wds >= T[t] * ws) a1[t] += c;
+    else a0[t] += c;
+  }
+}
+
+static void scalar_agreement_add(SddWmc* a1, SddWmc* a0, const SddWmc* T,
+    const SddWmc* s1, const SddWmc* s0, const SddWmc wds, const SddWmc ws,
+    const SddWmc wp, const SddWmc gap, const SddSize n) {
+  for (SddSize t = 0; t < n; t++) {
+    const SddWmc g1 = s1[t] * gap, g0 = s0[t] * gap;
+    a1[t] += wp * ((wds >= T[t] * ws) ? g1 : g0);
+    a0[t] += wp * ((g1 > g0) ? g1 : g0);
+  }
+}
+
+static const BatchKernels scalar_kernels = {
+  "scalar", scalar_scaled_add, scalar_classified_add, scalar_agreement_add
+};
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+static void avx2_scaled_add(SddWmc* a1, SddWmc* a0, const SddWmc* s1,
+    const SddWmc* s0, const SddWmc wp, const SddWmc gap, const SddSize n) {
+  const __m256d vwp = _mm256_set1_pd(wp), vgap = _mm256_set1_pd(gap);
+  for (SddSize t = 0; t < n; t += 4) {
+    __m256d x1 = _mm256_mul_pd(_mm256_mul_pd(vwp, _mm256_loadu_pd(s1 + t)), vgap);
+    __m256d x0 = _mm256_mul_pd(_mm256_mul_pd(vwp, _mm256_loadu_pd(s0 + t)), vgap);
+    _mm256_storeu_pd(a1 + t, _mm256_add_pd(_mm256_loadu_pd(a1 + t), x1));
+    _mm256_storeu_pd(a0 + t, _mm256_add_pd(_mm256_loadu_pd(a0 + t), x0));
+  }
+}
+
+__attribute__((target("avx2")))
+static void avx2_classified_add(SddWmc* a1, SddWmc* a0, const SddWmc* T,
+    const SddWmc wds, const SddWmc ws, const SddWmc c, const SddSize n) {
+  const __m256d vwds = _mm256_set1_pd(wds), vws = _mm256_set1_pd(ws);
+  const __m256d vc = _mm256_set1_pd(c);
+  for (SddSize t = 0; t < n; t += 4) {
+    __m256d mask = _mm256_cmp_pd(vwds, _mm256_mul_pd(_mm256_loadu_pd(T + t), vws),
+                                 _CMP_GE_OQ);
+    _mm256_storeu_pd(a1 + t, _mm256_add_pd(_mm256_loadu_pd(a1 + t),
+                                           _mm256_and_pd(mask, vc)));
+    _mm256_storeu_pd(a0 + t, _mm256_add_pd(_mm256_loadu_pd(a0 + t),
+                                           _mm256_andnot_pd(mask, vc)));
+  }
+}
+
+__attribute__((target("avx2")))
+static void avx2_agreement_add(SddWmc* a1, SddWmc* a0, const SddWmc* T,
+    const SddWmc* s1, const SddWmc* s0, const SddWmc wds, const SddWmc ws,
+    const SddWmc wp, const SddWmc gap, const SddSize n) {
+  const __m256d vwds = _mm256_set1_pd(wds), vws = _mm256_set1_pd(ws);
+  const __m256d vwp = _mm256_set1_pd(wp), vgap = _mm256_set1_pd(gap);
+  for (SddSize t = 0; t < n; t += 4) {
+    __m256d g1 = _mm256_mul_pd(_mm256_loadu_pd(s1 + t), vgap);
+    __m256d g0 = _mm256_mul_pd(_mm256_loadu_pd(s0 + t), vgap);
+    __m256d mask = _mm256_cmp_pd(vwds, _mm256_mul_pd(_mm256_loadu_pd(T + t), vws),
+                                 _CMP_GE_OQ);
+    __m256d agree = _mm256_blendv_pd(g0, g1, mask);
+    __m256d best = _mm256_blendv_pd(g0, g1, _mm256_cmp_pd(g1, g0, _CMP_GT_OQ));
+    _mm256_storeu_pd(a1 + t, _mm256_add_pd(_mm256_loadu_pd(a1 + t),
+                                           _mm256_mul_pd(vwp, agree)));
+    _mm256_storeu_pd(a0 + t, _mm256_add_pd(_mm256_loadu_pd(a0 + t),
+                                           _mm256_mul_pd(vwp, best)));
+  }
+}
+
+static const BatchKernels avx2_kernels = {
+  "avx2", avx2_scaled_add, avx2_classified_add, avx2_agreement_add
+};
+
+__attribute__((target("avx512f")))
+static void avx512_scaled_add(SddWmc* a1, SddWmc* a0, const SddWmc* s1,
+    const SddWmc* s0, const SddWmc wp, const SddWmc gap, const SddSize n) {
+  const __m512d vwp = _mm512_set1_pd(wp), vgap = _mm512_set1_pd(gap);
+  for (SddSize t = 0; t < n; t += 8) {
+    __m512d x1 = _mm512_mul_pd(_mm512_mul_pd(vwp, _mm512_loadu_pd(s1 + t)), vgap);
+    __m512d x0 = _mm512_mul_pd(_mm512_mul_pd(vwp, _mm512_loadu_pd(s0 + t)), vgap);
+    _mm512_storeu_pd(a1 + t, _mm512_add_pd(_mm512_loadu_pd(a1 + t), x1));
+    _mm512_storeu_pd(a0 + t, _mm512_add_pd(_mm512_loadu_pd(a0 + t), x0));
+  }
+}
+
+__attribute__((target("avx512f")))
+static void avx512_classified_add(SddWmc* a1, SddWmc* a0, const SddWmc* T,
+    const SddWmc wds, const SddWmc ws, const SddWmc c, const SddSize n) {
+  const __m512d vwds = _mm512_set1_pd(wds), vws = _mm512_set1_pd(ws);
+  const __m512d vc = _mm512_set1_pd(c);
+  for (SddSize t = 0; t < n; t += 8) {
+    __mmask8 mask = _mm512_cmp_pd_mask(vwds,
+        _mm512_mul_pd(_mm512_loadu_pd(T + t), vws), _CMP_GE_OQ);
+    __m512d x1 = _mm512_loadu_pd(a1 + t), x0 = _mm512_loadu_pd(a0 + t);
+    _mm512_storeu_pd(a1 + t, _mm512_mask_add_pd(x1, mask, x1, vc));
+    _mm512_storeu_pd(a0 + t, _mm512_mask_add_pd(x0, (__mmask8) ~mask, x0, vc));
+  }
+}
+
+__attribute__((target("avx512f")))
+static void avx512_agreement_add(SddWmc* a1, SddWmc* a0, const SddWmc* T,
+    const SddWmc* s1, const SddWmc* s0, const SddWmc wds, const SddWmc ws,
+    const SddWmc wp, const SddWmc gap, const SddSize n) {
+  const __m512d vwds = _mm512_set1_pd(wds), vws = _mm512_set1_pd(ws);
+  const __m512d vwp = _mm512_set1_pd(wp), vgap = _mm512_set1_pd(gap);
+  for (SddSize t = 0; t < n; t += 8) {
+    __m512d g1 = _mm512_mul_pd(_mm512_loadu_pd(s1 + t), vgap);
+    __m512d g0 = _mm512_mul_pd(_mm512_loadu_pd(s0 + t), vgap);
+    __mmask8 mask = _mm512_cmp_pd_mask(vwds,
+        _mm512_mul_pd(_mm512_loadu_pd(T + t), vws), _CMP_GE_OQ);
+    __m512d agree = _mm512_mask_blend_pd(mask, g0, g1);
+    __m512d best = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(g1, g0, _CMP_GT_OQ), g0, g1);
+    _mm512_storeu_pd(a1 + t, _mm512_add_pd(_mm512_loadu_pd(a1 + t),
+                                           _mm512_mul_pd(vwp, agree)));
+    _mm512_storeu_pd(a0 + t, _mm512_add_pd(_mm512_loadu_pd(a0 + t),
+                                           _mm512_mul_pd(vwp, best)));
+  }
+}
+
+static const BatchKernels avx512_kernels = {
+  "avx512", avx512_scaled_add, avx512_classified_add, avx512_agreement_add
+};
+#endif
+
+static const BatchKernels* selected_kernels = NULL;
+
+// Helper function: kernels for the widest instruction set of this machine,
+// unless others were selected
+static const BatchKernels* batch_kernels() {
+  if (selected_kernels != NULL) return selected_kernels;
+  selected_kernels = &scalar_kernels;
+#if defined(__GNUC__) && defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) selected_kernels = &avx512_kernels;
+  else if (__builtin_cpu_supports("avx2")) selected_kernels = &avx2_kernels;
+#endif
+  return selected_kernels;
+}
+
+const char* esdp_batch_kernel_name() {
+  return batch_kernels()->name;
+}
+
+// Select the kernels of esdp_compute_mpa_batch by name ("scalar", "avx2" or
+// "avx512"), or the widest supported ones if name is NULL. Return 0 if this
+// machine does not support them.
+int esdp_select_batch_kernel(const char* name) {
+  selected_kernels = NULL;
+  if (name == NULL) return 1;
+  if (strcmp(name, "scalar") == 0) {
+    selected_kernels = &scalar_kernels;
+    return 1;
+  }
+#if defined(__GNUC__) && defined(__x86_64__)
+  __builtin_cpu_init();
+  if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+    selected_kernels = &avx2_kernels;
+    return 1;
+  }
+  if (strcmp(name, "avx512") == 0 && __builtin_cpu_supports("avx512f")) {
+    selected_kernels = &avx512_kernels;
+    return 1;
+  }
+#endif
+  return 0;
+}
+
+// Helper function: evaluate decision node i of the X or Y region like
+// evaluate_decision, for all thresholds. a1 and a0 of the node with row r
+// are a1[r*n..(r+1)*n) and a0[r*n..(r+1)*n).
+static void evaluate_decision_batch(EsdpValues* v, const EsdpVtree* vt,
+    const EsdpContext* ctx, const BatchKernels* kernels, const SddSize i,
+    const SddSize elem_count, const SddSize* children, const SddWmc* gaps,
+    const SddSize* row, SddWmc* a1, SddWmc* a0, const SddWmc* T, const SddSize n) {
+  const SddLiteral pos = v->vtree[i];
+  const SddLiteral d_pos = ctx->d_pos;
+  const char region = v->region[i];
+  const int d_right = pos < d_pos && d_pos <= vt->hi[pos];
+  SddWmc* a1_i = a1 + row[i] * n;
+  SddWmc* a0_i = a0 + row[i] * n;
+  memset(a1_i, 0, n * sizeof(SddWmc));
+  memset(a0_i, 0, n * sizeof(SddWmc));
+
+  SddWmc w = 0, wd = 0;
+  for (SddSize k = 0; k < elem_count; k++) {
+    const SddSize p = children[2*k], s = children[2*k+1];
+    const SddWmc wp = v->w[p] * gaps[2*k];
+    if (wp == 0) continue;
+    const SddWmc sub_gap = gaps[2*k+1];
+    const SddWmc ws = v->w[s] * sub_gap;
+    SddWmc wds = v->wd[s] * sub_gap;
+    if (d_right && (v->vtree[s] < 0 ||
+        d_pos < vt->lo[v->vtree[s]] || vt->hi[v->vtree[s]] < d_pos)) {
+      wds *= ctx->rd;
+    }
+
+    w += wp * ws;
+    if (region == ESDP_REGION_X) {
+      wd += wp * wds;
+      if (v->region[s] == ESDP_REGION_X) {
+        kernels->scaled_add(a1_i, a0_i, a1 + row[s] * n, a0 + row[s] * n,
+                            wp, sub_gap, n);
+      } else {
+        kernels->classified_add(a1_i, a0_i, T, wds, ws, wp * ws, n);
+      }
+    } else { // ESDP_REGION_Y
+      if (v->region[s] == ESDP_REGION_Y) {
+        kernels->scaled_add(a1_i, a0_i, a1 + row[s] * n, a0 + row[s] * n,
+                            wp, sub_gap, n);
+      } else if (v->region[s] == ESDP_REGION_X) {
+        kernels->agreement_add(a1_i, a0_i, T, a1 + row[s] * n, a0 + row[s] * n,
+                               wds, ws, wp, sub_gap, n);
+      } else {
+        // all instantiations x agree with y, for every threshold
+        const SddWmc c = wp * ws;
+        for (SddSize t = 0; t < n; t++) {
+          a1_i[t] += c;
+          a0_i[t] += c;
+        }
+      }
+    }
+  }
+  v->w[i] = w;
+  v->wd[i] = wd;
+}
+
+// Compute MPA (and ECA, if eca is not NULL) of the Y features for each of
+// num_thresholds thresholds, in a single pass over the flattened SDD. mpa
+// and eca receive one value per threshold.
+void esdp_compute_mpa_batch(EsdpEvaluator* ev, SddLiteral d,
+    const SddWmc* thresholds, SddSize num_thresholds,
+    SddLiteral xy_pos, SddLiteral y_pos, SddWmc* mpa, SddWmc* eca) {
+  if (num_thresholds == 0) return;
+  const BatchKernels* kernels = batch_kernels();
+  EsdpContext ctx = esdp_context(&ev->vtree, ev->literal_weights, d,
+                                 thresholds[0], xy_pos, y_pos);
+  EsdpValues* v = &ev->values;
+
+  // Pad thresholds to whole vectors
+  SddSize n = (num_thresholds + ESDP_BATCH_WIDTH - 1) / ESDP_BATCH_WIDTH
+              * ESDP_BATCH_WIDTH;
+  SddWmc* T = (SddWmc*) malloc(n * sizeof(SddWmc));
+  for (SddSize t = 0; t < n; t++) {
+    T[t] = thresholds[t < num_thresholds ? t : num_thresholds - 1];
+  }
+
+  // Rows of per-threshold values for the decision nodes of the X and Y regions
+  SddSize* row = (SddSize*) malloc(ev->node_count * sizeof(SddSize));
+  SddSize row_count = 0;
+  for (SddSize i = 0; i < ev->node_count; i++) {
+    if (ev->type[i] != ESDP_DECISION) continue;
+    v->region[i] = decision_region(&ev->vtree, &ctx, v->vtree[i]);
+    if (v->region[i] == ESDP_REGION_X || v->region[i] == ESDP_REGION_Y) {
+      row[i] = row_count++;
+    }
+  }
+  SddWmc* a1 = (SddWmc*) malloc((row_count * n + 1) * sizeof(SddWmc));
+  SddWmc* a0 = (SddWmc*) malloc((row_count * n + 1) * sizeof(SddWmc));
+
+  for (SddSize i = 0; i < ev->node_count; i++) {
+    switch (ev->type[i]) {
+      case ESDP_FALSE:
+        evaluate_constant(v, i, 0);
+        break;
+      case ESDP_TRUE:
+        evaluate_constant(v, i, 1);
+        break;
+      case ESDP_LITERAL:
+        evaluate_literal(v, &ctx, i, ev->literal[i]);
+        break;
+      default: {
+        SddSize begin = ev->elem_begin[i];
+        if (v->region[i] == ESDP_REGION_X || v->region[i] == ESDP_REGION_Y) {
+          evaluate_decision_batch(v, &ev->vtree, &ctx, kernels, i,
+              ev->elem_begin[i+1] - begin, ev->children + 2 * begin,
+              ev->gaps + 2 * begin, row, a1, a0, T, n);
+        } else {
+          evaluate_decision(v, &ev->vtree, &ctx, i, ev->elem_begin[i+1] - begin,
+                            ev->children + 2 * begin, ev->gaps + 2 * begin);
+        }
+      }
+    }
+  }
+
+  // The root is the last node
+  SddSize r = ev->node_count - 1;
+  for (SddSize t = 0; t < num_thresholds; t++) {
+    SddWmc total = v->w[r], agreement, bound;
+    if (v->region[r] == ESDP_REGION_Y) {
+      agreement = a1[row[r] * n + t];
+      bound = a0[row[r] * n + t];
+    } else if (v->region[r] == ESDP_REGION_X) {
+      SddWmc r1 = a1[row[r] * n + t], r0 = a0[row[r] * n + t];
+      agreement = (v->wd[r] >= T[t] * v->w[r]) ? r1 : r0;
+      bound = (r1 > r0) ? r1 : r0;
+    } else {
+      agreement = bound = total;
+    }
+    if (total == 0) agreement = bound = total = 1; // inconsistent: nothing to agree on
+    if (eca != NULL) eca[t] = agreement / total;
+    mpa[t] = bound / total;
+  }
+
+  free(T);
+  free(row);
+  free(a1);
+  free(a0);
+}
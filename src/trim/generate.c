@@ -0,0 +1,278 @@
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "network.h"
+#include "generate.h"
+
+/****************************************************************************************
+ * generates random Bayesian network classifiers, and writes them in the
+ * formats that trim reads:
+ *  --node 0 is the binary class "C", and nodes 1..n are the features F1..Fn
+ *  --CPT rows are drawn uniformly from [0.05, 1.05) per value and normalized,
+ *    with 6 decimals, so that the .net file and the encoding agree exactly
+ *  --with an exchangeable group size g > 1, features F1..Fg, Fg+1..F2g, ...
+ *    copy the arity, cost and (given the same parents) CPT of the first
+ *    feature of their group, so that the search can skip symmetric subsets
+ *  --all randomness comes from a splitmix64 generator, so that a seed gives
+ *    the same files on every platform
+ ****************************************************************************************/
+
+typedef struct {
+  uint64_t state;
+} Rng;
+
+static uint64_t rng_next(Rng* rng) {
+  uint64_t z = (rng->state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// Uniform in [0,1)
+static double rng_uniform(Rng* rng) {
+  return (rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Uniform in [lo,hi]
+static int rng_int(Rng* rng, const int lo, const int hi) {
+  return lo + (int) (rng_next(rng) % (uint64_t) (hi - lo + 1));
+}
+
+static double round6(const double value) {
+  return round(value * 1e6) / 1e6;
+}
+
+// Helper function: fill the CPT of node with random rows
+static void random_cpt(Rng* rng, const BayesNet* bn, BnNode* node) {
+  int rows = 1;
+  for (int j = 0; j < node->num_parents; j++) {
+    rows *= bn->nodes[node->parents[j]].num_states;
+  }
+  node->cpt = (double*) malloc(rows * node->num_states * sizeof(double));
+  for (int r = 0; r < rows; r++) {
+    double* row = node->cpt + r * node->num_states;
+    double sum = 0;
+    for (int s = 0; s < node->num_states; s++) sum += (row[s] = 0.05 + rng_uniform(rng));
+    double rest = 1;
+    for (int s = 0; s < node->num_states - 1; s++) rest -= (row[s] = round6(row[s] / sum));
+    row[node->num_states-1] = round6(rest);
+  }
+}
+
+// Helper function: first feature of the exchangeable group of feature node i
+static int group_leader(const GeneratorOptions* options, const int i) {
+  int g = options->exchangeable_group > 1 ? options->exchangeable_group : 1;
+  return 1 + (i - 1) / g * g;
+}
+
+// Generate a classifier with the structure of options. Feature costs are
+// returned via costs (costs[i] for feature F(i+1)).
+BayesNet* generate_bayes_net(const GeneratorOptions* options, double** costs) {
+  Rng rng = { options->seed };
+  int n = options->num_features + 1;
+  BayesNet* bn = (BayesNet*) malloc(sizeof(BayesNet));
+  bn->node_count = n;
+  bn->nodes = (BnNode*) calloc(n, sizeof(BnNode));
+  *costs = (double*) malloc(options->num_features * sizeof(double));
+  char name[32];
+  for (int i = 0; i < n; i++) {
+    BnNode* node = bn->nodes + i;
+    if (i == 0) {
+      node->name = strdup("C");
+      node->num_states = 2;
+    } else {
+      sprintf(name, "F%d", i);
+      node->name = strdup(name);
+      node->num_states = rng_int(&rng, options->min_arity, options->max_arity);
+      double cost = options->min_cost
+                    + rng_uniform(&rng) * (options->max_cost - options->min_cost);
+      (*costs)[i-1] = fmax(0.1, round(10 * cost) / 10);
+      int leader = group_leader(options, i);
+      if (leader != i) {
+        node->num_states = bn->nodes[leader].num_states;
+        (*costs)[i-1] = (*costs)[leader-1];
+      }
+    }
+    node->parents = (int*) malloc(n * sizeof(int));
+  }
+
+  if (options->structure == GENERATE_DAG) {
+    // Random order of the nodes; each node draws parents among the ones
+    // before it, expecting max_parents / 2 of them. Features after the class
+    // also get the class as a parent, and features before it are its
+    // candidate parents.
+    int* order = (int*) malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) order[i] = i;
+    for (int i = n - 1; i > 0; i--) {
+      int j = rng_int(&rng, 0, i);
+      int tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+    }
+    for (int p = 1; p < n; p++) {
+      BnNode* node = bn->nodes + order[p];
+      double probability = fmin(1.0, 0.5 * options->max_parents / p);
+      int after_class = 0;
+      for (int q = 0; q < p; q++) {
+        if (order[q] == 0) {
+          after_class = 1;
+        } else if (node->num_parents < options->max_parents &&
+                   rng_uniform(&rng) < probability) {
+          node->parents[node->num_parents++] = order[q];
+        }
+      }
+      if (after_class) node->parents[node->num_parents++] = 0;
+    }
+    free(order);
+  } else {
+    for (int i = 1; i < n; i++) {
+      BnNode* node = bn->nodes + i;
+      node->parents[node->num_parents++] = 0;
+      if (options->structure == GENERATE_TAN && i > 1) {
+        node->parents[node->num_parents++] = rng_int(&rng, 1, i - 1);
+      }
+    }
+  }
+
+  for (int i = 0; i < n; i++) random_cpt(&rng, bn, bn->nodes + i);
+  for (int i = 1; i < n; i++) {
+    BnNode* node = bn->nodes + i;
+    BnNode* leader = bn->nodes + group_leader(options, i);
+    if (leader == node || leader->num_parents != node->num_parents ||
+        memcmp(leader->parents, node->parents, node->num_parents * sizeof(int)) != 0) {
+      continue;
+    }
+    int size = node->num_states;
+    for (int j = 0; j < node->num_parents; j++) size *= bn->nodes[node->parents[j]].num_states;
+    memcpy(node->cpt, leader->cpt, size * sizeof(double));
+  }
+  return bn;
+}
+
+static FILE* open_output(const char* filename) {
+  FILE* fp = fopen(filename, "w");
+  if (fp == NULL) {
+    fprintf(stderr, "Could not open output file %s\n", filename);
+    exit(1);
+  }
+  return fp;
+}
+
+// Write a network in HUGIN .net format, as read by read_hugin_net
+void write_hugin_net(const BayesNet* bn, const char* filename) {
+  FILE* fp = open_output(filename);
+  fprintf(fp, "net\n{\n}\n");
+  for (int i = 0; i < bn->node_count; i++) {
+    const BnNode* node = bn->nodes + i;
+    fprintf(fp, "node %s\n{\n  states = (", node->name);
+    for (int s = 0; s < node->num_states; s++) fprintf(fp, "%s\"s%d\"", s ? " " : "", s);
+    fprintf(fp, ");\n}\n");
+  }
+  for (int i = 0; i < bn->node_count; i++) {
+    const BnNode* node = bn->nodes + i;
+    fprintf(fp, "potential (%s%s", node->name, node->num_parents ? " |" : "");
+    int rows = 1;
+    for (int j = 0; j < node->num_parents; j++) {
+      fprintf(fp, " %s", bn->nodes[node->parents[j]].name);
+      rows *= bn->nodes[node->parents[j]].num_states;
+    }
+    fprintf(fp, ")\n{\n  data = (");
+    for (int r = 0; r < rows; r++) {
+      fprintf(fp, "%s(", r ? " " : "");
+      for (int s = 0; s < node->num_states; s++) {
+        fprintf(fp, "%s%.6f", s ? " " : "", node->cpt[r * node->num_states + s]);
+      }
+      fprintf(fp, ")");
+    }
+    fprintf(fp, ");\n}\n");
+  }
+  fclose(fp);
+}
+
+// Write a CNF in DIMACS format
+void write_cnf(const Fnf* fnf, const char* filename) {
+  FILE* fp = open_output(filename);
+  fprintf(fp, "c cnf generated by netgen\np cnf %"PRIlitS" %"PRIsS"\n",
+          fnf->var_count, fnf->litset_count);
+  for (SddSize i = 0; i < fnf->litset_count; i++) {
+    const LitSet* clause = fnf->litsets + i;
+    for (SddLiteral j = 0; j < clause->literal_count; j++) {
+      fprintf(fp, "%"PRIlitS" ", clause->literals[j]);
+    }
+    fprintf(fp, "0\n");
+  }
+  fclose(fp);
+}
+
+// Write the literal map of an encoding (as returned by encode_bayes_net) in
+// the .lmap format of ACE, as read by parse_lmap
+void write_lmap(const BayesNet* bn, const size_t var_count,
+    char** sorted_node_names, SddLiteral** sorted_node_indicators,
+    SddSize* sorted_node_num_indicators, const SddWmc* weights,
+    const char* filename) {
+  // Node and value of each indicator variable (-1 for parameters)
+  int* var_node = (int*) malloc((var_count + 1) * sizeof(int));
+  int* var_value = (int*) malloc((var_count + 1) * sizeof(int));
+  for (size_t v = 0; v <= var_count; v++) var_node[v] = -1;
+  for (int k = 0; k < bn->node_count; k++) {
+    for (SddSize s = 0; s < sorted_node_num_indicators[k]; s++) {
+      var_node[sorted_node_indicators[k][s]] = k;
+      var_value[sorted_node_indicators[k][s]] = s;
+    }
+  }
+
+  FILE* fp = open_output(filename);
+  fprintf(fp, "c Following is the literal map:\nc\ncc$K$ALWAYS_SUM\ncc$S$NORMAL\n");
+  fprintf(fp, "cc$N$%zu\ncc$v$%d\n", var_count, bn->node_count);
+  for (int k = 0; k < bn->node_count; k++) {
+    fprintf(fp, "cc$V$%s$%"PRIsS"\n", sorted_node_names[k], sorted_node_num_indicators[k]);
+  }
+  fprintf(fp, "cc$t$%d\n", bn->node_count);
+  for (int k = 0; k < bn->node_count; k++) {
+    const BnNode* node = NULL;
+    for (int i = 0; i < bn->node_count; i++) {
+      if (strcmp(bn->nodes[i].name, sorted_node_names[k]) == 0) node = bn->nodes + i;
+    }
+    int size = node->num_states;
+    for (int j = 0; j < node->num_parents; j++) {
+      size *= bn->nodes[node->parents[j]].num_states;
+    }
+    fprintf(fp, "cc$T$%s$%d\n", node->name, size);
+  }
+  for (size_t v = 1; v <= var_count; v++) {
+    fprintf(fp, "cc$C$-%zu$1.0$+$\n", v);
+    if (var_node[v] >= 0) {
+      fprintf(fp, "cc$I$%zu$1.0$+$%s$%d\n", v, sorted_node_names[var_node[v]], var_value[v]);
+    } else {
+      fprintf(fp, "cc$C$%zu$%.6f$+$\n", v, weights[v-1]);
+    }
+  }
+  fclose(fp);
+  free(var_node);
+  free(var_value);
+}
+
+// Write a search problem over all features of a generated classifier, with
+// the class as decision
+void write_search_problem(const BayesNet* bn, const double* costs,
+    const GeneratorOptions* options, const char* filename) {
+  double budget = options->budget;
+  if (budget <= 0) {
+    budget = 0;
+    for (int i = 0; i < options->num_features; i++) budget += costs[i];
+    budget = round(10 * budget / 4) / 10;
+  }
+  FILE* fp = open_output(filename);
+  fprintf(fp, "$ %d %g %g\nd %s\n", options->num_features, options->threshold, budget,
+          bn->nodes[0].name);
+  for (int i = 1; i < bn->node_count; i++) {
+    fprintf(fp, "f %s %.1f\n", bn->nodes[i].name, costs[i-1]);
+  }
+  fclose(fp);
+}
+
+/****************************************************************************************
+ * end
+ ****************************************************************************************/
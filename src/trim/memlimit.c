@@ -0,0 +1,98 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "sddapi.h"
+#include "memlimit.h"
+
+/****************************************************************************************
+ * tracks the resident set size of the process against a limit (--mem-limit).
+ * Callers check at safe points (between clause batches, search nodes and
+ * feature moves) and degrade when memory becomes tight:
+ *  --the manager gets a tighter vtree operation memory limit, and is garbage
+ *    collected (here, in memory_budget_check)
+ *  --callers release their own caches, then call memory_budget_release
+ *  --at the limit, callers stop and keep what they have so far
+ ****************************************************************************************/
+
+// Resident set size of the process in KB, from /proc/self/statm; the peak
+// resident set size where that is not available
+size_t current_rss_kb() {
+  FILE* fp = fopen("/proc/self/statm", "r");
+  if (fp != NULL) {
+    unsigned long size, resident;
+    int read = fscanf(fp, "%lu %lu", &size, &resident);
+    fclose(fp);
+    if (read == 2) return resident * (sysconf(_SC_PAGESIZE) / 1024);
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// Peak resident set size of the process in KB, with or without a limit
+size_t process_peak_rss_kb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+void memory_budget_init(MemoryBudget* budget, const size_t limit_kb) {
+  budget->limit_kb = limit_kb;
+  budget->level = MEMLIMIT_OK;
+  budget->degradations = 0;
+  budget->rss_kb = budget->peak_rss_kb = 0;
+  budget->manager_size = budget->manager_live_size = 0;
+}
+
+// Measure memory use and return its level. When it first becomes tight, the
+// manager gets a tighter vtree operation memory limit and is garbage
+// collected, so nodes that the caller needs must be referenced. A budget
+// that has reached MEMLIMIT_STOP stays there. manager may be NULL, for a
+// search without an SDD.
+int memory_budget_check(MemoryBudget* budget, SddManager* manager) {
+  if (budget->limit_kb == 0 || budget->level == MEMLIMIT_STOP) return budget->level;
+  budget->rss_kb = current_rss_kb();
+  if (budget->rss_kb > budget->peak_rss_kb) budget->peak_rss_kb = budget->rss_kb;
+  if (manager != NULL) {
+    budget->manager_size = sdd_manager_size(manager);
+    budget->manager_live_size = sdd_manager_live_size(manager);
+  }
+
+  if (budget->rss_kb >= budget->limit_kb) {
+    budget->level = MEMLIMIT_STOP;
+  } else if (budget->rss_kb >= MEMLIMIT_SOFT_FRACTION * budget->limit_kb) {
+    if (budget->level == MEMLIMIT_OK) {
+      budget->level = MEMLIMIT_TIGHT;
+      budget->degradations++;
+      printf("\nmemory tight (rss %zu KB of %zu KB, manager size %"PRIsS", live %"PRIsS
+             "): tightening vtree operations and collecting garbage\n",
+             budget->rss_kb, budget->limit_kb, budget->manager_size,
+             budget->manager_live_size);
+      if (manager != NULL) {
+        sdd_manager_set_vtree_operation_memory_limit(MEMLIMIT_TIGHT_OPERATION_LIMIT,
+                                                     manager);
+        sdd_manager_garbage_collect(manager);
+      }
+      memory_budget_release();
+    }
+  } else {
+    budget->level = MEMLIMIT_OK;
+  }
+  return budget->level;
+}
+
+// Return freed memory to the system, after caches have been released
+void memory_budget_release() {
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+}
+
+/****************************************************************************************
+ * end
+ ****************************************************************************************/
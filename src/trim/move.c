@@ -1,7 +1,15 @@
+#define _GNU_SOURCE
+#include <time.h>
 #include "sddapi.h"
+#include "compiler.h"
+#include "search.h"
+#include "trace.h"
 
 void move_var_in_vtree(SddLiteral var, char var_location, Vtree* new_sibling, SddManager* manager);
 
+// Count one call of an sdd operation in the field of stats, if stats is not NULL
+#define COUNT_CALL(stats, field) do { if ((stats) != NULL) (stats)->field++; } while (0)
+
 // Helper function: check if feature variables appear in the left vtree child
 int is_feature_var_in_vtree(SddLiteral* const feature_vars,
     const size_t num_vars, Vtree* vtree) {
@@ -18,8 +26,9 @@ int is_feature_var_in_vtree(SddLiteral* const feature_vars,
 // Helper function: move a variable to the right of new_sibling vtree node (or
 // to the left if to_left is set to 1).
 // Note: node gets garbage collected
+// The operations are counted in stats, if not NULL.
 SddNode* sdd_move_var_to_pos(SddLiteral var, int to_left, Vtree* new_sibling,
-    SddNode* node, SddManager* manager) {
+    SddNode* node, SddManager* manager, SearchStats* stats) {
   if (to_left) {
     Vtree* left = sdd_vtree_left(new_sibling);
     if (left != NULL && sdd_vtree_var(left) == var) {
@@ -35,27 +44,39 @@ SddNode* sdd_move_var_to_pos(SddLiteral var, int to_left, Vtree* new_sibling,
   // Condition the SDD node on positive and negative literals of var.
   // Resulting SDD nodes do not contain var, and now we can move it freely.
   SddNode* node1 = sdd_condition(var, node, manager);
+  COUNT_CALL(stats, condition_calls);
   SddNode* node0 = sdd_condition(-var, node, manager);
+  COUNT_CALL(stats, condition_calls);
 
   // Garbage collect node
   sdd_ref(node1, manager);
   sdd_ref(node0, manager);
   sdd_deref(node, manager);
+  TRACE_BEGIN("garbage collect", "sdd");
   sdd_manager_garbage_collect(manager);
+  COUNT_CALL(stats, gc_calls);
+  TRACE_END("garbage collect", "sdd");
 
   // Move variable to left/right of new_sibling and join the SDDs
   SddNode* tmp1;
   SddNode* tmp0;
   move_var_in_vtree(var, to_left ? 'l' : 'r', new_sibling, manager);
   node1 = sdd_conjoin(sdd_manager_literal(var,manager), tmp1=node1, manager);
+  COUNT_CALL(stats, apply_calls);
   node0 = sdd_conjoin(sdd_manager_literal(-var,manager), tmp0=node0, manager);
+  COUNT_CALL(stats, apply_calls);
   SddNode* return_node = sdd_disjoin(node1, node0, manager);
+  COUNT_CALL(stats, apply_calls);
+  COUNT_CALL(stats, var_moves);
 
   // Garbage collect node1 and node0
   sdd_ref(return_node, manager);
   sdd_deref(tmp1, manager);
   sdd_deref(tmp0, manager);
+  TRACE_BEGIN("garbage collect", "sdd");
   sdd_manager_garbage_collect(manager);
+  COUNT_CALL(stats, gc_calls);
+  TRACE_END("garbage collect", "sdd");
 
   return return_node;
 }
@@ -63,7 +84,8 @@ SddNode* sdd_move_var_to_pos(SddLiteral var, int to_left, Vtree* new_sibling,
 // Move indicator variables of a feature in SDD node such that they appear
 // in the left child of rl_pos'th right-linear vtree node from the top.
 // If no_check is set to 1, perform the operation even if some variables
-// appear in the right vtree.
+// appear in the right vtree. A move that changes the vtree is counted and
+// timed in stats, if not NULL.
 //        root
 //     /        \
 //   ...  ...(rl_pos-1) nodes...
@@ -71,8 +93,9 @@ SddNode* sdd_move_var_to_pos(SddLiteral var, int to_left, Vtree* new_sibling,
 //    feature_vars           rest
 SddNode* sdd_move_feature_to_pos(SddNode* node, SddManager* manager,
     SddLiteral* const feature_vars, const size_t num_vars, const int rl_pos,
-    const int no_check) {
+    const int no_check, SearchStats* stats) {
   SddNode* return_node = node;
+  struct timespec start, end;
 
   // new_sibling should point to rl_pos'th node in the rightmost path
   Vtree* new_sibling = sdd_vtree_of(node);  
@@ -84,13 +107,26 @@ SddNode* sdd_move_feature_to_pos(SddNode* node, SddManager* manager,
     return return_node;
   }
 
+  if (stats != NULL) {
+    stats->feature_moves++;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+  }
+  TRACE_BEGIN_ARG("move feature", "move", "first_var", feature_vars[0]);
   for (int i = 0; i < num_vars; i++) {
     // Move the first indicator to the left of new_sibling, and the rest to
     // the right of new_sibling
     return_node = sdd_move_var_to_pos(feature_vars[i], (i==0), new_sibling,
-                                      return_node, manager);
+                                      return_node, manager, stats);
     new_sibling = sdd_vtree_of(sdd_manager_literal(feature_vars[i],manager));
   }
 
+  TRACE_END("move feature", "move");
+  TRACE_COUNTER("sdd", "live_size", sdd_manager_live_size(manager));
+
+  if (stats != NULL) {
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    stats->move_seconds += (end.tv_sec - start.tv_sec) + 1e-9 * (end.tv_nsec - start.tv_nsec);
+  }
+
   return return_node;
 }
@@ -0,0 +1,447 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "search.h"
+#include "naivebayes.h"
+
+/****************************************************************************************
+ * closed-form E-SDP for naive Bayes classifiers, without an SDD.
+ *
+ * The CNF of a network (see encode.c) has, for each node, a clause of its
+ * indicators (at least one value) and binary clauses between them (at most
+ * one), and one clause -I_x -I_u1 ... -I_uk theta per CPT entry. A clause
+ * without theta is an entry of 0. With cardinality minimization, the weight
+ * of an instantiation is the product of the theta of the entries it matches.
+ * The classifier is naive Bayes when every CPT is over one node, or over a
+ * node and the decision node. The weight of class h and feature values z is
+ * then a product of one table per feature, and the nodes that are neither
+ * features nor the decision node (hidden children, fixed nodes) sum out into
+ * a prior on the classes.
+ *
+ * For each decision k, the search tabulates once the weight of each joint
+ * instantiation z of the features, and whether z is classified positive
+ * (Pr(d_k | z) >= T_k). For Y features and X = the others:
+ *  --ECA = sum over y of the weight of (y, x) over the x classified as y is:
+ *    positive if Pr(d_k | y) >= T_k, where Pr(d_k | y) is in closed form
+ *    since the X tables sum out
+ *  --MPA = sum over y of the larger of the weights classified positive and
+ *    negative
+ * as the E-SDP evaluator computes them on a constrained SDD.
+ ****************************************************************************************/
+
+// Helper function: the weight of state n of node N with class h: its unary
+// factors, its factor with the decision node, and whether it is the fixed
+// state
+static SddWmc node_weight(SddWmc** unary, SddWmc** pair, const int* fixed_state,
+    const SddSize* arity, const int N, const SddSize h, const SddSize n) {
+  if (fixed_state[N] >= 0 && (SddSize) fixed_state[N] != n) return 0;
+  SddWmc w = unary[N][n];
+  if (pair[N] != NULL) w *= pair[N][h * arity[N] + n];
+  return w;
+}
+
+// Helper function: multiply a factor entry by weight, counting the clauses
+// that match it (up to 255)
+static void factor_entry(SddWmc* entry, unsigned char* matches, const SddWmc weight) {
+  *entry *= weight;
+  if (*matches < 255) (*matches)++;
+}
+
+// Helper function: the number of clauses that state n of node N matches with
+// class h
+static int node_matches(unsigned char** unary_matches, unsigned char** pair_matches,
+    const SddSize* arity, const int N, const SddSize h, const SddSize n) {
+  int matches = unary_matches[N][n];
+  if (pair_matches[N] != NULL) matches += pair_matches[N][h * arity[N] + n];
+  return matches;
+}
+
+// The naive Bayes tables of data and fnf, or NULL (with reason saying why) if
+// the CNF is not of a naive Bayes classifier over the decision node of data,
+// or its features have more than NAIVE_BAYES_MAX_INSTANTIATIONS instantiations
+NaiveBayes* naive_bayes_detect(SearchData* data, Fnf* fnf, const char** reason) {
+  SddSize var_count = data->var_count;
+  SddWmc* weights = data->literal_weights;
+  int* node_of = (int*) malloc((var_count + 1) * sizeof(int));
+  int* state_of = (int*) malloc((var_count + 1) * sizeof(int));
+  int* factor_of = (int*) calloc(var_count + 1, sizeof(int)); // of each theta
+  for (SddSize v = 0; v <= var_count; v++) node_of[v] = -1;
+
+  // Nodes, from the clauses of their indicators
+  SddSize num_nodes = 0;
+  SddSize* arity = NULL;
+  SddLiteral** indicators = NULL;
+  *reason = NULL;
+  for (SddSize c = 0; c < fnf->litset_count && *reason == NULL; c++) {
+    const LitSet* clause = fnf->litsets + c;
+    int positive = 1;
+    for (SddLiteral i = 0; i < clause->literal_count; i++) {
+      positive &= clause->literals[i] > 0;
+    }
+    if (!positive || clause->literal_count == 0) continue;
+    arity = (SddSize*) realloc(arity, (num_nodes + 1) * sizeof(SddSize));
+    indicators = (SddLiteral**) realloc(indicators, (num_nodes + 1) * sizeof(SddLiteral*));
+    arity[num_nodes] = clause->literal_count;
+    indicators[num_nodes] = clause->literals;
+    for (SddLiteral i = 0; i < clause->literal_count; i++) {
+      SddLiteral var = clause->literals[i];
+      if (node_of[var] >= 0) *reason = "an indicator of two nodes";
+      node_of[var] = num_nodes;
+      state_of[var] = i;
+    }
+    num_nodes++;
+  }
+
+  int hub = (*reason == NULL) ? node_of[data->decisions[0]] : -1;
+  if (*reason == NULL && hub < 0) *reason = "the decision is not a node";
+  int* decision_class = (int*) malloc(data->num_decisions * sizeof(int));
+  for (SddSize k = 0; k < data->num_decisions && *reason == NULL; k++) {
+    if (node_of[data->decisions[k]] != hub) *reason = "decisions on several nodes";
+    else decision_class[k] = state_of[data->decisions[k]];
+  }
+
+  // Factors: unary[N][n], and pair[N][h * arity[N] + n] with the decision node
+  SddWmc** unary = (SddWmc**) calloc(num_nodes, sizeof(SddWmc*));
+  SddWmc** pair = (SddWmc**) calloc(num_nodes, sizeof(SddWmc*));
+  unsigned char** unary_matches =
+      (unsigned char**) calloc(num_nodes, sizeof(unsigned char*));
+  unsigned char** pair_matches =
+      (unsigned char**) calloc(num_nodes, sizeof(unsigned char*));
+  for (SddSize N = 0; N < num_nodes; N++) {
+    unary[N] = (SddWmc*) malloc(arity[N] * sizeof(SddWmc));
+    unary_matches[N] = (unsigned char*) calloc(arity[N], 1);
+    for (SddSize n = 0; n < arity[N]; n++) {
+      unary[N][n] = 1;
+      for (SddSize r = 0; r < arity[N]; r++) {
+        unary[N][n] *= weights[r == n ? indicators[N][r] : -indicators[N][r]];
+      }
+    }
+  }
+  for (SddSize c = 0; c < fnf->litset_count && *reason == NULL; c++) {
+    const LitSet* clause = fnf->litsets + c;
+    SddLiteral theta = 0;
+    int nodes[2], states[2], count = 0, positive = 1;
+    for (SddLiteral i = 0; i < clause->literal_count; i++) {
+      positive &= clause->literals[i] > 0;
+    }
+    if (positive) continue; // at least one value of a node
+    for (SddLiteral i = 0; i < clause->literal_count && *reason == NULL; i++) {
+      SddLiteral literal = clause->literals[i];
+      if (literal > 0 && node_of[literal] >= 0) {
+        *reason = "an unknown clause";
+      } else if (literal > 0) {
+        if (theta != 0) *reason = "a clause with two parameters";
+        theta = literal;
+      } else if (node_of[-literal] < 0) {
+        *reason = "a negated parameter";
+      } else if (count == 2) {
+        *reason = "a CPT over more than two nodes";
+      } else {
+        nodes[count] = node_of[-literal];
+        states[count++] = state_of[-literal];
+      }
+    }
+    if (*reason != NULL || count == 0) continue;
+    if (count == 2 && nodes[0] == nodes[1]) {
+      if (theta != 0 || clause->literal_count != 2) *reason = "an unknown clause";
+      continue; // at most one value
+    }
+    if (theta != 0 && weights[-theta] != 1) *reason = "a weighted negated parameter";
+    SddWmc weight = (theta != 0) ? weights[theta] : 0;
+    int N, n, h = 0;
+    if (count == 1) {
+      N = nodes[0];
+      n = states[0];
+    } else if (nodes[0] == hub || nodes[1] == hub) {
+      int o = (nodes[0] == hub) ? 1 : 0;
+      N = nodes[o];
+      n = states[o];
+      h = states[1 - o];
+    } else {
+      *reason = "a CPT over two nodes besides the decision node";
+      continue;
+    }
+    // a parameter belongs to one factor: factor_of is N + 1 for unary[N],
+    // and -(N + 1) for pair[N]
+    int factor = (count == 1) ? N + 1 : -(N + 1);
+    if (theta != 0 && factor_of[theta] != 0 && factor_of[theta] != factor) {
+      *reason = "a parameter shared by two CPTs";
+      continue;
+    }
+    if (theta != 0) factor_of[theta] = factor;
+    if (count == 1) {
+      factor_entry(unary[N] + n, unary_matches[N] + n, weight);
+    } else {
+      if (pair[N] == NULL) {
+        pair[N] = (SddWmc*) malloc(arity[hub] * arity[N] * sizeof(SddWmc));
+        pair_matches[N] = (unsigned char*) calloc(arity[hub] * arity[N], 1);
+        for (SddSize e = 0; e < arity[hub] * arity[N]; e++) pair[N][e] = 1;
+      }
+      factor_entry(pair[N] + h * arity[N] + n, pair_matches[N] + h * arity[N] + n,
+                   weight);
+    }
+  }
+  // every instantiation matches the same number of clauses, so that
+  // cardinality minimization keeps them all. ACE merges the entries of a CPT
+  // that share a parameter, such as the entries of one class, into a clause
+  // over fewer nodes, so the count is per class h: each state of a node
+  // matches the same number of clauses, and these add up, over the nodes, to
+  // the same number for every class
+  int cardinality = -1;
+  for (SddSize h = 0; h < arity[hub] && *reason == NULL; h++) {
+    int total = unary_matches[hub][h];
+    for (SddSize N = 0; N < num_nodes && *reason == NULL; N++) {
+      if ((int) N == hub) continue;
+      int matches = node_matches(unary_matches, pair_matches, arity, N, h, 0);
+      for (SddSize n = 1; n < arity[N]; n++) {
+        if (node_matches(unary_matches, pair_matches, arity, N, h, n) != matches) {
+          *reason = "a CPT with missing entries";
+        }
+      }
+      total += matches;
+    }
+    if (cardinality >= 0 && total != cardinality) *reason = "a CPT with missing entries";
+    cardinality = total;
+  }
+
+  // Fixed nodes, and the nodes of the features
+  int* fixed_state = (int*) malloc(num_nodes * sizeof(int));
+  char* is_feature = (char*) calloc(num_nodes, 1);
+  for (SddSize N = 0; N < num_nodes; N++) fixed_state[N] = -1;
+  for (SddSize i = 0; i < data->num_fixed_literals && *reason == NULL; i++) {
+    SddLiteral literal = data->fixed_literals[i];
+    SddLiteral var = literal > 0 ? literal : -literal;
+    if (node_of[var] < 0) *reason = "a fixed node that is not a node";
+    else if (node_of[var] == hub) *reason = "a fixed decision node";
+    else if (literal > 0) fixed_state[node_of[literal]] = state_of[literal];
+  }
+  SddSize size = 1;
+  for (SddSize j = 0; j < data->num_features && *reason == NULL; j++) {
+    Feature* feature = data->features[j];
+    for (SddSize i = 0; i < feature->num_indicators; i++) {
+      int N = node_of[feature->indicators[i]];
+      if (N < 0 || N == hub) *reason = "a feature that is not a node";
+      else if (fixed_state[N] >= 0) *reason = "a fixed node that is a feature";
+      else is_feature[N] = 1;
+    }
+    SddSize a = 1;
+    for (SddSize q = 0; q < feature->num_nodes; q++) a *= feature->node_num_indicators[q];
+    if (*reason == NULL && size > NAIVE_BAYES_MAX_INSTANTIATIONS / a) {
+      *reason = "too many instantiations of the features";
+    }
+    size *= a;
+  }
+
+  NaiveBayes* nb = NULL;
+  if (*reason == NULL) {
+    SddSize n = data->num_features, m = arity[hub];
+    nb = (NaiveBayes*) calloc(1, sizeof(NaiveBayes));
+    nb->num_features = n;
+    nb->num_classes = m;
+    nb->size = size;
+    nb->decision_class = decision_class;
+    decision_class = NULL;
+    nb->arity = (SddSize*) malloc(n * sizeof(SddSize));
+    nb->stride = (SddSize*) malloc(n * sizeof(SddSize));
+    nb->table = (SddWmc**) malloc(n * sizeof(SddWmc*));
+    nb->sums = (SddWmc*) calloc(n * m, sizeof(SddWmc));
+    nb->prior = (SddWmc*) malloc(m * sizeof(SddWmc));
+    for (SddSize h = 0; h < m; h++) {
+      nb->prior[h] = node_weight(unary, pair, fixed_state, arity, hub, 0, h);
+      for (SddSize N = 0; N < num_nodes; N++) {
+        if ((int) N == hub || is_feature[N]) continue; // hidden or fixed
+        SddWmc sum = 0;
+        for (SddSize r = 0; r < arity[N]; r++) {
+          sum += node_weight(unary, pair, fixed_state, arity, N, h, r);
+        }
+        nb->prior[h] *= sum;
+      }
+    }
+    SddSize stride = size;
+    for (SddSize j = 0; j < n; j++) {
+      Feature* feature = data->features[j];
+      SddSize a = 1;
+      for (SddSize q = 0; q < feature->num_nodes; q++) a *= feature->node_num_indicators[q];
+      nb->arity[j] = a;
+      stride /= a;
+      nb->stride[j] = stride;
+      // value v of a group: the states of its nodes, the last one fastest
+      nb->table[j] = (SddWmc*) malloc(a * m * sizeof(SddWmc));
+      for (SddSize v = 0; v < a; v++) {
+        for (SddSize h = 0; h < m; h++) {
+          SddWmc w = 1;
+          SddSize rest = v, offset = feature->num_indicators;
+          for (SddSize q = feature->num_nodes; q-- > 0;) {
+            SddSize states = feature->node_num_indicators[q];
+            offset -= states;
+            int N = node_of[feature->indicators[offset]];
+            w *= node_weight(unary, pair, fixed_state, arity, N, h, rest % states);
+            rest /= states;
+          }
+          nb->table[j][v * m + h] = w;
+          nb->sums[j * m + h] += w;
+        }
+      }
+    }
+  }
+
+  for (SddSize N = 0; N < num_nodes; N++) {
+    free(unary[N]);
+    free(pair[N]);
+    free(unary_matches[N]);
+    free(pair_matches[N]);
+  }
+  free(unary);
+  free(pair);
+  free(unary_matches);
+  free(pair_matches);
+  free(fixed_state);
+  free(is_feature);
+  free(arity);
+  free(indicators);
+  free(decision_class);
+  free(node_of);
+  free(state_of);
+  free(factor_of);
+  return nb;
+}
+
+// Helper function: tabulate the instantiations below feature j, with the
+// class weights of the features before j at class_weights + j * num_classes
+static void tabulate(NaiveBayes* nb, SearchData* data, const SddSize first,
+    const SddSize count, const SddSize j, const SddSize z) {
+  const SddSize m = nb->num_classes;
+  const SddWmc* w = nb->class_weights + j * m;
+  if (j == nb->num_features) {
+    SddWmc total = 0;
+    for (SddSize h = 0; h < m; h++) total += w[h];
+    nb->weight[z] = total;
+    for (SddSize k = first; k < first + count; k++) {
+      nb->positive[k * nb->size + z] =
+          w[nb->decision_class[k]] >= data->thresholds[k] * total;
+    }
+    return;
+  }
+  SddWmc* next = nb->class_weights + (j + 1) * m;
+  for (SddSize v = 0; v < nb->arity[j]; v++) {
+    for (SddSize h = 0; h < m; h++) next[h] = w[h] * nb->table[j][v * m + h];
+    tabulate(nb, data, first, count, j + 1, z + v * nb->stride[j]);
+  }
+}
+
+// Tabulate the instantiations of the features for the count decisions of
+// data from first, with their current thresholds
+void naive_bayes_prepare(NaiveBayes* nb, SearchData* data, const SddSize first,
+    const SddSize count) {
+  const SddSize m = nb->num_classes;
+  if (nb->weight == NULL) {
+    nb->weight = (SddWmc*) malloc(nb->size * sizeof(SddWmc));
+    nb->positive = (unsigned char*) malloc(data->num_decisions * nb->size);
+    nb->offsets = (SddSize*) malloc(nb->size * sizeof(SddSize));
+    nb->y_features = (int*) malloc((nb->num_features + 1) * sizeof(int));
+    nb->class_weights = (SddWmc*) malloc((nb->num_features + 2) * m * sizeof(SddWmc));
+  }
+  memcpy(nb->class_weights, nb->prior, m * sizeof(SddWmc));
+  tabulate(nb, data, first, count, 0, 0);
+  nb->total = 0;
+  for (SddSize z = 0; z < nb->size; z++) nb->total += nb->weight[z];
+  if (nb->total == 0) {
+    fprintf(stderr, "The fixed nodes have probability 0\n");
+    exit(1);
+  }
+}
+
+// Agreement of the instantiations y of Y, for one decision
+typedef struct {
+  NaiveBayes* nb;
+  SddSize num_y;
+  SddSize num_offsets;      // Instantiations of X
+  const SddWmc* x_sums;     // Of each class, the X tables summed out
+  SddSize decision_class;
+  SddWmc threshold;
+  const unsigned char* positive;
+  SddWmc mpa;
+  SddWmc eca;
+} Agreement;
+
+// Helper function: add the agreement of the instantiations y of Y that extend
+// the values of its first level features (at index z), with their class
+// weights at class_weights + level * num_classes
+static void add_agreement(Agreement* a, const SddSize level, const SddSize z) {
+  NaiveBayes* nb = a->nb;
+  const SddSize m = nb->num_classes;
+  const SddWmc* w = nb->class_weights + level * m;
+  if (level == a->num_y) {
+    SddWmc a1 = 0, a0 = 0;
+    for (SddSize t = 0; t < a->num_offsets; t++) {
+      SddSize x = z + nb->offsets[t];
+      if (a->positive[x]) a1 += nb->weight[x];
+      else a0 += nb->weight[x];
+    }
+    SddWmc wd = w[a->decision_class] * a->x_sums[a->decision_class], total = 0;
+    for (SddSize h = 0; h < m; h++) total += w[h] * a->x_sums[h];
+    a->eca += (wd >= a->threshold * total) ? a1 : a0;
+    a->mpa += (a1 > a0) ? a1 : a0;
+    return;
+  }
+  int j = nb->y_features[level];
+  SddWmc* next = nb->class_weights + (level + 1) * m;
+  for (SddSize v = 0; v < nb->arity[j]; v++) {
+    for (SddSize h = 0; h < m; h++) next[h] = w[h] * nb->table[j][v * m + h];
+    add_agreement(a, level + 1, z + v * nb->stride[j]);
+  }
+}
+
+// Compute the MPA of the Y features (y_set) for decision k of data, and (via
+// eca if not NULL) their ECA, from the tables of naive_bayes_prepare
+SddWmc naive_bayes_mpa(NaiveBayes* nb, SearchData* data, const SddSize k,
+    const SubsetWord* y_set, SddWmc* eca) {
+  const SddSize m = nb->num_classes;
+  Agreement a = { nb, 0, 1, NULL, nb->decision_class[k], data->thresholds[k],
+                  nb->positive + k * nb->size, 0, 0 };
+  // indices of the instantiations of X, and its tables summed out
+  SddWmc* x_sums = nb->class_weights + (nb->num_features + 1) * m;
+  for (SddSize h = 0; h < m; h++) x_sums[h] = 1;
+  nb->offsets[0] = 0;
+  for (SddSize j = 0; j < nb->num_features; j++) {
+    if (subset_has(y_set, j)) {
+      nb->y_features[a.num_y++] = j;
+      continue;
+    }
+    for (SddSize v = 1; v < nb->arity[j]; v++) {
+      for (SddSize t = 0; t < a.num_offsets; t++) {
+        nb->offsets[v * a.num_offsets + t] = nb->offsets[t] + v * nb->stride[j];
+      }
+    }
+    a.num_offsets *= nb->arity[j];
+    for (SddSize h = 0; h < m; h++) x_sums[h] *= nb->sums[j * m + h];
+  }
+  a.x_sums = x_sums;
+  memcpy(nb->class_weights, nb->prior, m * sizeof(SddWmc));
+  add_agreement(&a, 0, 0);
+  if (eca != NULL) *eca = a.eca / nb->total;
+  return a.mpa / nb->total;
+}
+
+void naive_bayes_free(NaiveBayes* nb) {
+  for (SddSize j = 0; j < nb->num_features; j++) free(nb->table[j]);
+  free(nb->table);
+  free(nb->arity);
+  free(nb->stride);
+  free(nb->sums);
+  free(nb->prior);
+  free(nb->decision_class);
+  free(nb->weight);
+  free(nb->positive);
+  free(nb->offsets);
+  free(nb->y_features);
+  free(nb->class_weights);
+  free(nb);
+}
+
+/****************************************************************************************
+ * end
+ ****************************************************************************************/
@@ -0,0 +1,373 @@
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "network.h"
+
+// Helper function: read a whole file into a null-terminated string
+static char* read_network_file(const char* filename) {
+  FILE* fp = fopen(filename, "rb");
+  if (fp == NULL) {
+    fprintf(stderr, "Could not open network file %s\n", filename);
+    exit(1);
+  }
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  rewind(fp);
+  char* buffer = (char*) malloc(size + 1);
+  if (fread(buffer, sizeof(char), size, fp) != (size_t) size) {
+    fprintf(stderr, "Could not read network file %s\n", filename);
+    exit(1);
+  }
+  buffer[size] = '\0';
+  fclose(fp);
+  return buffer;
+}
+
+static void network_parse_error(const char* filename, const char* message) {
+  fprintf(stderr, "%s: parse error: %s\n", filename, message);
+  exit(1);
+}
+
+// Helper function: find a node by name. Return -1 if there is no such node
+static int find_node(const BayesNet* bn, const char* name) {
+  for (int i = 0; i < bn->node_count; i++) {
+    if (strcmp(bn->nodes[i].name, name) == 0) return i;
+  }
+  return -1;
+}
+
+// Helper function: number of parent instantiations of a node
+static int num_cpt_rows(const BayesNet* bn, const BnNode* node) {
+  int rows = 1;
+  for (int i = 0; i < node->num_parents; i++) {
+    rows *= bn->nodes[node->parents[i]].num_states;
+  }
+  return rows;
+}
+
+/****************************************************************************************
+ * HUGIN .net files
+ *
+ * Only the parts needed for a discrete Bayesian network are interpreted:
+ * node names, their states, and the data of each potential. Every other
+ * attribute (position, label, net properties, ...) is skipped.
+ ****************************************************************************************/
+
+typedef struct {
+  const char* filename;
+  char* pos;                // Read head
+  char* token;              // Current token (null-terminated copy)
+  size_t token_size;
+  int is_string;            // Current token was a quoted string
+  int line;                 // Line of the current token, from 1
+} NetTokenizer;
+
+static void tokenizer_error(const NetTokenizer* t, const char* message) {
+  fprintf(stderr, "%s:%d: parse error: %s\n", t->filename, t->line, message);
+  exit(1);
+}
+
+// Helper function: advance to the next token. Punctuation characters are
+// single-character tokens; strings are returned without their quotes.
+// Return 0 at end of file.
+static int next_token(NetTokenizer* t) {
+  while (1) {
+    while (isspace((unsigned char) *t->pos)) {
+      if (*t->pos == '\n') t->line++;
+      t->pos++;
+    }
+    if (*t->pos != '%') break;
+    while (*t->pos != '\0' && *t->pos != '\n') t->pos++; // comment
+  }
+  if (*t->pos == '\0') return 0;
+
+  char* start = t->pos;
+  t->is_string = 0;
+  if (*t->pos == '"') {
+    start = ++t->pos;
+    while (*t->pos != '\0' && *t->pos != '"') {
+      if (*t->pos == '\n') t->line++;
+      t->pos++;
+    }
+    if (*t->pos == '\0') tokenizer_error(t, "unterminated string");
+    t->is_string = 1;
+  } else if (strchr("{}()=;|,", *t->pos) != NULL) {
+    t->pos++;
+  } else {
+    while (*t->pos != '\0' && !isspace((unsigned char) *t->pos) &&
+           strchr("{}()=;|,%\"", *t->pos) == NULL) t->pos++;
+  }
+
+  size_t len = t->pos - start;
+  if (len + 1 > t->token_size) {
+    t->token_size = 2 * (len + 1);
+    t->token = (char*) realloc(t->token, t->token_size);
+  }
+  memcpy(t->token, start, len);
+  t->token[len] = '\0';
+  if (t->is_string) t->pos++; // closing quote
+  return 1;
+}
+
+static int token_is(const NetTokenizer* t, const char* str) {
+  return !t->is_string && strcmp(t->token, str) == 0;
+}
+
+static void expect_token(NetTokenizer* t, const char* str) {
+  if (!next_token(t) || !token_is(t, str)) {
+    char message[64];
+    snprintf(message, sizeof(message), "expected \"%s\"", str);
+    tokenizer_error(t, message);
+  }
+}
+
+// Helper function: skip an attribute value up to and including its ';'
+static void skip_attribute_value(NetTokenizer* t) {
+  int depth = 0;
+  while (next_token(t)) {
+    if (token_is(t, "(")) depth++;
+    else if (token_is(t, ")")) depth--;
+    else if (token_is(t, ";") && depth == 0) return;
+  }
+  tokenizer_error(t, "unexpected end of file in attribute");
+}
+
+// Helper function: skip a block whose '{' has already been read
+static void skip_block(NetTokenizer* t) {
+  int depth = 1;
+  while (depth > 0) {
+    if (!next_token(t)) {
+      tokenizer_error(t, "unexpected end of file in block");
+    }
+    if (token_is(t, "{")) depth++;
+    else if (token_is(t, "}")) depth--;
+  }
+}
+
+static void parse_hugin_node(NetTokenizer* t, BayesNet* bn, int* capacity) {
+  if (!next_token(t)) tokenizer_error(t, "expected node name");
+  if (*capacity == bn->node_count) {
+    *capacity = 2 * (*capacity) + 8;
+    bn->nodes = (BnNode*) realloc(bn->nodes, *capacity * sizeof(BnNode));
+  }
+  BnNode* node = bn->nodes + bn->node_count++;
+  node->name = strdup(t->token);
+  node->num_states = 0;
+  node->num_parents = 0;
+  node->parents = NULL;
+  node->cpt = NULL;
+
+  expect_token(t, "{");
+  while (next_token(t) && !token_is(t, "}")) {
+    if (token_is(t, "states")) {
+      expect_token(t, "=");
+      expect_token(t, "(");
+      while (next_token(t) && !token_is(t, ")")) node->num_states++;
+      expect_token(t, ";");
+    } else {
+      skip_attribute_value(t);
+    }
+  }
+  if (node->num_states == 0) {
+    tokenizer_error(t, "node without states");
+  }
+}
+
+static void parse_hugin_potential(NetTokenizer* t, BayesNet* bn) {
+  expect_token(t, "(");
+  if (!next_token(t)) tokenizer_error(t, "expected node name");
+  int index = find_node(bn, t->token);
+  if (index < 0) tokenizer_error(t, "potential for unknown node");
+  BnNode* node = bn->nodes + index;
+  if (node->cpt != NULL) {
+    tokenizer_error(t, "node has more than one potential");
+  }
+
+  // Parents: "( child | parent1 parent2 ... )"
+  int* parents = (int*) malloc(bn->node_count * sizeof(int));
+  int num_parents = 0;
+  next_token(t);
+  if (token_is(t, "|")) {
+    while (next_token(t) && !token_is(t, ")")) {
+      int parent = find_node(bn, t->token);
+      if (parent < 0) {
+        tokenizer_error(t, "potential with unknown parent");
+      }
+      parents[num_parents++] = parent;
+    }
+  } else if (!token_is(t, ")")) {
+    tokenizer_error(t, "expected \"|\" or \")\"");
+  }
+  node->num_parents = num_parents;
+  node->parents = parents;
+
+  int size = num_cpt_rows(bn, node) * node->num_states;
+  expect_token(t, "{");
+  while (next_token(t) && !token_is(t, "}")) {
+    if (!token_is(t, "data")) {
+      skip_attribute_value(t);
+      continue;
+    }
+    // Nested lists of numbers. Only the flattened order matters.
+    expect_token(t, "=");
+    node->cpt = (double*) malloc(size * sizeof(double));
+    int n = 0, depth = 0;
+    while (next_token(t)) {
+      if (token_is(t, "(")) {
+        depth++;
+      } else if (token_is(t, ")")) {
+        depth--;
+      } else if (token_is(t, ";") && depth == 0) {
+        break;
+      } else {
+        if (n >= size) tokenizer_error(t, "too many cpt entries");
+        node->cpt[n++] = strtod(t->token, NULL);
+      }
+    }
+    if (n != size) tokenizer_error(t, "too few cpt entries");
+  }
+}
+
+// Read a discrete Bayesian network in HUGIN .net format
+BayesNet* read_hugin_net(const char* filename) {
+  char* buffer = read_network_file(filename);
+  NetTokenizer t = { filename, buffer, NULL, 0, 0, 1 };
+
+  BayesNet* bn = (BayesNet*) malloc(sizeof(BayesNet));
+  bn->node_count = 0;
+  bn->nodes = NULL;
+  int capacity = 0;
+
+  while (next_token(&t)) {
+    if (token_is(&t, "net")) {
+      expect_token(&t, "{");
+      skip_block(&t);
+    } else if (token_is(&t, "node") || token_is(&t, "discrete")) {
+      if (token_is(&t, "discrete")) expect_token(&t, "node");
+      parse_hugin_node(&t, bn, &capacity);
+    } else if (token_is(&t, "potential")) {
+      parse_hugin_potential(&t, bn);
+    } else {
+      tokenizer_error(&t, "only discrete nodes and potentials are supported");
+    }
+  }
+
+  for (int i = 0; i < bn->node_count; i++) {
+    if (bn->nodes[i].cpt == NULL) {
+      network_parse_error(filename, "node without potential");
+    }
+  }
+
+  free(t.token);
+  free(buffer);
+  return bn;
+}
+
+/****************************************************************************************
+ * UAI files (BAYES preamble)
+ *
+ * Nodes have no names in this format. They are named by their index, so the
+ * .search file refers to them as "0", "1", ...
+ ****************************************************************************************/
+
+static long uai_int_token(NetTokenizer* t) {
+  if (!next_token(t)) tokenizer_error(t, "unexpected end of file");
+  char* end = NULL;
+  long value = strtol(t->token, &end, 10);
+  if (*end != '\0') tokenizer_error(t, "expected an integer");
+  return value;
+}
+
+// Read a Bayesian network in UAI format
+BayesNet* read_uai_net(const char* filename) {
+  char* buffer = read_network_file(filename);
+  NetTokenizer t = { filename, buffer, NULL, 0, 0, 1 };
+  if (!next_token(&t) || strcmp(t.token, "BAYES") != 0) {
+    tokenizer_error(&t, "expected \"BAYES\" preamble");
+  }
+
+  BayesNet* bn = (BayesNet*) malloc(sizeof(BayesNet));
+  bn->node_count = uai_int_token(&t);
+  if (bn->node_count < 1) tokenizer_error(&t, "expected a positive number of variables");
+  bn->nodes = (BnNode*) calloc(bn->node_count, sizeof(BnNode));
+  for (int i = 0; i < bn->node_count; i++) {
+    char name[32];
+    snprintf(name, sizeof(name), "%d", i);
+    bn->nodes[i].name = strdup(name);
+    bn->nodes[i].num_states = uai_int_token(&t);
+    if (bn->nodes[i].num_states < 1) tokenizer_error(&t, "variable without states");
+  }
+
+  // Function scopes list the parents first and the child last
+  int num_functions = uai_int_token(&t);
+  if (num_functions != bn->node_count) {
+    tokenizer_error(&t, "expected one function per variable");
+  }
+  int* children = (int*) malloc(num_functions * sizeof(int));
+  for (int i = 0; i < num_functions; i++) {
+    int scope_size = uai_int_token(&t);
+    if (scope_size < 1) tokenizer_error(&t, "empty function scope");
+    int* scope = (int*) malloc(scope_size * sizeof(int));
+    for (int j = 0; j < scope_size; j++) {
+      scope[j] = uai_int_token(&t);
+      if (scope[j] < 0 || scope[j] >= bn->node_count) {
+        tokenizer_error(&t, "variable out of range");
+      }
+    }
+    BnNode* node = bn->nodes + scope[scope_size-1];
+    if (node->parents != NULL) {
+      tokenizer_error(&t, "variable has more than one function");
+    }
+    node->num_parents = scope_size - 1;
+    node->parents = scope;
+    children[i] = scope[scope_size-1];
+  }
+
+  // Each table has one entry per state of the child and instantiation of
+  // the parents
+  for (int i = 0; i < num_functions; i++) {
+    BnNode* node = bn->nodes + children[i];
+    int size = num_cpt_rows(bn, node) * node->num_states;
+    long count = uai_int_token(&t);
+    if (count != size) {
+      char message[96];
+      snprintf(message, sizeof(message), "function table of variable %d has %ld "
+               "entries, expected %d", children[i], count, size);
+      tokenizer_error(&t, message);
+    }
+    node->cpt = (double*) malloc(size * sizeof(double));
+    for (int j = 0; j < size; j++) {
+      if (!next_token(&t)) tokenizer_error(&t, "unexpected end of file");
+      char* end = NULL;
+      node->cpt[j] = strtod(t.token, &end);
+      if (*end != '\0') tokenizer_error(&t, "expected a number");
+    }
+  }
+
+  free(children);
+  free(t.token);
+  free(buffer);
+  return bn;
+}
+
+// Read a Bayesian network, choosing the format by file extension
+// (.uai for UAI, anything else for HUGIN .net)
+BayesNet* read_bayes_net(const char* filename) {
+  size_t len = strlen(filename);
+  if (len >= 4 && strcmp(filename + len - 4, ".uai") == 0) {
+    return read_uai_net(filename);
+  }
+  return read_hugin_net(filename);
+}
+
+void free_bayes_net(BayesNet* bn) {
+  for (int i = 0; i < bn->node_count; i++) {
+    free(bn->nodes[i].name);
+    free(bn->nodes[i].parents);
+    free(bn->nodes[i].cpt);
+  }
+  free(bn->nodes);
+  free(bn);
+}
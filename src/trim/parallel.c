@@ -0,0 +1,192 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "sddapi.h"
+#include "parallel.h"
+
+/****************************************************************************************
+ * worker processes for a sharded search:
+ *  --workers are forked after the constrained SDD is built, so each starts
+ *    with its own copy of the manager and never compiles or loads it
+ *  --each worker has a socket pair to the coordinator. It sends the result of
+ *    its last shard (or an empty one at first) and receives the next shard,
+ *    or -1 when there are none left; shards are handed out in order
+ *  --the best ECA found by any process is kept in shared memory, so that
+ *    every worker prunes with it as soon as it improves
+ ****************************************************************************************/
+
+// Shared best ECA. ECAs are non-negative, so that their order is the order
+// of their bit patterns as unsigned integers.
+SddWmc* shared_incumbent_new(const SddWmc value) {
+  SddWmc* incumbent = (SddWmc*) mmap(NULL, sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (incumbent == MAP_FAILED) {
+    fprintf(stderr, "Could not map shared memory for workers\n");
+    exit(1);
+  }
+  *incumbent = value;
+  return incumbent;
+}
+
+void shared_incumbent_free(SddWmc* incumbent) {
+  munmap(incumbent, sizeof(uint64_t));
+}
+
+SddWmc shared_incumbent_get(SddWmc* incumbent) {
+  uint64_t bits = __atomic_load_n((uint64_t*) incumbent, __ATOMIC_ACQUIRE);
+  SddWmc value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Raise the shared best ECA to value, if that is larger
+void shared_incumbent_raise(SddWmc* incumbent, const SddWmc value) {
+  uint64_t bits, current = __atomic_load_n((uint64_t*) incumbent, __ATOMIC_ACQUIRE);
+  memcpy(&bits, &value, sizeof(bits));
+  while (bits > current &&
+         !__atomic_compare_exchange_n((uint64_t*) incumbent, &current, bits, 0,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+  }
+}
+
+static void write_all(const int fd, const void* buffer, const size_t size) {
+  const char* p = (const char*) buffer;
+  for (size_t done = 0; done < size;) {
+    ssize_t n = write(fd, p + done, size - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      fprintf(stderr, "Could not write to worker socket\n");
+      exit(1);
+    }
+    done += n;
+  }
+}
+
+// Returns 0 at end of file
+static int read_all(const int fd, void* buffer, const size_t size) {
+  char* p = (char*) buffer;
+  for (size_t done = 0; done < size;) {
+    ssize_t n = read(fd, p + done, size - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) {
+      fprintf(stderr, "Could not read from worker socket\n");
+      exit(1);
+    }
+    if (n == 0) return 0;
+    done += n;
+  }
+  return 1;
+}
+
+// Message of a worker: the shard it searched (-1 for none yet) and whether
+// the search must stop, followed by the result of the shard
+typedef struct {
+  int shard;
+  int stop;
+} ShardMessage;
+
+static void worker_loop(const int fd, ShardSearch search, void* context,
+    const size_t result_size) {
+  char* result = (char*) calloc(result_size, 1);
+  ShardMessage message = { -1, 0 };
+  while (1) {
+    write_all(fd, &message, sizeof(message));
+    write_all(fd, result, result_size);
+    int shard;
+    if (!read_all(fd, &shard, sizeof(shard)) || shard < 0) break;
+    memset(result, 0, result_size);
+    message.shard = shard;
+    message.stop = search(shard, result, context);
+  }
+  free(result);
+}
+
+// Search shards 0..num_shards-1 with num_workers forked processes. The result
+// of shard i goes to results + i * result_size (zeroed if it was not
+// searched), and the number of shards each worker searched to
+// shards_per_worker (if not NULL). Returns 1 if a worker stopped the search.
+int run_shards(const int num_workers, const int num_shards, ShardSearch search,
+    void* context, void* results, const size_t result_size, int* shards_per_worker) {
+  memset(results, 0, num_shards * result_size);
+  int* fds = (int*) malloc(num_workers * sizeof(int));
+  pid_t* pids = (pid_t*) malloc(num_workers * sizeof(pid_t));
+  fflush(stdout);
+  fflush(stderr);
+  for (int w = 0; w < num_workers; w++) {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+      fprintf(stderr, "Could not create worker socket\n");
+      exit(1);
+    }
+    pids[w] = fork();
+    if (pids[w] < 0) {
+      fprintf(stderr, "Could not fork worker %d\n", w);
+      exit(1);
+    }
+    if (pids[w] == 0) {
+      close(pair[0]);
+      for (int v = 0; v < w; v++) close(fds[v]);
+      worker_loop(pair[1], search, context, result_size);
+      close(pair[1]);
+      _exit(0);
+    }
+    close(pair[1]);
+    fds[w] = pair[0];
+    if (shards_per_worker != NULL) shards_per_worker[w] = 0;
+  }
+
+  // Hand out shards in order to whichever worker reports first
+  struct pollfd* polls = (struct pollfd*) malloc(num_workers * sizeof(struct pollfd));
+  char* scratch = (char*) malloc(result_size);
+  int next = 0, active = num_workers, stopped = 0;
+  for (int w = 0; w < num_workers; w++) {
+    polls[w].fd = fds[w];
+    polls[w].events = POLLIN;
+  }
+  while (active > 0) {
+    if (poll(polls, num_workers, -1) < 0) {
+      if (errno == EINTR) continue;
+      fprintf(stderr, "Could not poll workers\n");
+      exit(1);
+    }
+    for (int w = 0; w < num_workers; w++) {
+      if (polls[w].fd < 0 || !(polls[w].revents & (POLLIN | POLLHUP))) continue;
+      ShardMessage message;
+      if (!read_all(fds[w], &message, sizeof(message)) ||
+          !read_all(fds[w], scratch, result_size)) {
+        fprintf(stderr, "Worker %d exited unexpectedly\n", w);
+        exit(1);
+      }
+      if (message.shard >= 0) {
+        memcpy((char*) results + message.shard * result_size, scratch, result_size);
+        if (shards_per_worker != NULL) shards_per_worker[w]++;
+      }
+      stopped |= message.stop;
+      int shard = (next < num_shards && !stopped) ? next++ : -1;
+      write_all(fds[w], &shard, sizeof(shard));
+      if (shard < 0) {
+        close(fds[w]);
+        polls[w].fd = -1;
+        active--;
+      }
+    }
+  }
+  for (int w = 0; w < num_workers; w++) waitpid(pids[w], NULL, 0);
+  free(scratch);
+  free(polls);
+  free(pids);
+  free(fds);
+  return stopped;
+}
+
+/****************************************************************************************
+ * end
+ ****************************************************************************************/
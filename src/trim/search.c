@@ -1,16 +1,26 @@
-#include <float.h>
+#define _GNU_SOURCE
 #include <math.h>
+#include <signal.h>
 #include <string.h>
+#include <time.h>
 #include "sddapi.h"
 #include "compiler.h"
 #include "search.h"
+#include "esdp.h"
+#include "trace.h"
+#include "memlimit.h"
+#include "checkpoint.h"
+#include "parallel.h"
+#include "arena.h"
+#include "boundcache.h"
+#include "naivebayes.h"
 
 // forward references
 char* ppc(SddSize n); // pretty print
 SddNode* fnf_to_sdd(Fnf* fnf, SddManager* manager);
 SddNode* sdd_move_feature_to_pos(
   SddNode* node, SddManager* manager, SddLiteral* const feature_vars,
-  const size_t num_vars, const int rl_pos, const int no_check);
+  const size_t num_vars, const int rl_pos, const int no_check, SearchStats* stats);
 
 // Helper function: update constrained node positions, assuming that the
 // Y-constrained node is y'th, and XY-constrained node is xy'th node in
@@ -28,249 +38,1457 @@ void update_constrained_positions(
   update_constrained_positions(sdd_vtree_right(vtree), y-1, xy-1, y_vtree, xy_vtree);
 }
 
-void print_set(char* set, int n) {
-  for (int i = 0; i < n; i++) {
-    if (set[i] == 1) printf("%d,",i);
+// Per-call comparison of the E-SDP evaluators, in ESDP_COMPARE mode
+static struct {
+  SddSize calls;
+  double library_seconds;
+  double flat_seconds;
+  double incremental_seconds;
+  SddWmc max_mpa_diff;      // flat and incremental vs library
+  SddWmc max_eca_diff;      // flat vs library
+  SddWmc max_incremental_diff; // incremental vs flat, MPA and ECA
+} esdp_comparison;
+
+// Values of SDD nodes kept across E-SDP calls of a search, in
+// ESDP_INCREMENTAL and ESDP_COMPARE modes: one cache per decision searched for
+// (NULL for the others)
+static EsdpCache** esdp_caches = NULL;
+static SddSize num_esdp_caches = 0;
+
+// The tabulated classifier of search_naive_bayes, which evaluates the MPA and
+// ECA of a Y set in closed form instead of on an SDD (NULL otherwise)
+static NaiveBayes* naive_bayes = NULL;
+
+// Constraints between exchangeable features, if search_options->symmetry
+static FeatureSymmetry* symmetry = NULL;
+
+// Cost of the always-included features from each depth on (num_features + 1
+// entries), which every subset below a search node at that depth pays
+static float* always_included_cost = NULL;
+
+// Memory use against --mem-limit, during the compilation and the search
+static MemoryBudget memory_budget;
+
+// Helper function: check memory use against the limit. When it becomes tight,
+// the E-SDP cache is shrunk as well. At the limit, record why the search
+// stops and return 1.
+static int check_memory(SddManager* manager, SearchResult* result) {
+  SddSize degradations = memory_budget.degradations;
+  int level = memory_budget_check(&memory_budget, manager);
+  result->peak_rss_kb = memory_budget.peak_rss_kb;
+  if (memory_budget.degradations > degradations && esdp_caches != NULL) {
+    for (SddSize k = 0; k < num_esdp_caches; k++) {
+      if (esdp_caches[k] != NULL) esdp_cache_shrink(esdp_caches[k]);
+    }
+    memory_budget_release();
+  }
+  if (level == MEMLIMIT_STOP && result->stop_reason == NULL) {
+    result->stop_reason = "memory limit";
+    printf("\nmemory limit reached (rss %zu KB of %zu KB, manager size %"PRIsS
+           ", live %"PRIsS"): stopping\n", memory_budget.rss_kb,
+           memory_budget.limit_kb, memory_budget.manager_size,
+           memory_budget.manager_live_size);
+  }
+  return level == MEMLIMIT_STOP;
+}
+
+// Helper function: fnf_to_sdd_check during compilation
+static SearchResult* compile_result = NULL;
+static int check_compile_memory(SddManager* manager) {
+  return check_memory(manager, compile_result);
+}
+
+static double elapsed_seconds(const struct timespec* start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + 1e-9 * (end.tv_nsec - start->tv_nsec);
+}
+
+static inline void update_max_diff(SddWmc* max_diff, const SddWmc a, const SddWmc b) {
+  SddWmc diff = fabs(a - b);
+  if (diff > *max_diff) *max_diff = diff;
+}
+
+// Helper function: compute MPA (and ECA via eca, if not NULL) of the
+// constrained SDD node for decision k of data, with the evaluator selected in
+// options
+static SddWmc esdp_mpa_with(SddNode* node, SddManager* manager, SearchData* data,
+    SearchOptions* options, const SddSize k, SddLiteral xy_vtree, SddLiteral y_vtree,
+    SddWmc* eca) {
+  struct timespec start;
+  SddWmc mpa, library_mpa, incremental_mpa, incremental_eca;
+  EsdpCache* esdp_cache = (esdp_caches != NULL) ? esdp_caches[k] : NULL;
+  if (options->esdp_mode == ESDP_INCREMENTAL) {
+    return esdp_compute_mpa_incremental(esdp_cache, node, manager, xy_vtree, y_vtree, eca);
+  }
+  if (options->esdp_mode == ESDP_LIBRARY || options->esdp_mode == ESDP_COMPARE) {
+    // compute_mpa leaves eca untouched when Y has all features
+    SddWmc library_eca = (eca != NULL) ? *eca : -1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    EsdpManager* e_manager = esdp_manager_new(node, manager, data->literal_weights);
+    library_mpa = compute_mpa(e_manager, data->decisions[k], data->thresholds[k],
+                              xy_vtree, y_vtree, &library_eca);
+    esdp_manager_free(e_manager);
+    if (options->esdp_mode == ESDP_LIBRARY) {
+      if (eca != NULL) *eca = library_eca;
+      return library_mpa;
+    }
+    esdp_comparison.library_seconds += elapsed_seconds(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    incremental_mpa = esdp_compute_mpa_incremental(esdp_cache, node, manager,
+                                                   xy_vtree, y_vtree, &incremental_eca);
+    esdp_comparison.incremental_seconds += elapsed_seconds(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    EsdpEvaluator* evaluator = esdp_evaluator_new(node, manager, data->literal_weights);
+    mpa = esdp_compute_mpa(evaluator, data->decisions[k], data->thresholds[k],
+                           xy_vtree, y_vtree, eca);
+    esdp_evaluator_free(evaluator);
+    esdp_comparison.flat_seconds += elapsed_seconds(&start);
+
+    esdp_comparison.calls++;
+    update_max_diff(&esdp_comparison.max_mpa_diff, mpa, library_mpa);
+    update_max_diff(&esdp_comparison.max_mpa_diff, incremental_mpa, library_mpa);
+    update_max_diff(&esdp_comparison.max_incremental_diff, incremental_mpa, mpa);
+    if (eca != NULL) {
+      if (y_vtree != xy_vtree) {
+        update_max_diff(&esdp_comparison.max_eca_diff, *eca, library_eca);
+      }
+      update_max_diff(&esdp_comparison.max_incremental_diff, incremental_eca, *eca);
+    }
+    return mpa;
+  }
+
+  EsdpEvaluator* evaluator = esdp_evaluator_new(node, manager, data->literal_weights);
+  mpa = esdp_compute_mpa(evaluator, data->decisions[k], data->thresholds[k],
+                         xy_vtree, y_vtree, eca);
+  esdp_evaluator_free(evaluator);
+  return mpa;
+}
+
+// Helper function: the first decision of data that a search with options is
+// for, and via count how many
+static SddSize searched_decisions(SearchData* data, SearchOptions* options,
+    SddSize* count) {
+  *count = (options->decision >= 0) ? 1 : data->num_decisions;
+  return (options->decision >= 0) ? options->decision : 0;
+}
+
+// Helper function: esdp_mpa_with, counted and timed in stats as a bound
+// evaluation (eca is NULL) or an ECA evaluation. With several decisions, the
+// MPA and ECA are the means over them: the mean MPA bounds the mean ECA. The
+// decisions share the layout of the SDD, so the search moves features for
+// all of them at once. With naive_bayes, Y is y_set and the SDD is not used.
+static SddWmc esdp_mpa(SddNode* node, SddManager* manager, SearchData* data,
+    SearchOptions* options, const SubsetWord* y_set, SddLiteral xy_vtree,
+    SddLiteral y_vtree, SddWmc* eca, SearchStats* stats) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  TRACE_BEGIN(eca == NULL ? "bound" : "eca", "esdp");
+  SddSize count;
+  SddSize first = searched_decisions(data, options, &count);
+  SddWmc mpa = 0, eca_sum = 0;
+  for (SddSize k = first; k < first + count; k++) {
+    SddWmc decision_eca = (eca != NULL) ? *eca : 0;
+    if (naive_bayes != NULL) {
+      mpa += naive_bayes_mpa(naive_bayes, data, k, y_set,
+                             eca != NULL ? &decision_eca : NULL);
+      eca_sum += decision_eca;
+      continue;
+    }
+    mpa += esdp_mpa_with(node, manager, data, options, k, xy_vtree, y_vtree,
+                         eca != NULL ? &decision_eca : NULL);
+    eca_sum += decision_eca;
+  }
+  mpa /= count;
+  if (eca != NULL) *eca = eca_sum / count;
+  TRACE_END(eca == NULL ? "bound" : "eca", "esdp");
+  stats->esdp_seconds += elapsed_seconds(&start);
+  if (eca == NULL) stats->bound_evaluations++;
+  else stats->eca_evaluations++;
+  return mpa;
+}
+
+// Helper function: record the SDD size, if sample_interval has passed since
+// the last sample. When the samples are full, keep every other one and
+// double the interval.
+static void sample_sdd_size(SearchStats* stats, SddManager* manager) {
+  double seconds = elapsed_seconds(&stats->start);
+  if (stats->sample_count > 0 &&
+      seconds < stats->samples[stats->sample_count-1].seconds + stats->sample_interval) {
+    return;
+  }
+  if (stats->sample_count == SEARCH_STATS_MAX_SAMPLES) {
+    for (SddSize i = 0; i < SEARCH_STATS_MAX_SAMPLES / 2; i++) {
+      stats->samples[i] = stats->samples[2*i];
+    }
+    stats->sample_count = SEARCH_STATS_MAX_SAMPLES / 2;
+    stats->sample_interval *= 2;
+  }
+  SddSizeSample* sample = stats->samples + stats->sample_count++;
+  sample->seconds = seconds;
+  sample->nodes_expanded = stats->nodes_expanded;
+  sample->live_size = sdd_manager_live_size(manager);
+  sample->live_count = sdd_manager_live_count(manager);
+}
+
+// Scratch memory of the search: subsets and per-level arrays, pushed and
+// popped as the search descends and returns
+static Arena search_arena;
+
+// Checkpoints of the search, with --checkpoint (see checkpoint.c)
+static struct {
+  const char* filename;     // NULL if not checkpointing
+  double interval;          // Seconds between checkpoints
+  struct timespec last;     // Time of the last checkpoint
+  double previous_seconds;  // Search time before a resume
+} checkpoint;
+
+// Frontier that the search descends to before expanding nodes, when resuming
+// a checkpoint or searching a shard: the include (1) and exclude (0)
+// decisions of features 0..depth-1 of path
+static struct {
+  SubsetWord* path;
+  int depth;                // Until the search reaches the frontier
+  int subtree_only;         // Search the subtree of the frontier, and not the
+                            // rest of the search after it
+} frontier;
+
+// A shard of the search, or an improvement of the best subset found by the
+// coordinator while enumerating shards
+typedef struct {
+  int shard;                // Index of the shard, or -1 for an improvement
+  SubsetWord* bits;         // Path to the root of the shard, or the subset
+                            // (in search_arena)
+  SddWmc score;             // Of the subset
+  float cost;
+} ShardEntry;
+
+// Sharded search over worker processes, with --workers (see parallel.c)
+static struct {
+  int depth;                // Depth of the roots of the shards
+  int enumerating;          // Coordinator: record roots instead of searching
+  ShardEntry* entries;      // Shards and improvements, in search order
+  int num_entries;
+  int capacity;
+  int num_shards;
+  int* shard_entry;         // Entry of each shard
+  SddWmc* incumbent;        // Best ECA over all processes (NULL when the
+                            // search is not sharded)
+} sharding;
+
+// Set by SIGTERM or SIGINT while checkpointing
+static volatile sig_atomic_t checkpoint_signal = 0;
+static struct sigaction previous_sigterm, previous_sigint;
+
+// Set by cancel_search
+static volatile sig_atomic_t cancel_requested = 0;
+
+static void handle_checkpoint_signal(int signum) {
+  (void) signum;
+  checkpoint_signal = 1;
+}
+
+// Helper function: set up checkpoints of a search starting (or resuming) at
+// the frontier of features 0..depth-1 of path
+static void checkpoint_start(SearchOptions* options, const SubsetWord* path,
+    const int depth, const double previous_seconds, const SddSize num_features) {
+  checkpoint.filename = options->checkpoint_file;
+  checkpoint.interval = options->checkpoint_interval;
+  checkpoint.previous_seconds = previous_seconds;
+  frontier.depth = depth;
+  frontier.subtree_only = 0;
+  frontier.path = NULL;
+  if (depth > 0) {
+    SddSize words = subset_words(num_features);
+    frontier.path = (SubsetWord*) arena_push(&search_arena, words * sizeof(SubsetWord));
+    subset_copy(frontier.path, path, words);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &checkpoint.last);
+  if (checkpoint.filename == NULL) return;
+  // A preempted job gets SIGTERM: write a checkpoint at the next search node
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handle_checkpoint_signal;
+  sigemptyset(&action.sa_mask);
+  checkpoint_signal = 0;
+  sigaction(SIGTERM, &action, &previous_sigterm);
+  sigaction(SIGINT, &action, &previous_sigint);
+}
+
+static void checkpoint_stop() {
+  if (checkpoint.filename != NULL) {
+    sigaction(SIGTERM, &previous_sigterm, NULL);
+    sigaction(SIGINT, &previous_sigint, NULL);
+  }
+  frontier.path = NULL;
+  frontier.depth = 0;
+  checkpoint.filename = NULL;
+}
+
+// Helper function: write a checkpoint with the search node at depth (not yet
+// expanded) as frontier, if the interval has passed, on a signal, or if the
+// search stops there. On a signal, the search stops: returns 1.
+static int checkpoint_node(SearchData* data, SearchResult* result, const SubsetWord* subset,
+    const int depth, const int stopping) {
+  if (checkpoint.filename == NULL) return 0;
+  int interrupted = checkpoint_signal;
+  if (!interrupted && !stopping && elapsed_seconds(&checkpoint.last) < checkpoint.interval) {
+    return 0;
+  }
+  write_checkpoint(checkpoint.filename, data, result, subset, depth,
+                   checkpoint.previous_seconds + elapsed_seconds(&result->stats.start));
+  clock_gettime(CLOCK_MONOTONIC, &checkpoint.last);
+  if (interrupted && result->stop_reason == NULL) {
+    result->stop_reason = "interrupted";
+    printf("\ninterrupted: checkpoint written to %s\n", checkpoint.filename);
+  }
+  return interrupted;
+}
+
+// Helper function: once cancel_search was called, record why the search stops
+// and return 1
+static int check_cancel(SearchResult* result) {
+  if (!cancel_requested) return 0;
+  if (result->stop_reason == NULL) {
+    result->stop_reason = "cancelled";
+    printf("\ncancelled: stopping\n");
+  }
+  return 1;
+}
+
+// Helper function: best ECA to prune with; when sharded, the best of all
+// processes. With --top-k, the k-th best ECA (0 until k subsets are found).
+static SddWmc incumbent_score(SearchResult* result) {
+  if (result->top.k > 1) {
+    return result->top.count == result->top.k ? result->top.scores[0] : 0;
   }
+  if (sharding.incumbent == NULL) return result->best_score;
+  SddWmc shared = shared_incumbent_get(sharding.incumbent);
+  return (shared > result->best_score) ? shared : result->best_score;
 }
 
-static inline
-int cmp_by_bound_inc(const void* n1, const void* n2) {
-  const SddWmc s1 = (*((const SddWmc**) n1))[1];
-  const SddWmc s2 = (*((const SddWmc**) n2))[1];
-  SddWmc diff = s1 - s2;
-  if (fabs(diff) < DBL_EPSILON) return 0;
-  return (diff > 0) ? 1 : -1;
+// Helper function: record a shard (with path the decisions in bits so far)
+// or an improvement of the best subset (with shard -1) while enumerating
+static void add_shard_entry(const int shard, const SubsetWord* bits, const SddSize words,
+    const SddWmc score, const float cost) {
+  if (sharding.num_entries == sharding.capacity) {
+    sharding.capacity = 2 * sharding.capacity + 16;
+    sharding.entries = (ShardEntry*) realloc(sharding.entries,
+                                             sharding.capacity * sizeof(ShardEntry));
+  }
+  ShardEntry* entry = sharding.entries + sharding.num_entries++;
+  entry->shard = shard;
+  entry->bits = (SubsetWord*) arena_push(&search_arena, words * sizeof(SubsetWord));
+  subset_copy(entry->bits, bits, words);
+  entry->score = score;
+  entry->cost = cost;
 }
 
-void compute_maa_with_sdd(SearchData* data, SearchResult* result, SddNode** node, SddManager* manager,
-  char* subset, int feature_to_remove, int y_size, SddWmc* maa, SddWmc* bound, int move_only) {
-  // Move feature_to_remove to left child of Y-constrained node
-  Feature* feature = data->features[feature_to_remove];
-  *node = sdd_move_feature_to_pos(*node, manager, feature->indicators,
-                                  feature->num_indicators, y_size+1, 0); // need to move to y_size+1 since moving down
+// SDD size after the last vtree minimization of the search (or at its start)
+static SddSize minimize_baseline = 0;
 
+// Helper function: apply the vtree minimization limits of options to manager
+static void set_vtree_limits(SddManager* manager, SearchOptions* options) {
+  if (options->vtree_time_limit > 0) {
+    sdd_manager_set_vtree_search_time_limit(options->vtree_time_limit, manager);
+  }
+  if (options->vtree_size_limit > 0) {
+    sdd_manager_set_vtree_operation_size_limit(options->vtree_size_limit, manager);
+  }
+  if (options->vtree_memory_limit > 0) {
+    sdd_manager_set_vtree_operation_memory_limit(options->vtree_memory_limit, manager);
+  }
+}
+
+// Helper function: after a feature move, minimize the vtree below the
+// XY-constrained node if the SDD grew by options->minimize_growth since the
+// last minimization. The features stay on the right-most path above the
+// XY-constrained node, so the search layout is not changed. Moves garbage
+// collect, so the live size of the manager is the size of node, without a
+// traversal of it.
+static void minimize_x_region(SddManager* manager, SearchData* data,
+    SearchResult* result, SearchOptions* options) {
+  if (options->minimize_growth <= 0) return;
+  SddSize size = sdd_manager_live_size(manager);
+  if (size <= options->minimize_growth * minimize_baseline) return;
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
   Vtree* vtree = sdd_manager_vtree(manager);
-  SddLiteral y_vtree, xy_vtree;   
-  update_constrained_positions(vtree, y_size, data->num_features, &y_vtree, &xy_vtree);
+  for (int j = 0; j < data->num_features; j++) vtree = sdd_vtree_right(vtree);
+  TRACE_BEGIN("sdd_vtree_minimize_limited", "search");
+  sdd_vtree_minimize_limited(vtree, manager);
+  TRACE_END("sdd_vtree_minimize_limited", "search");
+  sdd_manager_garbage_collect(manager);
+  minimize_baseline = sdd_manager_live_size(manager);
+  SearchStats* stats = &result->stats;
+  stats->minimizations++;
+  stats->minimize_size_before += size;
+  stats->minimize_size_after += minimize_baseline;
+  stats->minimize_seconds += elapsed_seconds(&start);
+}
 
-  if (move_only) return;
+// Bounds precomputed before the search, with --cheap-bounds (see
+// precompute_bounds)
+static struct {
+  SddWmc* single;           // single[j]: MPA with feature j excluded
+  SddWmc* pair;             // pair[j*(j-1)/2 + k]: MPA with features j and k
+                            // excluded (k < j)
+  SddWmc* bound;            // bound[t]: bound of the search node at depth t,
+                            // from the features excluded above it
+} cheap;
 
-  // Compute E-SDP
-  EsdpManager* e_manager = esdp_manager_new(*node, manager, data->literal_weights);  
-  *bound = compute_mpa(e_manager, data->decision, data->threshold, xy_vtree, y_vtree, maa);
+// Helper function: MPA of Y = y_set, all features but the excluded ones, which
+// are at the last num_excluded positions of the right-most path
+static SddWmc mpa_excluding(SddNode* node, SddManager* manager, SearchData* data,
+    SearchOptions* options, SearchStats* stats, const SubsetWord* y_set,
+    const int num_excluded) {
+  SddLiteral y_vtree = 0, xy_vtree = 0;
+  if (naive_bayes == NULL) {
+    update_constrained_positions(sdd_manager_vtree(manager),
+        data->num_features - num_excluded, data->num_features, &y_vtree, &xy_vtree);
+  }
+  return esdp_mpa(node, manager, data, options, y_set, xy_vtree, y_vtree, NULL, stats);
+}
 
-  esdp_manager_free(e_manager);
+// Helper function: compute the MPA of all features, and with each single
+// feature and each pair of features excluded. The MPA of Y bounds the ECA of
+// every subset of Y, so at a search node with excluded features E, the MPA
+// with any one or two of E excluded bounds the ECA of the subsets below it: a
+// bound for the price of a table lookup. The MPA also depends on the order of
+// Y in the vtree, so this bound is sometimes tighter than the one of the node.
+static void precompute_bounds(SddNode** node, SddManager* manager, SearchData* data,
+    SearchOptions* options, SearchResult* result) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  int n = data->num_features;
+  cheap.single = (SddWmc*) malloc(n * sizeof(SddWmc));
+  cheap.pair = (SddWmc*) malloc((n * (n - 1) / 2 + 1) * sizeof(SddWmc));
+  cheap.bound = (SddWmc*) malloc((n + 1) * sizeof(SddWmc));
+  ArenaMark mark = arena_mark(&search_arena);
+  SubsetWord* y_set = (SubsetWord*) arena_push_zero(&search_arena,
+      subset_words(n) * sizeof(SubsetWord));
+  for (int j = 0; j < n; j++) subset_add(y_set, j);
+  cheap.bound[0] = mpa_excluding(*node, manager, data, options, &result->stats, y_set, 0);
+  for (int j = 0; j < n; j++) {
+    Feature* fj = data->features[j];
+    if (naive_bayes == NULL) {
+      *node = sdd_move_feature_to_pos(*node, manager, fj->indicators, fj->num_indicators,
+                                      n - 1, 0, NULL);
+    }
+    subset_remove(y_set, j);
+    cheap.single[j] = mpa_excluding(*node, manager, data, options, &result->stats,
+                                    y_set, 1);
+    for (int k = 0; k < j; k++) {
+      // moving k down to n - 2 moves the feature there up, back into Y
+      Feature* fk = data->features[k];
+      if (naive_bayes == NULL) {
+        *node = sdd_move_feature_to_pos(*node, manager, fk->indicators, fk->num_indicators,
+                                        n - 2, 0, NULL);
+      }
+      if (k > 0) subset_add(y_set, k - 1);
+      subset_remove(y_set, k);
+      cheap.pair[j * (j - 1) / 2 + k] =
+          mpa_excluding(*node, manager, data, options, &result->stats, y_set, 2);
+    }
+    if (j > 0) subset_add(y_set, j - 1);
+    subset_add(y_set, j);
+  }
+  arena_pop(&search_arena, mark);
+  result->bounds_seconds = elapsed_seconds(&start);
+  printf(" mpa of all features: %.6f\n", cheap.bound[0]);
+  printf(" bounds             : %d single, %d pairs (%.3fs)\n", n, n * (n - 1) / 2,
+         result->bounds_seconds);
+}
+
+static void free_cheap_bounds() {
+  free(cheap.single);
+  free(cheap.pair);
+  free(cheap.bound);
+  memset(&cheap, 0, sizeof(cheap));
+}
+
+// Helper function: set the cheap bound below the search node at depth, after
+// feature depth is included (value 1) or excluded (value 0)
+static void update_cheap_bound(const SubsetWord* subset, const int depth,
+    const int value) {
+  if (cheap.bound == NULL) return;
+  SddWmc bound = cheap.bound[depth];
+  if (!value) {
+    if (cheap.single[depth] < bound) bound = cheap.single[depth];
+    // pairs with the features excluded before depth, a word of them at a time
+    const SddWmc* pairs = cheap.pair + depth * (depth - 1) / 2;
+    for (int w = 0; w * SUBSET_WORD_BITS < depth; w++) {
+      SubsetWord excluded = ~subset[w];
+      int rest = depth - w * SUBSET_WORD_BITS;
+      if (rest < SUBSET_WORD_BITS) excluded &= ((SubsetWord) 1 << rest) - 1;
+      while (excluded != 0) {
+        int k = w * SUBSET_WORD_BITS + __builtin_ctzll(excluded);
+        if (pairs[k] < bound) bound = pairs[k];
+        excluded &= excluded - 1;
+      }
+    }
+  }
+  cheap.bound[depth + 1] = bound;
 }
 
-// n choose m
-void bnb_search_aux(SearchData* data, SearchResult* result, SddNode** node, SddManager* manager,
-    int cur_level, char* cur_subset, char* avail_features, int num_avail, int is_nb) {
-  int soft_depth = data->num_features - (int)data->budget;
-  int hard_depth = (is_nb == 1) ? soft_depth : data->num_features - 1;
-  if (!is_nb && cur_level >= soft_depth) soft_depth = cur_level + 1;
+// Helper function: prune the search node at depth if its cheap bound is below
+// the best ECA (with epsilon). Checked on entry to a node, and before the
+// feature move into an excluding child, which the prune then saves; the
+// child is then counted as expanded, as on entry.
+static int cheap_prune(SearchData* data, SearchResult* result, SearchOptions* options,
+    const int depth, const int before_move) {
+  if (cheap.bound == NULL || depth >= data->num_features || depth < frontier.depth) {
+    return 0;
+  }
+  SddWmc bound = cheap.bound[depth];
+  SddWmc incumbent = incumbent_score(result);
+  if (incumbent <= 0 || bound >= (1 + options->epsilon) * incumbent) return 0;
+  if (before_move) result->stats.nodes_expanded++;
+  result->stats.prunes_by_depth[depth]++;
+  result->stats.cheap_prunes++;
+  if (bound > result->max_pruned_bound) result->max_pruned_bound = bound;
+  return 1;
+}
 
-  if (cur_level >= hard_depth || num_avail <= 0) return;
+// Helper function: whether the symmetry constraints allow feature depth to be
+// included (value 1) or excluded (value 0), given the features before it
+static int symmetry_allows(const SubsetWord* subset, const int depth, const int value) {
+  if (symmetry == NULL) return 1;
+  int other = value ? symmetry->requires[depth] : symmetry->required_by[depth];
+  return other < 0 || other > depth || subset_has(subset, other) == value;
+}
 
-  // sort available features in ascending order of MPA
-  SddWmc** sorted_avail = (SddWmc**) malloc(num_avail * sizeof(SddWmc*));
-  SddWmc bound, maa;
-  int j = 0;
-  for (int i = 0; i < data->num_features; i++) {
-    if (avail_features[i] == 1) {
-      sorted_avail[j] = (SddWmc*) malloc(2 * sizeof(SddWmc));
-      sorted_avail[j][0] = i; // feature id
-      cur_subset[i] = 0;
-      compute_maa_with_sdd(data,result,node,manager,cur_subset,i,data->num_features-cur_level-1,NULL,&bound,0);
-      sorted_avail[j][1] = bound;
-      cur_subset[i] = 1;
-      j++;
+// Bound cache of the search, with --bound-cache (see boundcache.c). With it,
+// the search does not move features as it descends: features are moved only
+// to compute a value that is not in the cache (see lay_out_features).
+static BoundCache* bound_cache = NULL;
+static int* feature_of_var = NULL; // Feature of each indicator variable, with
+                                   // the bound cache or the budget bound
+
+static void map_feature_vars(SearchData* data) {
+  if (feature_of_var != NULL) return;
+  feature_of_var = (int*) calloc(data->var_count + 1, sizeof(int));
+  for (int j = 0; j < data->num_features; j++) {
+    Feature* feature = data->features[j];
+    for (SddSize i = 0; i < feature->num_indicators; i++) {
+      feature_of_var[feature->indicators[i]] = j;
     }
   }
-  qsort((void*)sorted_avail, num_avail-1, sizeof(SddWmc*), cmp_by_bound_inc);
+}
 
-  // num_successors = num_avail - (n - m - k - 1)
-  // choose the first num_successors features among them (let these Qk)
-  // Remove Qk from avail; remove num_successors from num_avail
-  int num_successors = num_avail - (soft_depth - cur_level - 1);
-  for (int i = 0; i < num_successors; i++) {
-    avail_features[(int)sorted_avail[i][0]] = 0;
+// Helper function: the features at the first count positions of the
+// right-most path, into order
+static void path_order(SddManager* manager, int* order, const int count) {
+  Vtree* vtree = sdd_manager_vtree(manager);
+  for (int p = 0; p < count; p++) {
+    Vtree* leaf = sdd_vtree_left(vtree);
+    while (!sdd_vtree_is_leaf(leaf)) leaf = sdd_vtree_left(leaf);
+    order[p] = feature_of_var[sdd_vtree_var(leaf)];
+    vtree = sdd_vtree_right(vtree);
   }
+}
 
-  // From right-most descendant node (qk) to left:
-  char* new_subset = (char*) malloc(data->num_features * sizeof(char));
-  for (int i = num_successors-1; i >= 0; i--) {
-    int feature_to_remove = (int) sorted_avail[i][0];
-    SddWmc maa_decrease = sorted_avail[i][1];
-    new_subset = (char*) memcpy(new_subset, cur_subset, data->num_features);
-    new_subset[feature_to_remove] = 0;
+// Helper function: move the features of set (count of them) to the first
+// count positions of the right-most path, as the MPA of Y = set or the ECA of
+// subset = set needs. The features that stay are the longest run of features
+// of set followed by features not in set, in path order: with a split t, the
+// ones of set above t and the others below it. The others of set move up to
+// t, and the others not in set down to it, so that the moves are the fewest
+// possible. Moving a feature in or out of Y as the search descends thus takes
+// one move, as in the search without the cache.
+static void lay_out_features(SddNode** node, SddManager* manager, SearchData* data,
+    SearchResult* result, SearchOptions* options, const SubsetWord* set, const int count) {
+  int n = data->num_features;
+  ArenaMark mark = arena_mark(&search_arena);
+  int* order = (int*) arena_push(&search_arena, n * sizeof(int));
+  path_order(manager, order, n);
+  // split t keeping the most features: of set above t, not in set below
+  int t = 0, kept = n - count, best = kept;
+  for (int p = 0; p < n; p++) {
+    kept += subset_has(set, order[p]) ? 1 : -1;
+    if (kept > best) {
+      best = kept;
+      t = p + 1;
+    }
+  }
+  if (best == n) {
+    arena_pop(&search_arena, mark);
+    return;
+  }
+  // features of set below t move up to t (moving a feature up to rl_pos puts
+  // it there), after the ones moved before
+  int split = t;
+  for (int q = t; q < n; q++) {
+    if (!subset_has(set, order[q])) continue;
+    int j = order[q];
+    memmove(order + split + 1, order + split, (q - split) * sizeof(int));
+    order[split] = j;
+    Feature* feature = data->features[j];
+    *node = sdd_move_feature_to_pos(*node, manager, feature->indicators,
+                                    feature->num_indicators, split++, 0, &result->stats);
+  }
+  // features not in set above t move down to the split (moving a feature
+  // down to rl_pos puts it just above the feature there), last first
+  for (int p = t - 1; p >= 0; p--) {
+    if (subset_has(set, order[p])) continue;
+    int j = order[p];
+    memmove(order + p, order + p + 1, (split - 1 - p) * sizeof(int));
+    order[--split] = j;
+    Feature* feature = data->features[j];
+    *node = sdd_move_feature_to_pos(*node, manager, feature->indicators,
+                                    feature->num_indicators, split + 1, 0, &result->stats);
+  }
+  minimize_x_region(manager, data, result, options);
+  arena_pop(&search_arena, mark);
+}
 
-    if (num_successors == 1 && cur_level+1 < soft_depth) {
-      // move cur feature inside Y-constrained node in vtree
-      compute_maa_with_sdd(data, result, node, manager, new_subset, feature_to_remove, data->num_features-cur_level-1, NULL, NULL, 1);
-      bnb_search_aux(data, result, node, manager, cur_level+1, new_subset, avail_features, num_avail-i-1, is_nb);
-    } else {
-      if (is_nb) {
-        maa = bound = maa_decrease;
-        compute_maa_with_sdd(data, result, node, manager, new_subset, feature_to_remove, data->num_features-cur_level-1, NULL, NULL, 1);
-        if (bound - result->best_score >= DBL_EPSILON) { // Prune subtree if bound < best_esdp
-          if (cur_level + 1 == soft_depth) { // Leaf node. Update best ESDP
-            if (maa > result->best_score) {
-              result->best_score = maa;
-              result->cost = data->num_features - cur_level - 1;
-              if (result->best_subset == NULL) result->best_subset = (char*) malloc(data->num_features * sizeof(char));
-              for (int j = 0; j < data->num_features; j++) result->best_subset[j] = new_subset[j];
-            }
-          } else { // Internal node. Search subtree
-            bnb_search_aux(data, result, node, manager, cur_level+1, new_subset, avail_features, num_avail-i-1, is_nb);
-          }
-        }
-      } else if (cur_level+1 < soft_depth) { // general network.
-        bound = maa_decrease;
-        compute_maa_with_sdd(data, result, node, manager, new_subset, feature_to_remove, data->num_features-cur_level-1, NULL, &bound, 1);
-        if (bound - result->best_score >= DBL_EPSILON) { // Prune subtree if bound < best_esdp
-          bnb_search_aux(data, result, node, manager, cur_level+1, new_subset, avail_features, num_avail-i-1, is_nb);
-        }
-      } else { // general network. need to compute actual eca
-        bound = maa_decrease;
-        if (bound - result->best_score >= DBL_EPSILON) { // Prune subtree if bound < best_esdp
-          compute_maa_with_sdd(data, result, node, manager, new_subset, feature_to_remove, data->num_features-cur_level-1, &maa, &bound, 0);
-          if (maa > result->best_score) {
-            result->best_score = maa;
-            result->cost = data->num_features - cur_level - 1;
-            if (result->best_subset == NULL) result->best_subset = (char*) malloc(data->num_features * sizeof(char));
-            for (int j = 0; j < data->num_features; j++) result->best_subset[j] = new_subset[j];            
-          }
-          bnb_search_aux(data, result, node, manager, cur_level+1, new_subset, avail_features, num_avail-i-1, is_nb);          
-        }
+// Helper function: whether unassigned feature j fits in the budget left at
+// the search node at depth, with cost cur_cost, next to the always-included
+// features still to come (with slack for the rounding of the float costs). A
+// candidate subset below the node has these, so it has j only if it fits;
+// the budget left only shrinks further down.
+static int affordable(SearchData* data, const int depth, const float cur_cost,
+    const int j) {
+  if (subset_has(data->always_included, j)) return 1;
+  return (double) cur_cost + always_included_cost[depth] + data->costs[j] <=
+         data->budget * (1 + 1e-6);
+}
+
+// Helper function: move the num_unaffordable unassigned features that are not
+// affordable to the last positions of Y (the first y positions of the
+// right-most path), so that a Y without them ends above them. The unassigned
+// features are in no particular order in Y, as the moves of the search find
+// a feature where it is. The ones already at the end of Y stay, and the others
+// move down to it (moving a feature down to rl_pos puts it just above the
+// feature there).
+static void park_unaffordable(SddNode** node, SddManager* manager, SearchData* data,
+    SearchResult* result, SearchOptions* options, const int depth, const float cur_cost,
+    const int y, const int num_unaffordable) {
+  ArenaMark mark = arena_mark(&search_arena);
+  int* order = (int*) arena_push(&search_arena, y * sizeof(int));
+  path_order(manager, order, y);
+  int parked = 0;
+  while (parked < num_unaffordable && order[y - 1 - parked] >= depth &&
+         !affordable(data, depth, cur_cost, order[y - 1 - parked])) {
+    parked++;
+  }
+  for (int p = y - 1 - parked; p >= 0 && parked < num_unaffordable; p--) {
+    int j = order[p];
+    if (j < depth || affordable(data, depth, cur_cost, j)) continue;
+    Feature* feature = data->features[j];
+    *node = sdd_move_feature_to_pos(*node, manager, feature->indicators,
+                                    feature->num_indicators, y, 0, &result->stats);
+    parked++;
+  }
+  if (parked > 0) minimize_x_region(manager, data, result, options);
+  arena_pop(&search_arena, mark);
+}
+
+// Helper function: the MPA bound of the search node at depth, with cost
+// cur_cost, over Y = the included features of subset and the unassigned ones.
+// With options->budget_bound, Y has only the unassigned features that are
+// affordable: the others are in no candidate below the node.
+static SddWmc node_bound(SddNode** node, SddManager* manager, SearchData* data,
+    SearchResult* result, SearchOptions* options, const SubsetWord* subset,
+    const int depth, const int num_included, const float cur_cost) {
+  int y = data->num_features - depth + num_included;
+  int num_unaffordable = 0;
+  if (options->budget_bound) {
+    for (int j = depth; j < data->num_features; j++) {
+      if (!affordable(data, depth, cur_cost, j)) num_unaffordable++;
+    }
+  }
+  ArenaMark mark = arena_mark(&search_arena);
+  SubsetWord* y_set = NULL;
+  SddWmc bound;
+  if (bound_cache != NULL || naive_bayes != NULL) {
+    y_set = (SubsetWord*) arena_push(&search_arena,
+        subset_words(data->num_features) * sizeof(SubsetWord));
+    subset_copy(y_set, subset, subset_words(data->num_features));
+    for (int i = depth; i < data->num_features; i++) {
+      if (num_unaffordable == 0 || affordable(data, depth, cur_cost, i)) {
+        subset_add(y_set, i);
       }
     }
+  } else if (num_unaffordable > 0) {
+    park_unaffordable(node, manager, data, result, options, depth, cur_cost, y,
+                      num_unaffordable);
+  }
+  y -= num_unaffordable;
+  if (bound_cache != NULL) {
+    if (bound_cache_get(bound_cache, BOUND_CACHE_MPA, y_set, &bound)) {
+      result->stats.cache_hits++;
+      arena_pop(&search_arena, mark);
+      return bound;
+    }
+    lay_out_features(node, manager, data, result, options, y_set, y);
+  }
+  SddLiteral y_vtree = 0, xy_vtree = 0;
+  if (naive_bayes == NULL) {
+    update_constrained_positions(sdd_manager_vtree(manager), y, data->num_features,
+                                 &y_vtree, &xy_vtree);
+  }
+  bound = esdp_mpa(*node, manager, data, options, y_set, xy_vtree, y_vtree, NULL,
+                   &result->stats);
+  if (bound_cache != NULL) bound_cache_put(bound_cache, BOUND_CACHE_MPA, y_set, bound);
+  arena_pop(&search_arena, mark);
+  return bound;
+}
 
-    avail_features[feature_to_remove] = 1;
+// Helper function: the ECA of subset, of num_included features
+static SddWmc subset_eca(SddNode** node, SddManager* manager, SearchData* data,
+    SearchResult* result, SearchOptions* options, const SubsetWord* subset,
+    const int num_included) {
+  SddWmc eca = 0;
+  if (bound_cache != NULL) {
+    if (bound_cache_get(bound_cache, BOUND_CACHE_ECA, subset, &eca)) {
+      result->stats.cache_hits++;
+      return eca;
+    }
+    lay_out_features(node, manager, data, result, options, subset, num_included);
+  }
+  SddLiteral y_vtree = 0, xy_vtree = 0;
+  if (naive_bayes == NULL) {
+    update_constrained_positions(sdd_manager_vtree(manager), num_included,
+                                 data->num_features, &y_vtree, &xy_vtree);
   }
-  free(sorted_avail);
-  free(new_subset);  
-  // All descendants have been tested. Return
+  esdp_mpa(*node, manager, data, options, subset, xy_vtree, y_vtree, &eca,
+           &result->stats);
+  if (bound_cache != NULL) bound_cache_put(bound_cache, BOUND_CACHE_ECA, subset, eca);
+  return eca;
+}
+
+static void open_bound_cache(SearchData* data, Fnf* fnf, SearchOptions* options) {
+  bound_cache = bound_cache_load(options->bound_cache_file, data, fnf,
+                                 options->decision);
+  map_feature_vars(data);
+}
+
+static void close_bound_cache(SearchOptions* options) {
+  if (bound_cache == NULL) return;
+  bound_cache_save(bound_cache, options->bound_cache_file);
+  bound_cache_free(bound_cache);
+  bound_cache = NULL;
+}
+
+// Helper function: whether subset has all always-included features, as the
+// subsets the search can select do
+static int has_always_included(SearchData* data, const SubsetWord* subset) {
+  for (SddSize w = 0; w < subset_words(data->num_features); w++) {
+    if (data->always_included[w] & ~subset[w]) return 0;
+  }
+  return 1;
 }
 
 // Helper function: recursively search for an optimal feature subset by E-SDP
 // Invariant: subset at the termination of this function should look the same
 // as what was passed into this function call.
 void search_best_subset_aux(SddNode** node, SddManager* manager,
-    SearchData* data, SearchResult* result, int cur_depth,
-    char* subset, int num_included, float cur_cost) {
+    SearchData* data, SearchResult* result, SearchOptions* options, int cur_depth,
+    SubsetWord* subset, int num_included, float cur_cost) {
   // Backtrack if budget exceeded
   if (cur_cost >= data->budget || cur_depth >= data->num_features) {
+    if (cur_depth < data->num_features) result->stats.budget_cutoffs++;
+    return;
+  }
+  if (cur_cost + always_included_cost[cur_depth] > data->budget) {
+    result->stats.budget_cutoffs++;
     return;
   }
+  if (result->stop_reason != NULL) return;
+  // When resuming, nodes above the frontier were expanded before the
+  // checkpoint, and the branches before it in search order were searched.
+  // For a shard, the coordinator did both.
+  int resuming = cur_depth < frontier.depth;
+  if (!resuming) {
+    frontier.depth = 0;
+    if (sharding.enumerating && cur_depth == sharding.depth) {
+      add_shard_entry(sharding.num_shards++, subset, subset_words(data->num_features), 0,
+                      cur_cost);
+      return;
+    }
+    int stopping = check_memory(manager, result) || check_cancel(result);
+    if (checkpoint_node(data, result, subset, cur_depth, stopping) || stopping) return;
+    result->stats.nodes_expanded++;
+    if (manager != NULL) sample_sdd_size(&result->stats, manager);
+  }
 
-  SddLiteral y_vtree, xy_vtree;   
-  if (result->best_score > 0) {
-    // compute MPA, with size of Y being number of included and unassigned features
-    EsdpManager* e_manager = esdp_manager_new(*node, manager, data->literal_weights);
-    Vtree* vtree = sdd_manager_vtree(manager);
-    update_constrained_positions(
-        vtree, data->num_features-cur_depth+num_included, data->num_features, &y_vtree, &xy_vtree);
-    SddWmc bound = compute_mpa(e_manager, data->decision, data->threshold, xy_vtree, y_vtree, NULL);
-    if (bound < result->best_score) {
+  SddWmc incumbent = incumbent_score(result);
+  if (!resuming && cheap_prune(data, result, options, cur_depth, 0)) return;
+  if (incumbent > 0 && !resuming) {
+    // compute MPA, with Y being the included and unassigned features
+    SddWmc bound = node_bound(node, manager, data, result, options, subset, cur_depth,
+                              num_included, cur_cost);
+    // with epsilon > 0, also prune subtrees that can improve the best ECA by
+    // less than a factor 1 + epsilon
+    if (bound < (1 + options->epsilon) * incumbent) {
+      result->stats.prunes_by_depth[cur_depth]++;
+      if (bound > result->max_pruned_bound) result->max_pruned_bound = bound;
       return;
     }
   }
 
   Feature* feature = data->features[cur_depth];
-  if (cur_cost + data->costs[cur_depth] <= data->budget) {
-    subset[cur_depth] = 1;
+  if (resuming && !subset_has(frontier.path, cur_depth)) {
+    // inclusion searched before the checkpoint, or not in the shard
+  } else if (!symmetry_allows(subset, cur_depth, 1)) {
+    // a cheaper exchangeable feature was excluded: searched with it instead
+    result->stats.symmetry_skips++;
+  } else if (cur_cost + data->costs[cur_depth] <= data->budget) {
+    subset_add(subset, cur_depth);
 
     // Move vtree variables so that features appear in right order
-    *node = sdd_move_feature_to_pos(*node, manager, feature->indicators,
-                                    feature->num_indicators, num_included, 0);
-
-    // Update constrained positions for Y to include cur feature
-    Vtree* vtree = sdd_manager_vtree(manager);
-    update_constrained_positions(
-        vtree, num_included+1, data->num_features, &y_vtree, &xy_vtree);
+    if (bound_cache == NULL && naive_bayes == NULL) {
+      *node = sdd_move_feature_to_pos(*node, manager, feature->indicators,
+                                      feature->num_indicators, num_included, 0,
+                                      &result->stats);
+      minimize_x_region(manager, data, result, options);
+    }
 
-    // Compute agreement score
-    EsdpManager* e_manager =
-        esdp_manager_new(*node, manager, data->literal_weights);
+    // Compute agreement score (before the checkpoint, when resuming), of
+    // subsets with all always-included features
     SddWmc maa = 0;
-    SddWmc mpa = compute_mpa(e_manager, data->decision, data->threshold, xy_vtree, y_vtree, &maa);
+    int candidate = !resuming && has_always_included(data, subset);
+    if (candidate) {
+      maa = subset_eca(node, manager, data, result, options, subset, num_included+1);
+    }
 
     // Update the current best subset. Tie-break by cost
-    if (maa > result->best_score || (maa == result->best_score
-        && cur_cost + data->costs[cur_depth] < result->cost)) {
+    if (candidate && (maa > result->best_score || (maa == result->best_score
+        && cur_cost + data->costs[cur_depth] < result->cost))) {
       update_search_result(result, maa, cur_cost+data->costs[cur_depth],
                            subset, data->num_features);
+      if (sharding.incumbent != NULL) shared_incumbent_raise(sharding.incumbent, maa);
+      if (sharding.enumerating) {
+        add_shard_entry(-1, subset, subset_words(data->num_features), maa, result->cost);
+      }
+    }
+    if (candidate && result->top.k > 1) {
+      offer_top_subset(result, maa, cur_cost + data->costs[cur_depth], subset,
+                       data->num_features);
     }
-    if (e_manager != NULL) esdp_manager_free(e_manager);
 
-    search_best_subset_aux(node, manager, data, result, cur_depth+1, subset,
+    update_cheap_bound(subset, cur_depth, 1);
+    search_best_subset_aux(node, manager, data, result, options, cur_depth+1, subset,
                            num_included+1, cur_cost + data->costs[cur_depth]);
-    subset[cur_depth] = 0;
+    subset_remove(subset, cur_depth);
+    if (resuming && frontier.subtree_only) return; // exclusion not in the shard
+  } else {
+    result->stats.budget_cutoffs++;
+  }
+  if (result->stop_reason != NULL) return;
+  if (subset_has(data->always_included, cur_depth)) return; // never excluded
+  if (!symmetry_allows(subset, cur_depth, 0)) {
+    // a dearer exchangeable feature was included: searched with this one instead
+    result->stats.symmetry_skips++;
+    return;
   }
 
+  update_cheap_bound(subset, cur_depth, 0);
+  if (cheap_prune(data, result, options, cur_depth+1, 1)) return;
+
   // move next_feature to (num included+unassigned feature) pos in vtree
-  *node = sdd_move_feature_to_pos(*node, manager, feature->indicators, feature->num_indicators,
-                                  data->num_features-cur_depth+num_included, 0);
+  if (bound_cache == NULL && naive_bayes == NULL) {
+    *node = sdd_move_feature_to_pos(*node, manager, feature->indicators,
+                                    feature->num_indicators,
+                                    data->num_features-cur_depth+num_included, 0,
+                                    &result->stats);
+    minimize_x_region(manager, data, result, options);
+  }
 
   // recursive run with next_feature excluded
-  search_best_subset_aux(node, manager, data, result, cur_depth+1, subset,
+  search_best_subset_aux(node, manager, data, result, options, cur_depth+1, subset,
                          num_included, cur_cost);
 }
 
-// Search optimal feature subset by E-SDP
-//  - Runs inclusion/exclusion search on features
-//  - First compiles an unconstrained SDD and makes it constrained by moving
-//    feature variables to the top of SDD, with limited vtree minimization.
-SearchResult* search_best_subset(SearchData* data, Fnf* fnf,
-      SddCompilerOptions* options) {
+// Result of a shard, as sent by a worker: a ShardResult, then the prunes by
+// depth (num_features + 1) and the best subset (subset_words(num_features))
+typedef struct {
+  int searched;
+  SddWmc best_score;
+  float cost;
+  SddWmc max_pruned_bound;
+  SearchStats stats;        // Counters only; the pointers are not valid
+} ShardResult;
+
+typedef struct {
+  SddNode** node;
+  SddManager* manager;
+  SearchData* data;
+  SearchOptions* options;
+} ShardContext;
+
+static size_t shard_result_size(const SddSize num_features) {
+  size_t size = sizeof(ShardResult) + (num_features + 1) * sizeof(SddSize) +
+                subset_words(num_features) * sizeof(SubsetWord);
+  return (size + 7) & ~(size_t) 7;
+}
+
+// Helper function: search a shard in a worker process (see run_shards)
+static int search_shard(const int shard, void* blob, void* context) {
+  ShardContext* ctx = (ShardContext*) context;
+  SearchData* data = ctx->data;
+  SearchResult* result = new_search_result(data->num_features);
+  result->epsilon = ctx->options->epsilon;
+  SddSize words = subset_words(data->num_features);
+  ArenaMark mark = arena_mark(&search_arena);
+  SubsetWord* subset =
+      (SubsetWord*) arena_push_zero(&search_arena, words * sizeof(SubsetWord));
+  frontier.path = sharding.entries[sharding.shard_entry[shard]].bits;
+  frontier.depth = sharding.depth;
+  frontier.subtree_only = 1;
+  clock_gettime(CLOCK_MONOTONIC, &result->stats.start);
+  search_best_subset_aux(ctx->node, ctx->manager, data, result, ctx->options, 0, subset,
+                         0, 0);
+  frontier.path = NULL;
+  frontier.depth = 0;
+
+  ShardResult* header = (ShardResult*) blob;
+  SddSize* prunes = (SddSize*) (header + 1);
+  SubsetWord* best_subset = (SubsetWord*) (prunes + data->num_features + 1);
+  header->searched = 1;
+  header->best_score = result->best_score;
+  header->cost = result->cost;
+  header->max_pruned_bound = result->max_pruned_bound;
+  header->stats = result->stats;
+  memcpy(prunes, result->stats.prunes_by_depth, (data->num_features + 1) * sizeof(SddSize));
+  subset_copy(best_subset, result->best_subset, words);
+  int stop = (result->stop_reason != NULL);
+  arena_pop(&search_arena, mark);
+  free_search_result(result);
+  return stop;
+}
+
+// Helper function: add the counters of from to stats
+static void add_search_stats(SearchStats* stats, const SearchStats* from,
+    const SddSize* prunes, const SddSize num_features) {
+  stats->nodes_expanded += from->nodes_expanded;
+  stats->bound_evaluations += from->bound_evaluations;
+  stats->eca_evaluations += from->eca_evaluations;
+  stats->budget_cutoffs += from->budget_cutoffs;
+  stats->symmetry_skips += from->symmetry_skips;
+  stats->cheap_prunes += from->cheap_prunes;
+  stats->cache_hits += from->cache_hits;
+  stats->incumbent_updates += from->incumbent_updates;
+  stats->esdp_seconds += from->esdp_seconds;
+  stats->feature_moves += from->feature_moves;
+  stats->var_moves += from->var_moves;
+  stats->condition_calls += from->condition_calls;
+  stats->apply_calls += from->apply_calls;
+  stats->gc_calls += from->gc_calls;
+  stats->move_seconds += from->move_seconds;
+  stats->minimizations += from->minimizations;
+  stats->minimize_size_before += from->minimize_size_before;
+  stats->minimize_size_after += from->minimize_size_after;
+  stats->minimize_seconds += from->minimize_seconds;
+  for (SddSize i = 0; i <= num_features; i++) stats->prunes_by_depth[i] += prunes[i];
+}
+
+// Helper function: the update of the best subset of search_best_subset_aux
+static void merge_candidate(SearchResult* result, const SddWmc score, const float cost,
+    const SubsetWord* subset, const SddSize num_features) {
+  if (score > result->best_score || (score == result->best_score && cost < result->cost)) {
+    result->best_score = score;
+    result->cost = cost;
+    subset_copy(result->best_subset, subset, subset_words(num_features));
+  }
+}
+
+// Helper function: search with options->num_workers worker processes. The
+// coordinator searches down to the shard depth, recording the roots of the
+// subtrees there as shards, and the workers search the shards. Merging the
+// results of the coordinator and the shards in search order, with the update
+// of the best subset of the serial search, gives the serial result.
+static void search_sharded(SddNode** node, SddManager* manager, SearchData* data,
+    SearchResult* result, SearchOptions* options, SubsetWord* subset) {
+  int n = data->num_features;
+  int depth = options->shard_depth;
+  if (depth <= 0) { // about 8 shards per worker
+    for (depth = 1; (1 << depth) < 8 * options->num_workers; depth++);
+  }
+  if (depth > n - 1) depth = n - 1;
+  memset(&sharding, 0, sizeof(sharding));
+  ArenaMark mark = arena_mark(&search_arena);
+  sharding.depth = depth;
+  sharding.enumerating = 1;
+  sharding.incumbent = shared_incumbent_new(0);
+  search_best_subset_aux(node, manager, data, result, options, 0, subset, 0, 0);
+  sharding.enumerating = 0;
+  sharding.shard_entry = (int*) malloc((sharding.num_shards + 1) * sizeof(int));
+  for (int e = 0; e < sharding.num_entries; e++) {
+    if (sharding.entries[e].shard >= 0) sharding.shard_entry[sharding.entries[e].shard] = e;
+  }
+
+  printf("\nsharded search: %d workers, %d shards at depth %d\n", options->num_workers,
+         sharding.num_shards, depth);
+  size_t size = shard_result_size(n);
+  char* blobs = (char*) malloc((sharding.num_shards + 1) * size);
+  int* shards_per_worker = (int*) malloc(options->num_workers * sizeof(int));
+  ShardContext context = { node, manager, data, options };
+  if (result->stop_reason == NULL && sharding.num_shards > 0 &&
+      run_shards(options->num_workers, sharding.num_shards, search_shard, &context,
+                 blobs, size, shards_per_worker)) {
+    result->stop_reason = "memory limit";
+  }
+
+  // Merge in search order
+  result->best_score = 0;
+  result->cost = 0;
+  subset_clear(result->best_subset, subset_words(n));
+  for (int e = 0; e < sharding.num_entries; e++) {
+    ShardEntry* entry = sharding.entries + e;
+    if (entry->shard < 0) {
+      merge_candidate(result, entry->score, entry->cost, entry->bits, n);
+    } else {
+      ShardResult* header = (ShardResult*) (blobs + entry->shard * size);
+      if (!header->searched) continue;
+      SddSize* prunes = (SddSize*) (header + 1);
+      add_search_stats(&result->stats, &header->stats, prunes, n);
+      if (header->max_pruned_bound > result->max_pruned_bound) {
+        result->max_pruned_bound = header->max_pruned_bound;
+      }
+      if (header->best_score > 0) {
+        merge_candidate(result, header->best_score, header->cost,
+                        (SubsetWord*) (prunes + n + 1), n);
+      }
+    }
+  }
+  printf(" shards per worker      :");
+  for (int w = 0; w < options->num_workers && sharding.num_shards > 0; w++) {
+    printf(" %d", shards_per_worker[w]);
+  }
+  printf("\n");
+
+  free(shards_per_worker);
+  free(blobs);
+  free(sharding.entries);
+  free(sharding.shard_entry);
+  shared_incumbent_free(sharding.incumbent);
+  memset(&sharding, 0, sizeof(sharding));
+  arena_pop(&search_arena, mark);
+}
+
+// Helper function: time repeated runs of a batched E-SDP computation, or of
+// the scalar one if kernel is NULL, until at least min_seconds have passed.
+// Return the time per threshold.
+static double time_thresholds(EsdpEvaluator* evaluator, const SddLiteral decision,
+    const char* kernel, const SddWmc* thresholds, const int num_thresholds,
+    SddLiteral xy_vtree, SddLiteral y_vtree, SddWmc* mpa, SddWmc* eca,
+    const double min_seconds) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  SddSize runs = 0;
+  double seconds;
+  do {
+    if (kernel != NULL) {
+      esdp_select_batch_kernel(kernel);
+      esdp_compute_mpa_batch(evaluator, decision, thresholds, num_thresholds,
+                             xy_vtree, y_vtree, mpa, eca);
+    } else {
+      for (int t = 0; t < num_thresholds; t++) {
+        mpa[t] = esdp_compute_mpa(evaluator, decision, thresholds[t],
+                                  xy_vtree, y_vtree, eca + t);
+      }
+    }
+    runs++;
+  } while ((seconds = elapsed_seconds(&start)) < min_seconds);
+  esdp_select_batch_kernel(NULL);
+  return seconds / (runs * num_thresholds);
+}
+
+// Helper function: evaluate the ECA and MPA of subset for decision and
+// num_thresholds thresholds evenly spaced in (0,1), and compare the throughput
+// of the batched evaluation with one scalar evaluation per threshold
+static void threshold_study(SddNode** node, SddManager* manager, SearchData* data,
+    const SddLiteral decision, const SubsetWord* subset, const int num_thresholds) {
+  // Move the features of subset to the top of the vtree
+  int y_size = 0;
+  for (int i = 0; i < data->num_features; i++) {
+    if (!subset_has(subset, i)) continue;
+    Feature* feature = data->features[i];
+    *node = sdd_move_feature_to_pos(*node, manager, feature->indicators,
+                                    feature->num_indicators, y_size++, 0, NULL);
+  }
+  SddLiteral y_vtree, xy_vtree;
+  update_constrained_positions(sdd_manager_vtree(manager), y_size, data->num_features,
+                               &y_vtree, &xy_vtree);
+
+  SddWmc* thresholds = (SddWmc*) malloc(num_thresholds * sizeof(SddWmc));
+  SddWmc* mpa = (SddWmc*) malloc(num_thresholds * sizeof(SddWmc));
+  SddWmc* eca = (SddWmc*) malloc(num_thresholds * sizeof(SddWmc));
+  SddWmc* scalar_mpa = (SddWmc*) malloc(num_thresholds * sizeof(SddWmc));
+  SddWmc* scalar_eca = (SddWmc*) malloc(num_thresholds * sizeof(SddWmc));
+  for (int t = 0; t < num_thresholds; t++) {
+    thresholds[t] = (t + 1.0) / (num_thresholds + 1.0);
+  }
+
+  EsdpEvaluator* evaluator = esdp_evaluator_new(*node, manager, data->literal_weights);
+  double scalar_time = time_thresholds(evaluator, decision, NULL, thresholds,
+      num_thresholds, xy_vtree, y_vtree, scalar_mpa, scalar_eca, 0.2);
+
+  printf("\nthreshold study of best subset (%d thresholds)\n", num_thresholds);
+  printf(" scalar time/threshold : %.3f us\n", 1e6 * scalar_time);
+  const char* kernels[] = { "scalar", "avx2", "avx512" };
+  for (int k = 0; k < 3; k++) {
+    if (!esdp_select_batch_kernel(kernels[k])) continue;
+    double batch_time = time_thresholds(evaluator, decision, kernels[k], thresholds,
+        num_thresholds, xy_vtree, y_vtree, mpa, eca, 0.2);
+    SddWmc max_diff = 0;
+    for (int t = 0; t < num_thresholds; t++) {
+      max_diff = fmax(max_diff, fmax(fabs(mpa[t] - scalar_mpa[t]),
+                                     fabs(eca[t] - scalar_eca[t])));
+    }
+    printf(" batch %-6s time/threshold : %.3f us (%.1fx, max |diff| %g)\n",
+           kernels[k], 1e6 * batch_time, scalar_time / batch_time, max_diff);
+  }
+  esdp_evaluator_free(evaluator);
+
+  printf(" threshold      ECA      MPA\n");
+  for (int t = 0; t < num_thresholds; t++) {
+    printf(" %9.4f %8.6f %8.6f\n", thresholds[t], scalar_eca[t], scalar_mpa[t]);
+  }
+  free(thresholds);
+  free(mpa);
+  free(eca);
+  free(scalar_mpa);
+  free(scalar_eca);
+}
+
+// Compile fnf into an SDD and make it constrained by moving feature variables
+// to the top of the vtree, with limited vtree minimization. The manager is
+// returned via manager, and the phase times go to result. Returns NULL (with
+// the manager freed) if the memory limit stopped the compilation.
+SddNode* compile_constrained_sdd(SearchData* data, Fnf* fnf,
+    SddCompilerOptions* options, SearchOptions* search_options, SearchResult* result,
+    SddManager** manager_out) {
+  memory_budget_init(&memory_budget, search_options->mem_limit_kb);
   // Compile an unconstrained SDD
   printf("\ncreating manager..."); fflush(stdout);
   SddManager* manager = sdd_manager_create(fnf->var_count,0);
   sdd_manager_set_options(options,manager);
+  set_vtree_limits(manager, search_options);
+  compile_result = result;
+  fnf_to_sdd_check = (search_options->mem_limit_kb > 0) ? check_compile_memory : NULL;
   printf("\ncompiling..."); fflush(stdout);
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  TRACE_BEGIN("fnf_to_sdd", "compile");
   SddNode* node = fnf_to_sdd(fnf,manager);
+  TRACE_END("fnf_to_sdd", "compile");
+  fnf_to_sdd_check = NULL;
+  compile_result = NULL;
+  result->compile_seconds = elapsed_seconds(&start);
+  if (node == NULL) { // stopped by check_compile_memory
+    sdd_manager_free(manager);
+    return NULL;
+  }
   char* s;  
   printf("\n sdd size               : %s \n",s=ppc(sdd_size(node))); free(s);
   printf(" sdd node count         : %s \n",s=ppc(sdd_count(node))); free(s);
   if(options->minimize_cardinality) {
     printf("\nminimizing cardinality...");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    TRACE_BEGIN("sdd_minimize_cardinality", "compile");
     node = sdd_minimize_cardinality(node,manager);
+    TRACE_END("sdd_minimize_cardinality", "compile");
+    result->minimize_seconds = elapsed_seconds(&start);
     printf("size = %zu / node count = %zu\n",sdd_size(node),sdd_count(node));
   }
   sdd_manager_auto_gc_and_minimize_off(manager);
   sdd_ref(node,manager);
 
-  // Move feature variables to make a constrained SDD
+  // Condition on the fixed nodes, and move feature variables to make a
+  // constrained SDD
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (data->num_fixed_nodes > 0) {
+    printf("\nconditioning on %"PRIsS" fixed nodes...", data->num_fixed_nodes);
+    fflush(stdout);
+    for (SddSize i = 0; i < data->num_fixed_literals; i++) {
+      SddNode* conditioned = sdd_condition(data->fixed_literals[i], node, manager);
+      sdd_ref(conditioned, manager);
+      sdd_deref(node, manager);
+      node = conditioned;
+    }
+    if (sdd_node_is_false(node)) {
+      fprintf(stderr, "The fixed nodes have probability 0\n");
+      exit(1);
+    }
+    printf("size = %zu / node count = %zu\n",sdd_size(node),sdd_count(node));
+  }
   Feature* feature;
   Vtree* vtree = sdd_manager_vtree(manager);
   for (int i = data->num_features-1; i >= 0; i--) {
     feature = data->features[i];
     node = sdd_move_feature_to_pos(node, manager, feature->indicators,
-                                   feature->num_indicators, 0, 1);
+                                   feature->num_indicators, 0, 1, NULL);
     // Minimize XY-constrained vtree node so far
     vtree = sdd_manager_vtree(manager);
     for (int j = 0; j < data->num_features - i; j++) {
       vtree = sdd_vtree_right(vtree);
     } // vtree now points to XY-constrained node
     sdd_ref(node,manager);
+    TRACE_BEGIN_ARG("sdd_vtree_minimize_limited", "constrain", "feature", i);
     sdd_vtree_minimize_limited(vtree,manager);
+    TRACE_END("sdd_vtree_minimize_limited", "constrain");
     sdd_deref(node,manager);
+    if (check_memory(manager, result)) break;
   }
   sdd_deref(node,manager);
+  result->constrain_seconds = elapsed_seconds(&start);
+  if (result->stop_reason != NULL) {
+    sdd_manager_free(manager);
+    return NULL;
+  }
   printf(" sdd size           : %s \n", s=ppc(sdd_size(node))); free(s);
   printf(" sdd node count     : %s \n", s=ppc(sdd_count(node))); free(s);
+  *manager_out = manager;
+  return node;
+}
+
+// Load the constrained SDD saved with the checkpoint of search_options, as
+// compile_constrained_sdd does (the loading time is the compile time)
+SddNode* load_constrained_sdd(SearchOptions* search_options, SearchResult* result,
+    SddManager** manager_out) {
+  printf("\nloading checkpoint sdd %s...", search_options->checkpoint_file); fflush(stdout);
+  memory_budget_init(&memory_budget, search_options->mem_limit_kb);
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  SddManager* manager;
+  SddNode* node = load_checkpoint_sdd(search_options->checkpoint_file, &manager);
+  sdd_manager_auto_gc_and_minimize_off(manager);
+  set_vtree_limits(manager, search_options);
+  result->compile_seconds = elapsed_seconds(&start);
+  char* s;
+  printf("\n sdd size           : %s \n", s=ppc(sdd_size(node))); free(s);
+  *manager_out = manager;
+  return node;
+}
+
+// Request that the running search stops at its next search node, with stop
+// reason "cancelled". Only sets a flag, so it may be called from another
+// thread or a signal handler.
+void cancel_search() {
+  cancel_requested = 1;
+}
+
+// Search optimal feature subset by E-SDP, in the constrained SDD node of
+// compile_constrained_sdd or load_constrained_sdd
+//  - Runs inclusion/exclusion search on features. The search moves features
+//    in the vtree: node is replaced by the SDD after the search, and must be
+//    referenced once by the caller (as it will be after).
+//  - Any layout of the features works, so the SDD of a search can be searched
+//    again, e.g. with another threshold, budget or costs in data.
+//  - With a checkpoint file, saves the constrained SDD and the frontier of the
+//    search as it goes; with resume, continues from the frontier of the
+//    checkpoint instead.
+//  - With a bound cache file, takes the MPAs and ECAs it has from it and adds
+//    the ones it computes, saving it after the search.
+void search_constrained_sdd(SddNode** node_ptr, SddManager* manager, SearchData* data,
+    Fnf* fnf, SearchOptions* search_options, SearchResult* result) {
+  SddNode* node = *node_ptr;
+  result->epsilon = search_options->epsilon;
+  memory_budget_init(&memory_budget, search_options->mem_limit_kb);
+  cancel_requested = 0;
+  if (search_options->top_k > 1) {
+    keep_top_subsets(result, search_options->top_k, data->num_features);
+  }
+  SubsetWord* subset = (SubsetWord*) arena_push_zero(&search_arena,
+      subset_words(data->num_features) * sizeof(SubsetWord));
+  always_included_cost = (float*) calloc(data->num_features + 1, sizeof(float));
+  for (int i = data->num_features - 1; i >= 0; i--) {
+    always_included_cost[i] = always_included_cost[i+1] +
+        (subset_has(data->always_included, i) ? data->costs[i] : 0);
+  }
+  double previous_seconds = 0;
+  int frontier_depth = 0;
+  if (search_options->resume) {
+    printf("\nreading checkpoint %s...", search_options->checkpoint_file); fflush(stdout);
+    frontier_depth = read_checkpoint(search_options->checkpoint_file, data, result, subset,
+                               &previous_seconds);
+    if (frontier_depth == CHECKPOINT_COMPLETE) {
+      printf("\n search already complete\n");
+    } else {
+      printf("\n frontier depth     : %d (", frontier_depth);
+      for (int i = 0; i < frontier_depth; i++) printf("%d", subset_has(subset, i));
+      printf("), %"PRIsS" nodes expanded before\n", result->stats.nodes_expanded);
+    }
+  } else if (search_options->checkpoint_file != NULL) {
+    save_checkpoint_sdd(search_options->checkpoint_file, node, manager);
+    write_checkpoint(search_options->checkpoint_file, data, result, subset, 0, 0);
+  }
+
+  if (search_options->symmetry) {
+    printf("\nfinding exchangeable features...\n");
+    symmetry = find_feature_symmetry(data, fnf);
+    print_feature_symmetry(data, symmetry);
+  }
 
   // Search for an optimal subset using recursive helper func
-  sdd_ref(node, manager);
+  if (naive_bayes != NULL) {
+    SddSize count;
+    SddSize first = searched_decisions(data, search_options, &count);
+    printf("\ntabulating naive bayes classifier...\n");
+    naive_bayes_prepare(naive_bayes, data, first, count);
+    printf(" instantiations     : %"PRIsS" of %"PRIsS" features, %"PRIsS" classes\n",
+           naive_bayes->size, naive_bayes->num_features, naive_bayes->num_classes);
+  } else if (search_options->esdp_mode == ESDP_INCREMENTAL ||
+      search_options->esdp_mode == ESDP_COMPARE) {
+    SddSize count;
+    SddSize first = searched_decisions(data, search_options, &count);
+    num_esdp_caches = data->num_decisions;
+    esdp_caches = (EsdpCache**) calloc(num_esdp_caches, sizeof(EsdpCache*));
+    for (SddSize k = first; k < first + count; k++) {
+      esdp_caches[k] = esdp_cache_new(manager, data->literal_weights, data->decisions[k],
+                                      data->thresholds[k]);
+    }
+  }
+  result->decision = search_options->decision;
+  if (search_options->bound_cache_file != NULL) {
+    printf("\nreading bound cache...\n");
+    open_bound_cache(data, fnf, search_options);
+  }
+  if (search_options->budget_bound && manager != NULL) map_feature_vars(data);
+  if (search_options->cheap_bounds && frontier_depth != CHECKPOINT_COMPLETE) {
+    printf("\nprecomputing bounds...\n");
+    SearchStats stats = result->stats;
+    precompute_bounds(&node, manager, data, search_options, result);
+    result->stats = stats; // not counted as search
+  }
+  checkpoint_start(search_options, subset, frontier_depth, previous_seconds,
+                   data->num_features);
+  minimize_baseline = (manager != NULL) ? sdd_manager_live_size(manager) : 0;
+  clock_gettime(CLOCK_MONOTONIC, &result->stats.start);
+  TRACE_BEGIN("search", "search");
+  if (frontier_depth == CHECKPOINT_COMPLETE) {
+    // nothing left to search
+  } else if (search_options->num_workers > 1) {
+    search_sharded(&node, manager, data, result, search_options, subset);
+  } else {
+    search_best_subset_aux(&node, manager, data, result, search_options, 0, subset, 0, 0);
+  }
+  TRACE_END("search", "search");
+  result->search_seconds = previous_seconds + elapsed_seconds(&result->stats.start);
+  // the checks of --mem-limit sample the rss only with a limit
+  if (process_peak_rss_kb() > result->peak_rss_kb) {
+    result->peak_rss_kb = process_peak_rss_kb();
+  }
+  sort_top_subsets(result, data->num_features);
+  if (node != NULL) {
+    result->sdd_size = sdd_size(node);
+    result->sdd_count = sdd_count(node);
+  }
+  if (search_options->checkpoint_file != NULL && result->stop_reason == NULL) {
+    write_checkpoint(search_options->checkpoint_file, data, result, subset,
+                     CHECKPOINT_COMPLETE, result->search_seconds);
+  }
+  checkpoint_stop();
 
-  SearchResult* result = new_search_result(data->num_features);
-  char* subset = (char*) calloc(data->num_features, sizeof(char));
-  search_best_subset_aux(&node, manager, data, result, 0, subset, 0, 0);
-  free(subset);
+  if (search_options->num_thresholds > 0 && result->best_score > 0 &&
+      result->stop_reason == NULL && node != NULL) {
+    if (search_options->decision < 0 && data->num_decisions > 1) {
+      printf("\nthreshold study skipped: it is of one decision (see --per-decision)\n");
+    } else {
+      SddSize count;
+      SddSize k = searched_decisions(data, search_options, &count);
+      threshold_study(&node, manager, data, data->decisions[k], result->best_subset,
+                      search_options->num_thresholds);
+    }
+  }
+
+  *node_ptr = node;
+
+  SearchStats* stats = &result->stats;
+  SddSize prunes = 0;
+  for (int i = 0; i <= data->num_features; i++) prunes += stats->prunes_by_depth[i];
+  printf("\nsearch nodes expanded  : %"PRIsS"\n", stats->nodes_expanded);
+  printf(" engine                : %s", result->engine);
+  if (result->engine_reason != NULL) printf(" (%s)", result->engine_reason);
+  printf("\n");
+  printf(" bound/eca evaluations : %"PRIsS" / %"PRIsS" (%.3fs)\n",
+         stats->bound_evaluations, stats->eca_evaluations, stats->esdp_seconds);
+  printf(" prunes/budget cutoffs : %"PRIsS" / %"PRIsS"\n", prunes, stats->budget_cutoffs);
+  if (search_options->cheap_bounds) {
+    printf(" prunes by cheap/mpa   : %"PRIsS" / %"PRIsS" (%.1f%% / %.1f%% of nodes)\n",
+           stats->cheap_prunes, prunes - stats->cheap_prunes,
+           100.0 * stats->cheap_prunes / (stats->nodes_expanded ? stats->nodes_expanded : 1),
+           100.0 * (prunes - stats->cheap_prunes) /
+           (stats->nodes_expanded ? stats->nodes_expanded : 1));
+  }
+  printf(" symmetry skips        : %"PRIsS"\n", stats->symmetry_skips);
+  if (bound_cache != NULL) {
+    printf(" bound cache hits      : %"PRIsS" (%"PRIsS" values, %"PRIsS" new)\n",
+           stats->cache_hits, bound_cache->count, bound_cache->count - bound_cache->loaded);
+  }
+  printf(" search arena          : %zu KB in %"PRIsS" blocks\n",
+         search_arena.capacity / 1024, search_arena.block_allocations);
+  printf(" incumbent updates     : %"PRIsS"\n", stats->incumbent_updates);
+  printf(" feature/var moves     : %"PRIsS" / %"PRIsS" (%.3fs, %"PRIsS" gc calls)\n",
+         stats->feature_moves, stats->var_moves, stats->move_seconds, stats->gc_calls);
+  if (search_options->minimize_growth > 0) {
+    SddSize calls = stats->minimizations > 0 ? stats->minimizations : 1;
+    printf(" vtree minimizations   : %"PRIsS" (%.3fs, mean size %"PRIsS" -> %"PRIsS")\n",
+           stats->minimizations, stats->minimize_seconds,
+           stats->minimize_size_before / calls, stats->minimize_size_after / calls);
+  }
 
-  sdd_deref(node, manager);
+  if (search_options->esdp_mode == ESDP_COMPARE) {
+    SddSize calls = esdp_comparison.calls > 0 ? esdp_comparison.calls : 1;
+    printf("\nesdp calls             : %"PRIsS"\n", esdp_comparison.calls);
+    printf(" library time/call     : %.3f us\n", 1e6 * esdp_comparison.library_seconds / calls);
+    printf(" flat time/call        : %.3f us\n", 1e6 * esdp_comparison.flat_seconds / calls);
+    printf(" incremental time/call : %.3f us\n",
+           1e6 * esdp_comparison.incremental_seconds / calls);
+    printf(" max |mpa diff|        : %g\n", esdp_comparison.max_mpa_diff);
+    printf(" max |eca diff|        : %g\n", esdp_comparison.max_eca_diff);
+    printf(" max |incremental diff|: %g\n", esdp_comparison.max_incremental_diff);
+  }
+  if (esdp_caches != NULL) {
+    // Totals over the decisions searched for
+    SddSize epochs = 0, visited = 0, recomputed = 0;
+    double recomputed_fraction = 0;
+    for (SddSize k = 0; k < num_esdp_caches; k++) {
+      EsdpCache* esdp_cache = esdp_caches[k];
+      if (esdp_cache == NULL) continue;
+      epochs += esdp_cache->cur_epoch;
+      visited += esdp_cache->visited;
+      recomputed += esdp_cache->recomputed;
+      recomputed_fraction += esdp_cache->recomputed_fraction;
+      esdp_cache_free(esdp_cache);
+    }
+    SddSize calls = epochs > 0 ? epochs : 1;
+    printf("\nincremental esdp calls : %"PRIsS"\n", epochs);
+    printf(" nodes visited/call    : %.1f\n", (double) visited / calls);
+    printf(" nodes recomputed/call : %.1f\n", (double) recomputed / calls);
+    printf(" recomputed fraction   : %.4f (mean over calls, of sdd node count)\n",
+           recomputed_fraction / calls);
+    free(esdp_caches);
+    esdp_caches = NULL;
+    num_esdp_caches = 0;
+  }
+
+  if (symmetry != NULL) {
+    free_feature_symmetry(symmetry);
+    symmetry = NULL;
+  }
+  free_cheap_bounds();
+  free(always_included_cost);
+  always_included_cost = NULL;
+  close_bound_cache(search_options);
+  free(feature_of_var);
+  feature_of_var = NULL;
+  arena_free(&search_arena);
+}
 
-  sdd_manager_free(manager);
-  return result;
+// Search optimal feature subset by E-SDP, as search_constrained_sdd, of the
+// naive Bayes classifier nb of naive_bayes_detect: the MPA and ECA of each
+// search node are computed from the tables of nb, so there is no SDD to
+// compile, and no features to move
+void search_naive_bayes(NaiveBayes* nb, SearchData* data, Fnf* fnf,
+    SearchOptions* search_options, SearchResult* result) {
+  SddNode* node = NULL;
+  naive_bayes = nb;
+  search_constrained_sdd(&node, NULL, data, fnf, search_options, result);
+  naive_bayes = NULL;
 }
@@ -0,0 +1,450 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "search.h"
+
+/****************************************************************************************
+ * detects exchangeable features in the weighted CNF of a network:
+ *  --features i and j are exchangeable if a permutation of the CNF variables
+ *    that swaps their indicators (up to a permutation of states), swaps
+ *    parameter variables local to their clauses, and fixes all other variables
+ *    maps the clauses onto themselves and preserves literal weights
+ *  --the weighted model count, and with it the ECA of every feature subset,
+ *    is then unchanged when i is replaced by j in a subset
+ *  --within a class of exchangeable features, a subset that includes a feature
+ *    can include a cheaper one of the class instead at no loss of ECA, so the
+ *    search only needs subsets that include a prefix of the class ordered by
+ *    cost (the cheaper feature dominates the dearer one)
+ * candidate permutations are built by matching clauses with their local
+ * variables masked, and are accepted only after checking them on the clauses
+ ****************************************************************************************/
+
+// Feature arities up to this have all permutations of their states tried;
+// larger ones only the identity
+#define SYMMETRY_MAX_PERMUTED_ARITY 4
+
+typedef struct {
+  SddLiteral count;
+  SddLiteral* literals;     // Sorted
+  SddLiteral local;         // Local variable of the clause (0 for none)
+} SymClause;
+
+typedef struct {
+  SearchData* data;
+  Fnf* fnf;
+  SddLiteral* rename;       // Variable renaming (rename[v] == v if unchanged)
+  SddLiteral* weight_id;    // Variables with equal weights share an id
+  SddSize** touched;        // touched[i]: clauses with indicators of feature i
+  SddSize* num_touched;
+  SddLiteral** locals;      // locals[i]: variables local to touched[i]
+  SddSize* num_locals;
+  SddLiteral* clause_local; // Local variable of each clause (0 for none)
+} SymmetryContext;
+
+static int cmp_literals(const void* a, const void* b) {
+  SddLiteral x = *(const SddLiteral*) a, y = *(const SddLiteral*) b;
+  return (x > y) - (x < y);
+}
+
+static int cmp_clauses(const void* a, const void* b) {
+  const SymClause* x = (const SymClause*) a;
+  const SymClause* y = (const SymClause*) b;
+  if (x->count != y->count) return (x->count > y->count) - (x->count < y->count);
+  for (SddLiteral k = 0; k < x->count; k++) {
+    if (x->literals[k] != y->literals[k]) return (x->literals[k] > y->literals[k]) ? 1 : -1;
+  }
+  return 0;
+}
+
+// Helper function: copy the clauses of list into out, renamed by the renaming
+// of ctx and sorted, with their literals stored in pool
+static void rename_clauses(SymmetryContext* ctx, const SddSize* list,
+    const SddSize count, SymClause* out, SddLiteral* pool) {
+  for (SddSize c = 0; c < count; c++) {
+    const LitSet* clause = ctx->fnf->litsets + list[c];
+    out[c].count = clause->literal_count;
+    out[c].literals = pool;
+    out[c].local = ctx->clause_local[list[c]];
+    for (SddLiteral k = 0; k < clause->literal_count; k++) {
+      SddLiteral lit = clause->literals[k];
+      *pool++ = (lit > 0) ? ctx->rename[lit] : -ctx->rename[-lit];
+    }
+    qsort(out[c].literals, out[c].count, sizeof(SddLiteral), cmp_literals);
+  }
+  qsort(out, count, sizeof(SymClause), cmp_clauses);
+}
+
+static SddSize clause_literals(SymmetryContext* ctx, const SddSize* list,
+    const SddSize count) {
+  SddSize total = 0;
+  for (SddSize c = 0; c < count; c++) total += ctx->fnf->litsets[list[c]].literal_count;
+  return total;
+}
+
+// Helper function: mask the local variables of feature i in the renaming, by
+// variables above var_count that stand for their weights
+static void mask_locals(SymmetryContext* ctx, const int i, const int mask) {
+  for (SddSize k = 0; k < ctx->num_locals[i]; k++) {
+    SddLiteral var = ctx->locals[i][k];
+    ctx->rename[var] = mask ? ctx->data->var_count + 1 + ctx->weight_id[var] : var;
+  }
+}
+
+static int equal_clauses(const SymClause* a, const SymClause* b, const SddSize count) {
+  for (SddSize c = 0; c < count; c++) {
+    if (cmp_clauses(a + c, b + c) != 0) return 0;
+  }
+  return 1;
+}
+
+// Helper function: whether features i and j are exchangeable with indicator
+// s of i mapped to indicator perm[s] of j
+static int exchangeable_with(SymmetryContext* ctx, const int i, const int j,
+    const int* perm) {
+  SearchData* data = ctx->data;
+  Feature* fi = data->features[i];
+  Feature* fj = data->features[j];
+  SddWmc* w = data->literal_weights;
+  SddSize n = ctx->num_touched[i];
+  SddSize size = clause_literals(ctx, ctx->touched[i], n);
+  if (clause_literals(ctx, ctx->touched[j], n) != size) return 0;
+
+  SymClause* ci = (SymClause*) malloc(2 * n * sizeof(SymClause));
+  SymClause* cj = ci + n;
+  SddLiteral* pool = (SddLiteral*) malloc(4 * size * sizeof(SddLiteral));
+  int ok = 1;
+
+  // Match the clauses of i, with its indicators renamed to those of j, to
+  // the clauses of j, with local variables masked on both sides
+  for (SddSize s = 0; s < fi->num_indicators; s++) {
+    SddLiteral a = fi->indicators[s], b = fj->indicators[perm[s]];
+    if (w[a] != w[b] || w[-a] != w[-b]) ok = 0;
+    ctx->rename[a] = b;
+  }
+  mask_locals(ctx, i, 1);
+  rename_clauses(ctx, ctx->touched[i], n, ci, pool);
+  mask_locals(ctx, i, 0);
+  for (SddSize s = 0; s < fi->num_indicators; s++) {
+    ctx->rename[fi->indicators[s]] = fi->indicators[s];
+  }
+  mask_locals(ctx, j, 1);
+  rename_clauses(ctx, ctx->touched[j], n, cj, pool + size);
+  mask_locals(ctx, j, 0);
+  ok = ok && equal_clauses(ci, cj, n);
+
+  // Candidate permutation: swap the indicators, and the local variables of
+  // matched clauses
+  for (SddSize s = 0; ok && s < fi->num_indicators; s++) {
+    SddLiteral a = fi->indicators[s], b = fj->indicators[perm[s]];
+    ctx->rename[a] = b;
+    ctx->rename[b] = a;
+  }
+  for (SddSize c = 0; ok && c < n; c++) {
+    SddLiteral a = ci[c].local, b = cj[c].local;
+    if (a == 0) continue;
+    if ((ctx->rename[a] != a && ctx->rename[a] != b) ||
+        (ctx->rename[b] != b && ctx->rename[b] != a) ||
+        w[a] != w[b] || w[-a] != w[-b]) {
+      ok = 0;
+    } else {
+      ctx->rename[a] = b;
+      ctx->rename[b] = a;
+    }
+  }
+
+  // Check that it maps the clauses of i and j onto themselves
+  if (ok) {
+    SddSize* both = (SddSize*) malloc(2 * n * sizeof(SddSize));
+    memcpy(both, ctx->touched[i], n * sizeof(SddSize));
+    memcpy(both + n, ctx->touched[j], n * sizeof(SddSize));
+    SymClause* renamed = ci; // ci and cj, 2n clauses
+    rename_clauses(ctx, both, 2 * n, renamed, pool);
+    SymClause* original = (SymClause*) malloc(2 * n * sizeof(SymClause));
+    SddLiteral* fixed = (SddLiteral*) malloc(2 * size * sizeof(SddLiteral));
+    SddLiteral* saved = (SddLiteral*) malloc((data->var_count + 1) * sizeof(SddLiteral));
+    memcpy(saved, ctx->rename, (data->var_count + 1) * sizeof(SddLiteral));
+    for (SddLiteral v = 0; v <= data->var_count; v++) ctx->rename[v] = v;
+    rename_clauses(ctx, both, 2 * n, original, fixed);
+    memcpy(ctx->rename, saved, (data->var_count + 1) * sizeof(SddLiteral));
+    ok = equal_clauses(renamed, original, 2 * n);
+    free(saved);
+    free(fixed);
+    free(original);
+    free(both);
+  }
+
+  for (SddLiteral v = 0; v <= data->var_count; v++) ctx->rename[v] = v;
+  free(pool);
+  free(ci);
+  return ok;
+}
+
+// Helper function: next permutation of perm in lexicographic order (0 after
+// the last one)
+static int next_permutation(int* perm, const int n) {
+  int k = n - 2;
+  while (k >= 0 && perm[k] > perm[k+1]) k--;
+  if (k < 0) return 0;
+  int l = n - 1;
+  while (perm[l] < perm[k]) l--;
+  int tmp = perm[k]; perm[k] = perm[l]; perm[l] = tmp;
+  for (int a = k + 1, b = n - 1; a < b; a++, b--) {
+    tmp = perm[a]; perm[a] = perm[b]; perm[b] = tmp;
+  }
+  return 1;
+}
+
+// Helper function: whether features i and j are exchangeable
+static int exchangeable(SymmetryContext* ctx, const int i, const int j) {
+  Feature* fi = ctx->data->features[i];
+  Feature* fj = ctx->data->features[j];
+  if (ctx->num_locals[i] == (SddSize) -1 || ctx->num_locals[j] == (SddSize) -1 ||
+      fi->num_indicators != fj->num_indicators ||
+      ctx->num_touched[i] != ctx->num_touched[j] ||
+      ctx->num_locals[i] != ctx->num_locals[j]) {
+    return 0;
+  }
+  // No clause may mention both features
+  for (SddSize a = 0, b = 0; a < ctx->num_touched[i] && b < ctx->num_touched[j];) {
+    if (ctx->touched[i][a] == ctx->touched[j][b]) return 0;
+    if (ctx->touched[i][a] < ctx->touched[j][b]) a++;
+    else b++;
+  }
+  int arity = fi->num_indicators;
+  int* perm = (int*) malloc(arity * sizeof(int));
+  for (int s = 0; s < arity; s++) perm[s] = s;
+  int found = 0;
+  do {
+    found = exchangeable_with(ctx, i, j, perm);
+  } while (!found && arity <= SYMMETRY_MAX_PERMUTED_ARITY && next_permutation(perm, arity));
+  free(perm);
+  return found;
+}
+
+static int cmp_weights(const void* a, const void* b, void* weights) {
+  const SddWmc* w = (const SddWmc*) weights;
+  SddLiteral x = *(const SddLiteral*) a, y = *(const SddLiteral*) b;
+  if (w[x] != w[y]) return (w[x] > w[y]) ? 1 : -1;
+  if (w[-x] != w[-y]) return (w[-x] > w[-y]) ? 1 : -1;
+  return 0;
+}
+
+// Helper function: collect the clauses touched by each feature, and the
+// variables local to them (other than indicators of features and the
+// decision, occurring only in those clauses). num_locals[i] is -1 if a clause
+// has more than one local variable, which the matching does not handle.
+static void collect_feature_clauses(SymmetryContext* ctx) {
+  SearchData* data = ctx->data;
+  Fnf* fnf = ctx->fnf;
+  SddLiteral var_count = data->var_count;
+  SddSize* occurrences = (SddSize*) calloc(var_count + 1, sizeof(SddSize));
+  SddSize* seen = (SddSize*) calloc(var_count + 1, sizeof(SddSize));
+  int* var_feature = (int*) malloc((var_count + 1) * sizeof(int));
+  SddSize* stamp = (SddSize*) calloc(fnf->litset_count, sizeof(SddSize));
+  for (SddLiteral v = 0; v <= var_count; v++) var_feature[v] = -1;
+  for (int i = 0; i < data->num_features; i++) {
+    Feature* feature = data->features[i];
+    for (SddSize s = 0; s < feature->num_indicators; s++) {
+      var_feature[feature->indicators[s]] = i;
+    }
+  }
+  for (SddSize k = 0; k < data->num_decisions; k++) { // not local either
+    var_feature[llabs(data->decisions[k])] = -2;
+  }
+  for (SddSize c = 0; c < fnf->litset_count; c++) {
+    const LitSet* clause = fnf->litsets + c;
+    for (SddLiteral k = 0; k < clause->literal_count; k++) {
+      occurrences[llabs(clause->literals[k])]++;
+    }
+  }
+
+  for (int i = 0; i < data->num_features; i++) {
+    SddSize count = 0;
+    for (SddSize c = 0; c < fnf->litset_count; c++) {
+      const LitSet* clause = fnf->litsets + c;
+      for (SddLiteral k = 0; k < clause->literal_count; k++) {
+        if (var_feature[llabs(clause->literals[k])] == i) {
+          stamp[c] = i + 1;
+          count++;
+          break;
+        }
+      }
+    }
+    ctx->touched[i] = (SddSize*) malloc(count * sizeof(SddSize));
+    ctx->num_touched[i] = 0;
+    for (SddSize c = 0; c < fnf->litset_count; c++) {
+      if (stamp[c] == (SddSize) i + 1) ctx->touched[i][ctx->num_touched[i]++] = c;
+    }
+
+    // Local variables: count their occurrences in the touched clauses
+    ctx->locals[i] = NULL;
+    ctx->num_locals[i] = 0;
+    SddSize capacity = 0;
+    for (SddSize t = 0; t < count; t++) {
+      const LitSet* clause = fnf->litsets + ctx->touched[i][t];
+      for (SddLiteral k = 0; k < clause->literal_count; k++) {
+        SddLiteral var = llabs(clause->literals[k]);
+        if (var_feature[var] != -1) continue;
+        if (seen[var] == 0) {
+          if (ctx->num_locals[i] == capacity) {
+            capacity = 2 * capacity + 8;
+            ctx->locals[i] = (SddLiteral*) realloc(ctx->locals[i],
+                                                   capacity * sizeof(SddLiteral));
+          }
+          ctx->locals[i][ctx->num_locals[i]++] = var;
+        }
+        seen[var]++;
+      }
+    }
+    SddSize local_count = 0;
+    for (SddSize k = 0; k < ctx->num_locals[i]; k++) {
+      SddLiteral var = ctx->locals[i][k];
+      if (seen[var] == occurrences[var]) ctx->locals[i][local_count++] = var;
+      seen[var] = 0;
+    }
+    ctx->num_locals[i] = local_count;
+    for (SddSize k = 0; k < local_count; k++) seen[ctx->locals[i][k]] = 1;
+    for (SddSize t = 0; t < count; t++) {
+      SddSize c = ctx->touched[i][t];
+      const LitSet* clause = fnf->litsets + c;
+      ctx->clause_local[c] = 0;
+      for (SddLiteral k = 0; k < clause->literal_count; k++) {
+        SddLiteral var = llabs(clause->literals[k]);
+        if (!seen[var]) continue;
+        if (ctx->clause_local[c] != 0 && ctx->clause_local[c] != var) {
+          ctx->num_locals[i] = (SddSize) -1;
+        }
+        ctx->clause_local[c] = var;
+      }
+    }
+    for (SddSize k = 0; k < local_count; k++) seen[ctx->locals[i][k]] = 0;
+  }
+  free(occurrences);
+  free(seen);
+  free(var_feature);
+  free(stamp);
+}
+
+static int find_root(int* parent, int i) {
+  while (parent[i] != i) i = parent[i] = parent[parent[i]];
+  return i;
+}
+
+// Find classes of exchangeable features. Returns the constraints of the
+// search: a subset that includes feature j must include requires[j].
+FeatureSymmetry* find_feature_symmetry(SearchData* data, Fnf* fnf) {
+  int n = data->num_features;
+  SymmetryContext ctx;
+  ctx.data = data;
+  ctx.fnf = fnf;
+  ctx.rename = (SddLiteral*) malloc((data->var_count + 1) * sizeof(SddLiteral));
+  for (SddLiteral v = 0; v <= data->var_count; v++) ctx.rename[v] = v;
+  ctx.touched = (SddSize**) malloc(n * sizeof(SddSize*));
+  ctx.num_touched = (SddSize*) malloc(n * sizeof(SddSize));
+  ctx.locals = (SddLiteral**) malloc(n * sizeof(SddLiteral*));
+  ctx.num_locals = (SddSize*) malloc(n * sizeof(SddSize));
+  ctx.clause_local = (SddLiteral*) calloc(fnf->litset_count, sizeof(SddLiteral));
+  collect_feature_clauses(&ctx);
+
+  // Variables with equal weights share an id, for masking
+  ctx.weight_id = (SddLiteral*) malloc((data->var_count + 1) * sizeof(SddLiteral));
+  SddLiteral* vars = (SddLiteral*) malloc(data->var_count * sizeof(SddLiteral));
+  for (SddLiteral v = 0; v < data->var_count; v++) vars[v] = v + 1;
+  qsort_r(vars, data->var_count, sizeof(SddLiteral), cmp_weights, data->literal_weights);
+  for (SddLiteral k = 0; k < data->var_count; k++) {
+    ctx.weight_id[vars[k]] = (k > 0 && cmp_weights(vars + k - 1, vars + k,
+        data->literal_weights) == 0) ? ctx.weight_id[vars[k-1]] : k;
+  }
+  free(vars);
+
+  int* parent = (int*) malloc(n * sizeof(int));
+  for (int i = 0; i < n; i++) parent[i] = i;
+  for (int i = 0; i < n; i++) {
+    for (int j = i + 1; j < n; j++) {
+      if (find_root(parent, i) == find_root(parent, j)) continue;
+      // an always-included feature cannot be replaced by another
+      if (subset_has(data->always_included, i) || subset_has(data->always_included, j)) {
+        continue;
+      }
+      if (exchangeable(&ctx, i, j)) parent[find_root(parent, j)] = find_root(parent, i);
+    }
+  }
+
+  // Chain each class in ascending order of cost (then index)
+  FeatureSymmetry* symmetry = (FeatureSymmetry*) malloc(sizeof(FeatureSymmetry));
+  symmetry->requires = (int*) malloc(n * sizeof(int));
+  symmetry->required_by = (int*) malloc(n * sizeof(int));
+  symmetry->class_of = (int*) malloc(n * sizeof(int));
+  symmetry->num_classes = 0;
+  symmetry->num_constrained = 0;
+  for (int i = 0; i < n; i++) {
+    symmetry->requires[i] = symmetry->required_by[i] = -1;
+    symmetry->class_of[i] = -1;
+  }
+  for (int i = 0; i < n; i++) {
+    if (find_root(parent, i) != i) continue;
+    int last = -1;
+    while (1) { // pick the cheapest member of the class not yet chained
+      int next = -1;
+      for (int j = i; j < n; j++) {
+        if (find_root(parent, j) != i || symmetry->class_of[j] >= 0) continue;
+        if (next < 0 || data->costs[j] < data->costs[next]) next = j;
+      }
+      if (next < 0) break;
+      symmetry->class_of[next] = symmetry->num_classes;
+      if (last >= 0) {
+        symmetry->requires[next] = last;
+        symmetry->required_by[last] = next;
+        symmetry->num_constrained++;
+      }
+      last = next;
+    }
+    if (symmetry->requires[last] >= 0) {
+      symmetry->num_classes++;
+    } else {
+      symmetry->class_of[last] = -1;
+    }
+  }
+
+  for (int i = 0; i < n; i++) {
+    free(ctx.touched[i]);
+    free(ctx.locals[i]);
+  }
+  free(parent);
+  free(ctx.rename);
+  free(ctx.weight_id);
+  free(ctx.touched);
+  free(ctx.num_touched);
+  free(ctx.locals);
+  free(ctx.num_locals);
+  free(ctx.clause_local);
+  return symmetry;
+}
+
+void free_feature_symmetry(FeatureSymmetry* symmetry) {
+  free(symmetry->requires);
+  free(symmetry->required_by);
+  free(symmetry->class_of);
+  free(symmetry);
+}
+
+// Print the classes of exchangeable features, cheapest first
+void print_feature_symmetry(SearchData* data, FeatureSymmetry* symmetry) {
+  printf(" exchangeable classes   : %d (%d constrained features)\n",
+         symmetry->num_classes, symmetry->num_constrained);
+  for (int i = 0; i < data->num_features; i++) {
+    if (symmetry->class_of[i] < 0 || symmetry->requires[i] >= 0) continue;
+    printf("  ");
+    for (int j = i; j >= 0; j = symmetry->required_by[j]) {
+      printf("%s%s(%.2f)", j == i ? "" : " <= ", data->features[j]->name, data->costs[j]);
+    }
+    printf("\n");
+  }
+}
+
+/****************************************************************************************
+ * end
+ ****************************************************************************************/
@@ -0,0 +1,118 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "trace.h"
+
+/****************************************************************************************
+ * records begin/end and counter events in memory, and writes them in the
+ * Chrome trace event format when the trace is closed:
+ *  --B/E events nest, one thread; timestamps are microseconds since trace_open
+ *  --names, categories and argument names must be string literals, since
+ *    only their pointers are kept
+ ****************************************************************************************/
+
+#ifdef TRIM_TRACE
+
+typedef struct {
+  char phase;               // 'B', 'E' or 'C' (counter)
+  const char* name;
+  const char* category;     // Counter series, for counters
+  const char* arg_name;     // NULL for none
+  long arg;
+  double value;             // Counter value
+  double timestamp;         // Microseconds
+} TraceEvent;
+
+int trace_enabled = 0;
+
+static struct {
+  FILE* fp;
+  struct timespec start;
+  size_t count;
+  size_t capacity;
+  TraceEvent* events;
+} trace;
+
+static TraceEvent* new_trace_event(const char phase) {
+  if (trace.count == trace.capacity) {
+    trace.capacity = 2 * trace.capacity + 4096;
+    trace.events = (TraceEvent*) realloc(trace.events, trace.capacity * sizeof(TraceEvent));
+  }
+  TraceEvent* event = trace.events + trace.count++;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  event->phase = phase;
+  event->timestamp = 1e6 * (now.tv_sec - trace.start.tv_sec)
+                     + 1e-3 * (now.tv_nsec - trace.start.tv_nsec);
+  return event;
+}
+
+void trace_event(const char phase, const char* name, const char* category,
+                 const char* arg_name, const long arg) {
+  TraceEvent* event = new_trace_event(phase);
+  event->name = name;
+  event->category = category;
+  event->arg_name = arg_name;
+  event->arg = arg;
+}
+
+void trace_counter(const char* name, const char* series, const double value) {
+  TraceEvent* event = new_trace_event('C');
+  event->name = name;
+  event->category = series;
+  event->arg_name = NULL;
+  event->value = value;
+}
+
+int trace_open(const char* filename) {
+  trace.fp = fopen(filename, "w");
+  if (trace.fp == NULL) {
+    fprintf(stderr, "Could not open trace file %s\n", filename);
+    exit(1);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &trace.start);
+  trace_enabled = 1;
+  return 1;
+}
+
+void trace_close() {
+  if (!trace_enabled) return;
+  trace_enabled = 0;
+  FILE* fp = trace.fp;
+  fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+  for (size_t i = 0; i < trace.count; i++) {
+    TraceEvent* event = trace.events + i;
+    fprintf(fp, "%s\n{\"ph\": \"%c\", \"name\": \"%s\", \"pid\": 1, \"tid\": 1, \"ts\": %.3f",
+            i > 0 ? "," : "", event->phase, event->name, event->timestamp);
+    if (event->phase == 'C') {
+      fprintf(fp, ", \"args\": {\"%s\": %.17g}", event->category, event->value);
+    } else {
+      fprintf(fp, ", \"cat\": \"%s\"", event->category);
+      if (event->arg_name != NULL) {
+        fprintf(fp, ", \"args\": {\"%s\": %ld}", event->arg_name, event->arg);
+      }
+    }
+    fprintf(fp, "}");
+  }
+  fprintf(fp, "\n]}\n");
+  fclose(fp);
+  free(trace.events);
+  trace.events = NULL;
+  trace.count = trace.capacity = 0;
+}
+
+#else
+
+int trace_open(const char* filename) {
+  return 0;
+}
+
+void trace_close() {
+}
+
+#endif // TRIM_TRACE
+
+/****************************************************************************************
+ * end
+ ****************************************************************************************/
@@ -0,0 +1,275 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sddapi.h"
+#include "compiler.h"
+#include "search.h"
+#include "trim.h"
+#include "checkpoint.h"
+#include "naivebayes.h"
+
+// forward references
+void free_fnf(Fnf* fnf);
+SddNode* compile_constrained_sdd(SearchData* data, Fnf* fnf, SddCompilerOptions* options,
+    SearchOptions* search_options, SearchResult* result, SddManager** manager);
+SddNode* load_constrained_sdd(SearchOptions* search_options, SearchResult* result,
+    SddManager** manager);
+void search_constrained_sdd(SddNode** node, SddManager* manager, SearchData* data,
+    Fnf* fnf, SearchOptions* search_options, SearchResult* result);
+void search_naive_bayes(NaiveBayes* nb, SearchData* data, Fnf* fnf,
+    SearchOptions* search_options, SearchResult* result);
+void cancel_search();
+
+/****************************************************************************************
+ * handles of libtrim (see include/trim.h)
+ ****************************************************************************************/
+
+struct TrimHandle {
+  Fnf* fnf;
+  SearchData* data;
+  SddCompilerOptions compiler_options;
+  SddManager* manager;      // NULL until compiled
+  SddNode* node;            // Constrained SDD, referenced once (NULL until
+                            // compiled)
+  NaiveBayes* naive_bayes;  // Of the CNF, if it is naive Bayes (see
+                            // naivebayes.c)
+  int naive_bayes_checked;  // Whether naive_bayes has been detected
+  const char* naive_bayes_reason; // Why the CNF is not naive Bayes (NULL if
+                            // it is)
+  double naive_bayes_seconds; // Time of the detection
+
+  // Wall time of the compile phases, reported in the result of every search
+  double compile_seconds;
+  double minimize_seconds;
+  double constrain_seconds;
+};
+
+static SddCompilerOptions sdd_default_opt() {
+  SddCompilerOptions options =
+    {
+    NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL, //file names
+    1,          // minimize cardinality
+    "balanced", // initial vtree type
+    -1,          // vtree search mode
+    0           // verbose
+    };
+  return options;
+}
+
+static TrimHandle* new_handle(Fnf* fnf, SearchData* data) {
+  TrimHandle* handle = (TrimHandle*) calloc(1, sizeof(TrimHandle));
+  handle->fnf = fnf;
+  handle->data = data;
+  handle->compiler_options = sdd_default_opt();
+  return handle;
+}
+
+// Open the search problem of input_filename over a CNF and its lmap
+TrimHandle* trim_open(const char* cnf_filename, const char* lmap_filename,
+    const char* input_filename) {
+  printf("\nreading cnf...");
+  Fnf* fnf = read_cnf(cnf_filename);
+  printf("vars=%"PRIlitS" clauses=%"PRIsS"\n",fnf->var_count,fnf->litset_count);
+
+  printf("\nreading esdp search data...\n");
+  SearchData* data = read_search_data(lmap_filename, input_filename);
+  return new_handle(fnf, data);
+}
+
+// Open the search problem of input_filename over a network, encoded into a CNF
+TrimHandle* trim_open_net(const char* net_filename, const char* input_filename,
+    const int skip_deterministic) {
+  Fnf* fnf;
+  printf("\nencoding network and reading esdp search data...");
+  SearchData* data = read_search_data_from_net(net_filename, input_filename,
+                                               skip_deterministic, &fnf);
+  printf("vars=%"PRIlitS" clauses=%"PRIsS"\n",fnf->var_count,fnf->litset_count);
+  return new_handle(fnf, data);
+}
+
+void trim_close(TrimHandle* handle) {
+  if (handle->manager != NULL) sdd_manager_free(handle->manager);
+  if (handle->naive_bayes != NULL) naive_bayes_free(handle->naive_bayes);
+  free_fnf(handle->fnf);
+  free_search_data(handle->data);
+  free(handle);
+}
+
+// Options of the trim binary without any option given
+SearchOptions trim_default_search_options() {
+  SearchOptions options =
+      { ESDP_INCREMENTAL, 0, 0, 1, 0, NULL, CHECKPOINT_DEFAULT_INTERVAL, 0, 1, 0, 0, 0, 0, 0, 0,
+        1, NULL, -1, 1, 1 };
+  return options;
+}
+
+// Options of the compilation, to be changed before it
+SddCompilerOptions* trim_compiler_options(TrimHandle* handle) {
+  return &handle->compiler_options;
+}
+
+// Helper function: compile the constrained SDD of handle (or load it from the
+// checkpoint, with options->resume), with the phase times going to result
+static void compile_handle(TrimHandle* handle, SearchOptions* options,
+    SearchResult* result) {
+  if (options->resume) {
+    handle->node = load_constrained_sdd(options, result, &handle->manager);
+  } else {
+    handle->node = compile_constrained_sdd(handle->data, handle->fnf,
+                                           &handle->compiler_options, options, result,
+                                           &handle->manager);
+  }
+  if (handle->node == NULL) { // stopped by the memory limit
+    handle->manager = NULL;
+    return;
+  }
+  sdd_ref(handle->node, handle->manager);
+  handle->compile_seconds = result->compile_seconds;
+  handle->minimize_seconds = result->minimize_seconds;
+  handle->constrain_seconds = result->constrain_seconds;
+}
+
+// Compile the constrained SDD of handle, if not done yet. Returns 0 if the
+// memory limit of options stopped the compilation.
+int trim_compile(TrimHandle* handle, SearchOptions* options) {
+  if (handle->node != NULL) return 1;
+  SearchResult* result = new_search_result(handle->data->num_features);
+  compile_handle(handle, options, result);
+  free_search_result(result);
+  return handle->node != NULL;
+}
+
+// Helper function: the naive Bayes classifier of handle, detected on the
+// first call, if options allow a search without the SDD: with the default
+// E-SDP evaluator, and without a checkpoint, a bound cache or a threshold
+// study, which are of the SDD. NULL otherwise. Sets the engine of result, and
+// why the SDD is compiled instead.
+static NaiveBayes* handle_naive_bayes(TrimHandle* handle, SearchOptions* options,
+    SearchResult* result) {
+  const char* skip = NULL;
+  if (!options->naive_bayes) skip = "--no-naive-bayes";
+  else if (options->esdp_mode != ESDP_INCREMENTAL) skip = "another E-SDP evaluator";
+  else if (options->checkpoint_file != NULL || options->resume) skip = "--checkpoint";
+  else if (options->bound_cache_file != NULL) skip = "--bound-cache";
+  else if (options->num_thresholds > 0) skip = "-r";
+  if (skip != NULL) {
+    result->engine_reason = skip;
+    return NULL;
+  }
+  if (!handle->naive_bayes_checked) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    handle->naive_bayes = naive_bayes_detect(handle->data, handle->fnf,
+                                             &handle->naive_bayes_reason);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    handle->naive_bayes_seconds = (end.tv_sec - start.tv_sec) +
+                                  (end.tv_nsec - start.tv_nsec) / 1e9;
+    handle->naive_bayes_checked = 1;
+    if (handle->naive_bayes != NULL) {
+      printf("\nnaive bayes classifier: searching without an sdd\n");
+    } else {
+      printf("\nnot naive bayes (%s): compiling an sdd\n", handle->naive_bayes_reason);
+    }
+  }
+  if (handle->naive_bayes != NULL) result->engine = "naive bayes";
+  else result->engine_reason = handle->naive_bayes_reason;
+  return handle->naive_bayes;
+}
+
+// Search an optimal feature subset with the current threshold, budget and
+// costs of handle, compiling its SDD first if needed. A naive Bayes
+// classifier is searched without an SDD (see naivebayes.c), unless
+// options->naive_bayes is 0. The result is the caller's, to be freed with
+// free_search_result; if the search stopped early, its stop_reason says why.
+SearchResult* trim_search(TrimHandle* handle, SearchOptions* options) {
+  if (options->decision >= (int) handle->data->num_decisions) {
+    fprintf(stderr, "Decision %d does not exist (the search file has %"PRIsS")\n",
+            options->decision, handle->data->num_decisions);
+    exit(1);
+  }
+  SearchResult* result = new_search_result(handle->data->num_features);
+  NaiveBayes* nb = handle_naive_bayes(handle, options, result);
+  if (nb != NULL) {
+    result->compile_seconds = handle->naive_bayes_seconds;
+    search_naive_bayes(nb, handle->data, handle->fnf, options, result);
+    return result;
+  }
+  if (handle->node == NULL) {
+    compile_handle(handle, options, result);
+    if (handle->node == NULL) return result;
+  }
+  result->compile_seconds = handle->compile_seconds;
+  result->minimize_seconds = handle->minimize_seconds;
+  result->constrain_seconds = handle->constrain_seconds;
+  search_constrained_sdd(&handle->node, handle->manager, handle->data, handle->fnf,
+                         options, result);
+  return result;
+}
+
+// Stop the running trim_search at its next search node (stop reason
+// "cancelled"), from another thread or a signal handler. Worker processes do
+// not see it: a search with workers is only cancelled before the shards.
+void trim_cancel() {
+  cancel_search();
+}
+
+// Set the threshold of every decision
+void trim_set_threshold(TrimHandle* handle, const SddWmc threshold) {
+  handle->data->threshold = threshold;
+  for (SddSize k = 0; k < handle->data->num_decisions; k++) {
+    handle->data->thresholds[k] = threshold;
+  }
+}
+
+// Returns 0 (and changes nothing) for an unknown decision
+int trim_set_decision_threshold(TrimHandle* handle, const int decision,
+    const SddWmc threshold) {
+  if (decision < 0 || decision >= (int) handle->data->num_decisions) return 0;
+  handle->data->thresholds[decision] = threshold;
+  if (decision == 0) handle->data->threshold = threshold;
+  return 1;
+}
+
+void trim_set_budget(TrimHandle* handle, const float budget) {
+  handle->data->budget = budget;
+}
+
+// Returns 0 (and changes nothing) for an unknown feature or a negative cost
+int trim_set_cost(TrimHandle* handle, const int feature, const float cost) {
+  if (feature < 0 || feature >= (int) handle->data->num_features || cost < 0) return 0;
+  handle->data->costs[feature] = cost;
+  return 1;
+}
+
+int trim_num_features(TrimHandle* handle) {
+  return handle->data->num_features;
+}
+
+// NULL for an unknown feature
+const char* trim_feature_name(TrimHandle* handle, const int feature) {
+  if (feature < 0 || feature >= (int) handle->data->num_features) return NULL;
+  return handle->data->features[feature]->name;
+}
+
+int trim_num_decisions(TrimHandle* handle) {
+  return handle->data->num_decisions;
+}
+
+// "node" or "node=state", NULL for an unknown decision
+const char* trim_decision_name(TrimHandle* handle, const int decision) {
+  if (decision < 0 || decision >= (int) handle->data->num_decisions) return NULL;
+  return handle->data->decision_names[decision];
+}
+
+SearchData* trim_search_data(TrimHandle* handle) {
+  return handle->data;
+}
+
+Fnf* trim_fnf(TrimHandle* handle) {
+  return handle->fnf;
+}
+
+/****************************************************************************************
+ * end
+ ****************************************************************************************/
@@ -1,9 +1,11 @@
 #define _GNU_SOURCE
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "sddapi.h"
 #include "search.h"
+#include "network.h"
 
 // Helper function: find a string in a sorted array of strings.
 // Return the index if string is in the array, and return -1 otherwise.
@@ -108,32 +110,169 @@ void parse_lmap(const char* filename, size_t* var_count, size_t* node_count,
   fclose(fp);
 }
 
-// Parse files with literal map and E-SDP search problem definition
-SearchData* read_search_data(const char* lmap_filename, const char* input_filename) {
+// Helper function: index of the network node name, which must exist
+static int locate_node(char** sorted_node_names, const size_t node_count,
+    const char* name, const char* input_filename) {
+  int index = (name == NULL) ? -1 : bsearch_locate(sorted_node_names, node_count, name);
+  if (index < 0 || index >= (int) node_count || strcmp(sorted_node_names[index], name) != 0) {
+    fprintf(stderr, "%s: unknown network node %s\n", input_filename,
+            name == NULL ? "(none)" : name);
+    exit(1);
+  }
+  return index;
+}
+
+// Helper function: a feature of the network nodes at indices
+static Feature* new_feature(const char* name, const int* indices, const SddSize num_nodes,
+    char** sorted_node_names, SddLiteral** sorted_node_indicators,
+    SddSize* sorted_node_num_indicators) {
+  Feature* feature = (Feature*) malloc(sizeof(Feature));
+  feature->name = strdup(name);
+  feature->num_nodes = num_nodes;
+  feature->node_names = (char**) malloc(num_nodes * sizeof(char*));
+  feature->node_num_indicators = (SddSize*) malloc(num_nodes * sizeof(SddSize));
+  feature->num_indicators = 0;
+  for (SddSize k = 0; k < num_nodes; k++) {
+    feature->node_names[k] = strdup(sorted_node_names[indices[k]]);
+    feature->node_num_indicators[k] = sorted_node_num_indicators[indices[k]];
+    feature->num_indicators += feature->node_num_indicators[k];
+  }
+  feature->indicators = (SddLiteral*) malloc(feature->num_indicators * sizeof(SddLiteral));
+  SddSize i = 0;
+  for (SddSize k = 0; k < num_nodes; k++) {
+    for (SddSize s = 0; s < feature->node_num_indicators[k]; s++) {
+      feature->indicators[i++] = sorted_node_indicators[indices[k]][s];
+    }
+  }
+  return feature;
+}
+
+// Helper function: add a decision of data, on the state of node name (NULL for
+// the first state) with the given indicator
+static void add_decision(SearchData* data, const char* name, const char* state,
+    const SddLiteral indicator, const SddWmc threshold) {
+  SddSize k = data->num_decisions++;
+  data->decisions = (SddLiteral*) realloc(data->decisions,
+                                          data->num_decisions * sizeof(SddLiteral));
+  data->thresholds = (SddWmc*) realloc(data->thresholds,
+                                       data->num_decisions * sizeof(SddWmc));
+  data->decision_names = (char**) realloc(data->decision_names,
+                                          data->num_decisions * sizeof(char*));
+  data->decisions[k] = indicator;
+  data->thresholds[k] = threshold;
+  size_t length = strlen(name) + (state != NULL ? strlen(state) + 1 : 0) + 1;
+  data->decision_names[k] = (char*) malloc(length);
+  if (state != NULL) snprintf(data->decision_names[k], length, "%s=%s", name, state);
+  else snprintf(data->decision_names[k], length, "%s", name);
+}
+
+// Helper function: set the literals that fix the num_fixed nodes of data to
+// their states: the indicator of the state, and the negated indicators of the
+// others. A fixed node can be neither the decision nor a feature, nor be fixed
+// twice.
+static void set_fixed_literals(SearchData* data, const char* input_filename,
+    const int* fixed_nodes, const int* fixed_states, const int num_fixed,
+    char** sorted_node_names, SddLiteral** sorted_node_indicators,
+    SddSize* sorted_node_num_indicators) {
+  data->num_fixed_nodes = num_fixed;
+  data->num_fixed_literals = 0;
+  for (int k = 0; k < num_fixed; k++) {
+    data->num_fixed_literals += sorted_node_num_indicators[fixed_nodes[k]];
+  }
+  data->fixed_literals = (SddLiteral*) malloc((data->num_fixed_literals + 1) *
+                                              sizeof(SddLiteral));
+  SddSize i = 0;
+  for (int k = 0; k < num_fixed; k++) {
+    const char* name = sorted_node_names[fixed_nodes[k]];
+    SddLiteral* indicators = sorted_node_indicators[fixed_nodes[k]];
+    int conflict = 0;
+    for (SddSize d = 0; d < data->num_decisions; d++) {
+      for (SddSize s = 0; s < sorted_node_num_indicators[fixed_nodes[k]]; s++) {
+        conflict |= (indicators[s] == data->decisions[d]);
+      }
+    }
+    for (int l = 0; l < k; l++) conflict |= (fixed_nodes[l] == fixed_nodes[k]);
+    for (int j = 0; j < data->num_features; j++) {
+      for (SddSize m = 0; m < data->features[j]->num_nodes; m++) {
+        conflict |= (strcmp(data->features[j]->node_names[m], name) == 0);
+      }
+    }
+    if (conflict) {
+      fprintf(stderr, "%s: fixed node %s is the decision, a feature, or fixed twice\n",
+              input_filename, name);
+      exit(1);
+    }
+    for (SddSize s = 0; s < sorted_node_num_indicators[fixed_nodes[k]]; s++) {
+      data->fixed_literals[i++] = (s == fixed_states[k]) ? indicators[s] : -indicators[s];
+    }
+  }
+}
+
+// Helper function: check that an f, a or g line, the n-th feature, comes after
+// the $ line and within the number of features it declares
+static void check_feature_slot(const SearchData* data, const char* input_filename,
+    const int n) {
+  if (data->features == NULL) {
+    fprintf(stderr, "%s: feature before the search metadata ($ line)\n", input_filename);
+    exit(1);
+  }
+  if ((SddSize) n >= data->num_features) {
+    fprintf(stderr, "%s: more than the %"PRIsS" features of the $ line\n", input_filename,
+            data->num_features);
+    exit(1);
+  }
+}
+
+// Helper function: mark the nodes of a feature as used, so that no node is in
+// two features (an f line twice, or an f and a g line)
+static void claim_feature_nodes(char* in_feature, const int* indices,
+    const SddSize num_nodes, char** sorted_node_names, const char* input_filename) {
+  for (SddSize i = 0; i < num_nodes; i++) {
+    if (in_feature[indices[i]]) {
+      fprintf(stderr, "%s: node %s is in more than one feature\n", input_filename,
+              sorted_node_names[indices[i]]);
+      exit(1);
+    }
+    in_feature[indices[i]] = 1;
+  }
+}
+
+// Helper function: parse the E-SDP search problem definition given a literal
+// map (as produced by parse_lmap), and free the literal map
+static SearchData* build_search_data(const char* input_filename,
+    size_t var_count, size_t node_count, char** sorted_node_names,
+    SddLiteral** sorted_node_indicators, SddSize* sorted_node_num_indicators,
+    SddWmc* weights) {
   FILE* input_fp = fopen(input_filename, "rb");
   if (input_fp == NULL) {
     printf("Could not open input file %s\n", input_filename);
     exit(1);
   }
 
-  size_t var_count, node_count;
-  char** sorted_node_names;
-  SddLiteral** sorted_node_indicators;
-  SddSize* sorted_node_num_indicators;
-  SddWmc *weights;
-  parse_lmap(lmap_filename, &var_count, &node_count, &sorted_node_names,
-             &sorted_node_indicators, &sorted_node_num_indicators, &weights);
-
   SearchData* data = (SearchData*) malloc(sizeof(SearchData));
   data->var_count = var_count;
   data->node_count = node_count;
+  data->num_decisions = 0;
+  data->decisions = NULL;
+  data->thresholds = NULL;
+  data->decision_names = NULL;
+  data->num_features = 0;
+  data->features = NULL;
 
   char* line = NULL;
   size_t len = 0;
   ssize_t read;
   int n = 0;
+  int* indices = (int*) malloc((node_count + 1) * sizeof(int));
+  int num_fixed = 0;
+  int* fixed_nodes = (int*) malloc((node_count + 1) * sizeof(int));
+  int* fixed_states = (int*) malloc((node_count + 1) * sizeof(int));
+  char* in_feature = (char*) calloc(node_count + 1, sizeof(char));
   while((read = getline(&line, &len, input_fp)) != -1) {
     if (read < 3) continue;
+    if ((line[0] == 'f' || line[0] == 'a' || line[0] == 'g') && line[1] == ' ') {
+      check_feature_slot(data, input_filename, n);
+    }
     if (line[0] == '$' && line[1] == ' ') {
       // Search metadata specified as: "$ [num_features] [threshold] [budget]"
       data->num_features = strtoul(strtok(line+2," \n"),NULL,10);
@@ -141,28 +280,105 @@ SearchData* read_search_data(const char* lmap_filename, const char* input_filena
       data->budget = strtof(strtok(NULL," \n"),NULL);
       data->costs = (float*) malloc(data->num_features * sizeof(float));
       data->features = (Feature**) malloc(data->num_features * sizeof(Feature*));      
+      data->always_included = (SubsetWord*) calloc(subset_words(data->num_features),
+                                                   sizeof(SubsetWord));
     } else if (line[0] == 'd' && line[1] == ' ') {
-      // Decision variable specified as: "d [decision_node_name]"
-      int decision_index =
-          bsearch_locate(sorted_node_names, node_count, strtok(line+2," \n"));
-      data->decision = sorted_node_indicators[decision_index][0];
-    } else if (line[0] == 'f' && line[1] == ' ') {
-      // Features are specified as: "f [feature_node_name]"
-      int index =
-          bsearch_locate(sorted_node_names, node_count, strtok(line+2," \n"));
-      SddSize num_indicators = sorted_node_num_indicators[index];
-      data->features[n] = (Feature*) malloc(sizeof(Feature));
-      data->features[n]->num_indicators = num_indicators;
-      data->features[n]->indicators =
-          (SddLiteral*) malloc(num_indicators * sizeof(SddLiteral));
-      for (int i = 0; i < num_indicators; i++) {
-        data->features[n]->indicators[i] = sorted_node_indicators[index][i];
+      // Decision variable specified as: "d [decision_node_name]", for its
+      // first state and the threshold of the $ line. Several decisions, such
+      // as the states of a multi-valued node with a threshold each, are
+      // specified one per line as: "d [node_name] [state] [threshold]", with
+      // the threshold optional. A missing threshold is filled in after the
+      // loop, as the $ line may come later
+      char* name = strtok(line+2," \n");
+      int index = locate_node(sorted_node_names, node_count, name, input_filename);
+      char* state = strtok(NULL," \n");
+      char* threshold = strtok(NULL," \n");
+      char* end = NULL;
+      long value = (state == NULL) ? 0 : strtol(state, &end, 10);
+      if (value < 0 || value >= (long) sorted_node_num_indicators[index] ||
+          (end != NULL && *end != '\0')) {
+        fprintf(stderr, "%s: invalid state %s of decision node %s\n", input_filename,
+                state, name);
+        exit(1);
       }
+      add_decision(data, name, state, sorted_node_indicators[index][value],
+                   threshold == NULL ? NAN : strtod(threshold, NULL));
+    } else if ((line[0] == 'f' || line[0] == 'a') && line[1] == ' ') {
+      // Features are specified as: "f [feature_node_name] [feature_cost]", and
+      // features in every subset (always observed) as: "a [node_name] [cost]"
+      char* name = strtok(line+2," \n");
+      indices[0] = locate_node(sorted_node_names, node_count, name, input_filename);
+      claim_feature_nodes(in_feature, indices, 1, sorted_node_names, input_filename);
+      data->features[n] = new_feature(name, indices, 1, sorted_node_names,
+                                      sorted_node_indicators, sorted_node_num_indicators);
       data->costs[n] = strtof(strtok(NULL," \n"),NULL);
+      if (line[0] == 'a') subset_add(data->always_included, n);
+      n++;
+    } else if (line[0] == 'e' && line[1] == ' ') {
+      // Nodes fixed to a state (by its index, from 0) are specified as:
+      // "e [node_name] [state]". They are not features.
+      char* name = strtok(line+2," \n");
+      int index = locate_node(sorted_node_names, node_count, name, input_filename);
+      char* state = strtok(NULL," \n");
+      char* end = NULL;
+      long value = (state == NULL) ? -1 : strtol(state, &end, 10);
+      if (value < 0 || value >= (long) sorted_node_num_indicators[index] || *end != '\0') {
+        fprintf(stderr, "%s: invalid state %s of fixed node %s\n", input_filename,
+                state == NULL ? "(none)" : state, name);
+        exit(1);
+      }
+      fixed_nodes[num_fixed] = index;
+      fixed_states[num_fixed++] = value;
+    } else if (line[0] == 'g' && line[1] == ' ') {
+      // Groups of nodes selected together, as one feature, are specified as:
+      // "g [group_name] [group_cost] [node_name]..."
+      char* name = strtok(line+2," \n");
+      char* cost = strtok(NULL," \n");
+      SddSize num_nodes = 0;
+      for (char* node = strtok(NULL," \n"); node != NULL; node = strtok(NULL," \n")) {
+        if (num_nodes == node_count) break;
+        indices[num_nodes++] = locate_node(sorted_node_names, node_count, node,
+                                           input_filename);
+      }
+      if (name == NULL || cost == NULL || num_nodes == 0) {
+        fprintf(stderr, "%s: group %s has no nodes\n", input_filename,
+                name == NULL ? "(unnamed)" : name);
+        exit(1);
+      }
+      claim_feature_nodes(in_feature, indices, num_nodes, sorted_node_names,
+                          input_filename);
+      data->features[n] = new_feature(name, indices, num_nodes, sorted_node_names,
+                                      sorted_node_indicators, sorted_node_num_indicators);
+      data->costs[n] = strtof(cost,NULL);
       n++;
     }
   }
 
+  free(indices);
+  free(in_feature);
+  if (data->features == NULL) {
+    fprintf(stderr, "%s: no search metadata ($ line)\n", input_filename);
+    exit(1);
+  }
+  if ((SddSize) n != data->num_features) {
+    fprintf(stderr, "%s: the $ line declares %"PRIsS" features, but %d are given\n",
+            input_filename, data->num_features, n);
+    exit(1);
+  }
+  if (data->num_decisions == 0) {
+    fprintf(stderr, "%s: no decision node (d line)\n", input_filename);
+    exit(1);
+  }
+  for (SddSize k = 0; k < data->num_decisions; k++) {
+    if (isnan(data->thresholds[k])) data->thresholds[k] = data->threshold;
+  }
+  data->decision = data->decisions[0];
+  data->threshold = data->thresholds[0];
+  set_fixed_literals(data, input_filename, fixed_nodes, fixed_states, num_fixed,
+                     sorted_node_names, sorted_node_indicators, sorted_node_num_indicators);
+  free(fixed_nodes);
+  free(fixed_states);
+
   // Make literal_weights easier to index (1.0 weight to all negative literals)
   SddLiteral literal_count = 2 * data->var_count + 1;
   data->literal_weights = (SddWmc*) malloc(literal_count * sizeof(SddWmc));
@@ -187,20 +403,72 @@ SearchData* read_search_data(const char* lmap_filename, const char* input_filena
   return data;
 }
 
+// Parse files with literal map and E-SDP search problem definition
+SearchData* read_search_data(const char* lmap_filename, const char* input_filename) {
+  size_t var_count, node_count;
+  char** sorted_node_names;
+  SddLiteral** sorted_node_indicators;
+  SddSize* sorted_node_num_indicators;
+  SddWmc *weights;
+  parse_lmap(lmap_filename, &var_count, &node_count, &sorted_node_names,
+             &sorted_node_indicators, &sorted_node_num_indicators, &weights);
+  return build_search_data(input_filename, var_count, node_count,
+                           sorted_node_names, sorted_node_indicators,
+                           sorted_node_num_indicators, weights);
+}
+
+// Read a Bayesian network (.net or .uai) and the E-SDP search problem
+// definition. The network is encoded in memory and its CNF is returned via
+// fnf, so that no ACE-generated .cnf and .lmap files are needed.
+SearchData* read_search_data_from_net(const char* net_filename,
+    const char* input_filename, const int skip_deterministic, Fnf** fnf) {
+  size_t var_count, node_count;
+  char** sorted_node_names;
+  SddLiteral** sorted_node_indicators;
+  SddSize* sorted_node_num_indicators;
+  SddWmc *weights;
+  BayesNet* bn = read_bayes_net(net_filename);
+  *fnf = encode_bayes_net(bn, skip_deterministic, &var_count, &node_count,
+                          &sorted_node_names, &sorted_node_indicators,
+                          &sorted_node_num_indicators, &weights);
+  free_bayes_net(bn);
+  return build_search_data(input_filename, var_count, node_count,
+                           sorted_node_names, sorted_node_indicators,
+                           sorted_node_num_indicators, weights);
+}
+
 void free_search_data(SearchData* data) {
   for (int i = 0; i < data->num_features; i++) {
-    free(data->features[i]->indicators);
-    free(data->features[i]);
+    Feature* feature = data->features[i];
+    for (SddSize k = 0; k < feature->num_nodes; k++) free(feature->node_names[k]);
+    free(feature->node_names);
+    free(feature->node_num_indicators);
+    free(feature->name);
+    free(feature->indicators);
+    free(feature);
   }
   free(data->features);
   free(data->literal_weights - data->var_count);
   free(data->costs);
+  free(data->always_included);
+  free(data->fixed_literals);
+  for (SddSize k = 0; k < data->num_decisions; k++) free(data->decision_names[k]);
+  free(data->decisions);
+  free(data->thresholds);
+  free(data->decision_names);
   free(data);
 }
 
 void print_search_data(SearchData* data) {
   printf("num_features: %"PRIsS", threshold: %.2f, budget: %.2f\n",
          data->num_features, data->threshold, data->budget);
+  if (data->num_decisions > 1) {
+    printf("decisions:");
+    for (SddSize k = 0; k < data->num_decisions; k++) {
+      printf(" %s (threshold %.2f)", data->decision_names[k], data->thresholds[k]);
+    }
+    printf("\n");
+  }
   for (int i = 0; i < data->num_features; i++) {
     printf("Feature %d: %d indicators ", i, data->features[i]->num_indicators);
     for (int j = 0; j < data->features[i]->num_indicators; j++) {
@@ -214,21 +482,246 @@ SearchResult* new_search_result(const SddSize num_features) {
   SearchResult* result =
       (SearchResult*) malloc(sizeof(SearchResult));
   result->best_score = 0;
-  result->best_subset = (char*) malloc(num_features * sizeof(char));
+  result->best_subset = (SubsetWord*) calloc(subset_words(num_features), sizeof(SubsetWord));
   result->cost = 0;
+  result->compile_seconds = result->minimize_seconds = 0;
+  result->constrain_seconds = result->search_seconds = 0;
+  result->bounds_seconds = 0;
+  result->sdd_size = result->sdd_count = 0;
+  result->stop_reason = NULL;
+  result->peak_rss_kb = 0;
+  result->epsilon = 0;
+  result->max_pruned_bound = 0;
+  memset(&result->top, 0, sizeof(TopSubsets));
+  result->decision = -1;
+  result->engine = "sdd";
+  result->engine_reason = NULL;
+  memset(&result->stats, 0, sizeof(SearchStats));
+  result->stats.prunes_by_depth = (SddSize*) calloc(num_features + 1, sizeof(SddSize));
+  result->stats.samples =
+      (SddSizeSample*) malloc(SEARCH_STATS_MAX_SAMPLES * sizeof(SddSizeSample));
+  result->stats.sample_interval = 0.01;
   return result;
 }
 
 void free_search_result(SearchResult* result) {
   if (result->best_subset != NULL) free(result->best_subset);
+  free(result->top.scores);
+  free(result->top.costs);
+  free(result->top.subsets);
+  free(result->stats.prunes_by_depth);
+  free(result->stats.samples);
   free(result);
 }
 
+// Proven bound on how much the best ECA can exceed the best score found:
+// every subtree not searched had a bound of at most max_pruned_bound
+SddWmc search_result_gap(SearchResult* result) {
+  SddWmc gap = result->max_pruned_bound - result->best_score;
+  return (gap > 0) ? gap : 0;
+}
+
 void update_search_result(SearchResult* result, const SddWmc new_score,
-    const float new_cost, const char* new_subset, const SddSize num_features) {
+    const float new_cost, const SubsetWord* new_subset, const SddSize num_features) {
   result->best_score = new_score;
   result->cost = new_cost;
-  for (int i = 0; i < num_features; i++) {
-    result->best_subset[i] = new_subset[i];
+  result->stats.incumbent_updates++;
+  subset_copy(result->best_subset, new_subset, subset_words(num_features));
+}
+
+// Keep the k best subsets of the search in result->top, for k > 1
+void keep_top_subsets(SearchResult* result, const int k, const SddSize num_features) {
+  TopSubsets* top = &result->top;
+  top->k = k;
+  top->count = 0;
+  top->scores = (SddWmc*) malloc(k * sizeof(SddWmc));
+  top->costs = (float*) malloc(k * sizeof(float));
+  top->subsets = (SubsetWord*) calloc(k * subset_words(num_features), sizeof(SubsetWord));
+}
+
+// Helper function: whether kept subset i is worse than kept subset j
+static int top_worse(const TopSubsets* top, const int i, const int j) {
+  return top->scores[i] < top->scores[j] ||
+         (top->scores[i] == top->scores[j] && top->costs[i] > top->costs[j]);
+}
+
+static void top_swap(TopSubsets* top, const int i, const int j, const SddSize words) {
+  SddWmc score = top->scores[i];
+  top->scores[i] = top->scores[j];
+  top->scores[j] = score;
+  float cost = top->costs[i];
+  top->costs[i] = top->costs[j];
+  top->costs[j] = cost;
+  SubsetWord* a = top->subsets + i * words;
+  SubsetWord* b = top->subsets + j * words;
+  for (SddSize w = 0; w < words; w++) {
+    SubsetWord word = a[w];
+    a[w] = b[w];
+    b[w] = word;
+  }
+}
+
+// Helper function: restore the heap below entry i, over the first count
+static void top_sift_down(TopSubsets* top, int i, const int count, const SddSize words) {
+  while (1) {
+    int worst = i, left = 2 * i + 1, right = 2 * i + 2;
+    if (left < count && top_worse(top, left, worst)) worst = left;
+    if (right < count && top_worse(top, right, worst)) worst = right;
+    if (worst == i) return;
+    top_swap(top, i, worst, words);
+    i = worst;
+  }
+}
+
+// Add a subset to the k best, if there is room or it beats the worst kept
+void offer_top_subset(SearchResult* result, const SddWmc score, const float cost,
+    const SubsetWord* subset, const SddSize num_features) {
+  TopSubsets* top = &result->top;
+  SddSize words = subset_words(num_features);
+  if (top->count < top->k) {
+    int i = top->count++;
+    top->scores[i] = score;
+    top->costs[i] = cost;
+    subset_copy(top->subsets + i * words, subset, words);
+    while (i > 0 && top_worse(top, i, (i - 1) / 2)) { // sift up
+      top_swap(top, i, (i - 1) / 2, words);
+      i = (i - 1) / 2;
+    }
+  } else if (score > top->scores[0] || (score == top->scores[0] && cost < top->costs[0])) {
+    top->scores[0] = score;
+    top->costs[0] = cost;
+    subset_copy(top->subsets, subset, words);
+    top_sift_down(top, 0, top->count, words);
+  }
+}
+
+// Sort the k best subsets best first, after the search
+void sort_top_subsets(SearchResult* result, const SddSize num_features) {
+  TopSubsets* top = &result->top;
+  SddSize words = subset_words(num_features);
+  for (int end = top->count - 1; end > 0; end--) {
+    top_swap(top, 0, end, words); // the worst left goes last
+    top_sift_down(top, 0, end, words);
+  }
+}
+
+// Helper function: write a JSON string, escaping quotes, backslashes and
+// control characters
+static void write_json_string(FILE* fp, const char* str) {
+  fputc('"', fp);
+  for (const char* c = str; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') fprintf(fp, "\\%c", *c);
+    else if ((unsigned char) *c < 0x20) fprintf(fp, "\\u%04x", *c);
+    else fputc(*c, fp);
+  }
+  fputc('"', fp);
+}
+
+// Write the result of a search and the counters of its search phase as a
+// JSON object
+void write_search_stats_json(const char* filename, const char* input_filename,
+                             SearchData* data, SearchResult* result) {
+  FILE* fp = fopen(filename, "w");
+  if (fp == NULL) {
+    fprintf(stderr, "Could not open stats file %s\n", filename);
+    exit(1);
+  }
+  SearchStats* stats = &result->stats;
+  fprintf(fp, "{\n  \"problem\": ");
+  write_json_string(fp, input_filename);
+  fprintf(fp, ",\n  \"num_features\": %"PRIsS",\n", data->num_features);
+  if (data->num_decisions > 1) {
+    // the decisions whose mean ECA is the ECA of the search
+    fprintf(fp, "  \"decisions\": [");
+    for (SddSize k = 0; k < data->num_decisions; k++) {
+      if (result->decision >= 0 && k != (SddSize) result->decision) continue;
+      if (k > 0 && result->decision < 0) fprintf(fp, ", ");
+      write_json_string(fp, data->decision_names[k]);
+    }
+    fprintf(fp, "],\n");
+  }
+  fprintf(fp, "  \"best_eca\": %.9f,\n", result->best_score);
+  fprintf(fp, "  \"best_cost\": %g,\n", result->cost);
+  fprintf(fp, "  \"best_subset\": [");
+  const char* separator = "";
+  for (int i = 0; i < data->num_features; i++) {
+    if (result->best_score > 0 && subset_has(result->best_subset, i)) {
+      fprintf(fp, "%s", separator);
+      write_json_string(fp, data->features[i]->name);
+      separator = ", ";
+    }
   }
+  fprintf(fp, "],\n");
+  if (result->top.k > 1) {
+    // the k best subsets, best first
+    SddSize words = subset_words(data->num_features);
+    fprintf(fp, "  \"top_subsets\": [");
+    for (int t = 0; t < result->top.count; t++) {
+      fprintf(fp, "%s\n    {\"eca\": %.9f, \"cost\": %g, \"subset\": [", t > 0 ? "," : "",
+              result->top.scores[t], result->top.costs[t]);
+      separator = "";
+      for (int i = 0; i < data->num_features; i++) {
+        if (subset_has(result->top.subsets + t * words, i)) {
+          fprintf(fp, "%s", separator);
+          write_json_string(fp, data->features[i]->name);
+          separator = ", ";
+        }
+      }
+      fprintf(fp, "]}");
+    }
+    fprintf(fp, "\n  ],\n");
+  }
+  fprintf(fp, "  \"seconds\": {\"compile\": %.6f, \"minimize\": %.6f, "
+          "\"constrain\": %.6f, \"bounds\": %.6f, \"search\": %.6f, \"esdp\": %.6f, "
+          "\"move\": %.6f},\n",
+          result->compile_seconds, result->minimize_seconds,
+          result->constrain_seconds, result->bounds_seconds, result->search_seconds,
+          stats->esdp_seconds, stats->move_seconds);
+  fprintf(fp, "  \"sdd_size\": %"PRIsS",\n  \"sdd_count\": %"PRIsS",\n",
+          result->sdd_size, result->sdd_count);
+  fprintf(fp, "  \"engine\": ");
+  write_json_string(fp, result->engine);
+  fprintf(fp, ",\n  \"engine_reason\": ");
+  if (result->engine_reason != NULL) write_json_string(fp, result->engine_reason);
+  else fprintf(fp, "null");
+  fprintf(fp, ",\n");
+  fprintf(fp, "  \"stop_reason\": ");
+  if (result->stop_reason != NULL) write_json_string(fp, result->stop_reason);
+  else fprintf(fp, "null");
+  fprintf(fp, ",\n");
+  fprintf(fp, "  \"epsilon\": %g,\n", result->epsilon);
+  fprintf(fp, "  \"max_pruned_bound\": %.9f,\n", result->max_pruned_bound);
+  fprintf(fp, "  \"optimality_gap\": %.9f,\n", search_result_gap(result));
+  fprintf(fp, "  \"nodes_expanded\": %"PRIsS",\n", stats->nodes_expanded);
+  fprintf(fp, "  \"bound_evaluations\": %"PRIsS",\n", stats->bound_evaluations);
+  fprintf(fp, "  \"eca_evaluations\": %"PRIsS",\n", stats->eca_evaluations);
+  fprintf(fp, "  \"budget_cutoffs\": %"PRIsS",\n", stats->budget_cutoffs);
+  fprintf(fp, "  \"symmetry_skips\": %"PRIsS",\n", stats->symmetry_skips);
+  fprintf(fp, "  \"incumbent_updates\": %"PRIsS",\n", stats->incumbent_updates);
+  fprintf(fp, "  \"prunes_by_depth\": [");
+  for (int i = 0; i <= data->num_features; i++) {
+    fprintf(fp, "%s%"PRIsS, i > 0 ? ", " : "", stats->prunes_by_depth[i]);
+  }
+  fprintf(fp, "],\n");
+  fprintf(fp, "  \"cheap_prunes\": %"PRIsS",\n", stats->cheap_prunes);
+  fprintf(fp, "  \"cache_hits\": %"PRIsS",\n", stats->cache_hits);
+  fprintf(fp, "  \"feature_moves\": %"PRIsS",\n", stats->feature_moves);
+  fprintf(fp, "  \"var_moves\": %"PRIsS",\n", stats->var_moves);
+  fprintf(fp, "  \"condition_calls\": %"PRIsS",\n", stats->condition_calls);
+  fprintf(fp, "  \"apply_calls\": %"PRIsS",\n", stats->apply_calls);
+  fprintf(fp, "  \"gc_calls\": %"PRIsS",\n", stats->gc_calls);
+  fprintf(fp, "  \"minimizations\": %"PRIsS",\n", stats->minimizations);
+  fprintf(fp, "  \"minimize_size_before\": %"PRIsS",\n", stats->minimize_size_before);
+  fprintf(fp, "  \"minimize_size_after\": %"PRIsS",\n", stats->minimize_size_after);
+  fprintf(fp, "  \"minimize_seconds\": %.6f,\n", stats->minimize_seconds);
+  fprintf(fp, "  \"sdd_size_samples\": [");
+  for (SddSize i = 0; i < stats->sample_count; i++) {
+    SddSizeSample* sample = stats->samples + i;
+    fprintf(fp, "%s\n    {\"seconds\": %.6f, \"nodes_expanded\": %"PRIsS
+            ", \"live_size\": %"PRIsS", \"live_count\": %"PRIsS"}",
+            i > 0 ? "," : "", sample->seconds, sample->nodes_expanded,
+            sample->live_size, sample->live_count);
+  }
+  fprintf(fp, "\n  ]\n}\n");
+  fclose(fp);
 }
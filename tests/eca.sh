@@ -0,0 +1,75 @@
+#!/bin/sh
+# ECA of the SDD evaluators against the closed form of naive Bayes (run by
+# `make test`).
+#
+# usage: tests/eca.sh [-d DIR] [EXAMPLE...]
+#  EXAMPLE      example names, e.g. bupa (default: bupa pima)
+#  -d DIR       directory of the examples (default: examples)
+# Each example is searched by the naive Bayes engine, and on the SDD with the
+# flat (-E flat) and the incremental (--no-naive-bayes) evaluators. The three
+# must find the same best subset, with ECAs within 1e-6.
+
+TRIM=${TRIM:-build/trim}
+DIR=examples
+while getopts "d:" option; do
+  case $option in
+    d) DIR=$OPTARG ;;
+    *) exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+EXAMPLES=${*:-bupa pima}
+
+if [ ! -x "$TRIM" ]; then
+  echo "trim binary $TRIM not found; run make first" >&2
+  exit 1
+fi
+OUT_DIR=$(mktemp -d)
+trap 'rm -rf "$OUT_DIR"' EXIT
+
+# Value of a field of the --stats-json output
+json_field() {
+  sed -n "s/^ *\"$1\": \(.*\),$/\1/p" "$OUT_DIR/$2.json"
+}
+
+# Search example $1 with the options that follow, as run $2
+search() {
+  name=$1; run=$2; shift 2
+  if ! "$TRIM" --stats-json "$OUT_DIR/$run.json" "$@" \
+       -c "$DIR/$name.net.cnf" -l "$DIR/$name.net.lmap" -e "$DIR/$name.net.search" \
+       > "$OUT_DIR/$run.log" 2>&1; then
+    echo "$name: $run search failed"
+    cat "$OUT_DIR/$run.log"
+    exit 1
+  fi
+}
+
+failures=0
+for name in $EXAMPLES; do
+  search "$name" nb
+  search "$name" flat -E flat
+  search "$name" incremental --no-naive-bayes
+  if [ "$(json_field engine nb)" != '"naive bayes"' ]; then
+    echo "$name: FAIL, not searched as naive bayes ($(json_field engine_reason nb))"
+    failures=$((failures + 1))
+    continue
+  fi
+  eca=$(json_field best_eca nb)
+  subset=$(json_field best_subset nb)
+  status=ok
+  for run in flat incremental; do
+    if [ "$(json_field best_subset $run)" != "$subset" ] ||
+       ! awk -v a="$eca" -v b="$(json_field best_eca $run)" \
+             'BEGIN { d = a - b; exit !(d < 1e-6 && d > -1e-6) }'; then
+      echo "$name: FAIL, $run ECA $(json_field best_eca $run) of" \
+           "$(json_field best_subset $run), naive bayes $eca of $subset"
+      status=fail
+    fi
+  done
+  if [ "$status" = ok ]; then
+    echo "$name: ok, ECA $eca of $subset"
+  else
+    failures=$((failures + 1))
+  fi
+done
+exit $((failures > 0))